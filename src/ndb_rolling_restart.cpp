@@ -14,17 +14,46 @@
  */
 
 #include "ndb_rolling_restart.hpp"
+#include "ndb_rolling_restart_api.hpp"
+#include "ndb_rolling_restart_control.hpp"
+#include "ndb_rolling_restart_copy_progress.hpp"
+#include "ndb_rolling_restart_dry_run.hpp"
+#include "ndb_rolling_restart_epochs.hpp"
+#include "ndb_rolling_restart_executor.hpp"
+#include "ndb_rolling_restart_hooks.hpp"
+#include "ndb_rolling_restart_host_locks.hpp"
+#include "ndb_rolling_restart_log.hpp"
+#include "ndb_rolling_restart_metrics.hpp"
+#include "ndb_rolling_restart_plan_cache.hpp"
+#include "ndb_rolling_restart_preflight.hpp"
+#include "ndb_rolling_restart_schedule.hpp"
+#include "ndb_rolling_restart_select.hpp"
+#include "ndb_rolling_restart_stats.hpp"
+#include "ndb_rolling_restart_trace.hpp"
 
 #include <algorithm>
 #include <cassert>
-#include <iostream>
+#include <ctime>
 #include <map>
+#include <mutex>
+#include <set>
 #include <string>
-#include <thread>
 
 using namespace std;
 
-#define Cerr cerr << __FILE__ << ":" << __LINE__ << ": "
+/* the polls without a status in a row after which a wait gives up,
+   each is followed by a reconnect */
+#define RESTART_STATUS_RETRIES 3
+
+void emit_restart_event(ndb_connection_context_s& ndb_ctx,
+    restart_event_type_e type, int node_id, long long value,
+    const string& message)
+{
+    if (ndb_ctx.on_event) {
+        ndb_ctx.on_event(restart_event_s{ type, node_id, ndb_ctx.current_wave,
+            value, message });
+    }
+}
 
 void close_ndb_connection(ndb_connection_context_s& ndb_ctx)
 {
@@ -33,85 +62,86 @@ void close_ndb_connection(ndb_connection_context_s& ndb_ctx)
         ndb_ctx.cluster_state = nullptr;
     }
 
-    if (ndb_ctx.ndb_mgm_handle) {
-        ndb_mgm_destroy_handle(&(ndb_ctx.ndb_mgm_handle));
-        ndb_ctx.ndb_mgm_handle = nullptr;
-    }
+    get_ndb_api(ndb_ctx).disconnect(ndb_ctx);
+}
 
-    if (ndb_ctx.connection) {
-        delete (ndb_ctx.connection);
-        ndb_ctx.connection = nullptr;
+static bool is_tracked(const vector<node_restart_progress_s>* progress,
+    int node_id)
+{
+    if (!progress) {
+        return false;
     }
+    for (const auto& node : *progress) {
+        if (node.node_id == node_id) {
+            return true;
+        }
+    }
+    return false;
 }
 
-static Ndb_cluster_connection* ndb_connect(const char* connect_string,
-    unsigned wait_seconds)
+/* samples cluster_state into the snapshot and logs what changed since
+   the previous sample, status and start phase of the nodes in progress
+   are left to update_restart_progress */
+static void sample_cluster_state(ndb_connection_context_s& ndb_ctx,
+    const ndb_mgm_cluster_state* cluster_state,
+    const vector<node_restart_progress_s>* progress)
 {
-    Ndb_cluster_connection* cluster_connection;
-
-    cluster_connection = new Ndb_cluster_connection(connect_string);
-    if (!cluster_connection) {
-        Cerr << "new Ndb_cluster_connection() returned 0" << endl;
-        return nullptr;
+    update_node_table(ndb_ctx.node_table, cluster_state);
+    bool first = !ndb_ctx.snapshot.samples;
+    if (!update_cluster_snapshot(ndb_ctx.snapshot, cluster_state) || first) {
+        return;
     }
-
-    int no_retries = 10;
-    int retry_delay_in_seconds = wait_seconds;
-    int verbose = 1;
-    cluster_connection->connect(no_retries, retry_delay_in_seconds, verbose);
-
-    int before_wait = wait_seconds;
-    int after_wait = wait_seconds;
-    if (cluster_connection->wait_until_ready(before_wait, after_wait) < 0) {
-        Cerr << "Cluster was not ready within "
-             << wait_seconds << " seconds" << endl;
-        delete (cluster_connection);
-        return nullptr;
+    for (const auto& change : ndb_ctx.snapshot.changes) {
+        int node_id = (change.changes & NODE_CHANGE_REMOVED)
+            ? change.before.node_id
+            : change.after.node_id;
+        unsigned others = change.changes
+            & ~(NODE_CHANGE_STATUS | NODE_CHANGE_START_PHASE);
+        if (!others && is_tracked(progress, node_id)) {
+            continue;
+        }
+        Cnode(ndb_ctx, node_id) << describe_node_change(change);
     }
-    return cluster_connection;
 }
 
-int init_ndb_connection(ndb_connection_context_s& ndb_ctx)
+static int refresh_cluster_state(ndb_connection_context_s& ndb_ctx,
+    const vector<node_restart_progress_s>* progress)
 {
-    ndb_ctx.connection = ndb_connect(ndb_ctx.connect_string.c_str(),
-        ndb_ctx.wait_seconds);
-    if (!ndb_ctx.connection) {
+    ndb_mgm_node_type node_types[2] = {
+        /* NDB_MGM_NODE_TYPE_MGM, */ /* SKIP management server node */
+        NDB_MGM_NODE_TYPE_NDB, /* database node, what we actually want */
+        NDB_MGM_NODE_TYPE_UNKNOWN /* weird */
+    };
+
+    ndb_mgm_cluster_state* cluster_state = get_ndb_api(ndb_ctx).get_status2(
+        ndb_ctx, node_types);
+    if (!cluster_state) {
+        Cerr(ndb_ctx) << "ndb_mgm_get_status2 returned null?";
         return 1;
     }
 
-    ndb_ctx.ndb_mgm_handle = ndb_mgm_create_handle();
-    if (!ndb_ctx.ndb_mgm_handle) {
-        Cerr << "Error: ndb_mgm_create_handle returned null?" << endl;
-        close_ndb_connection(ndb_ctx);
-        return 1;
+    if (ndb_ctx.cluster_state) {
+        free((void*)ndb_ctx.cluster_state);
     }
+    ndb_ctx.cluster_state = cluster_state;
+    sample_cluster_state(ndb_ctx, cluster_state, progress);
+    return 0;
+}
 
-    int no_retries = 10;
-    int retry_delay_secs = 3;
-    int verbose = 1;
+int refresh_cluster_state(ndb_connection_context_s& ndb_ctx)
+{
+    return refresh_cluster_state(ndb_ctx, nullptr);
+}
 
-    int ret = ndb_mgm_connect(ndb_ctx.ndb_mgm_handle, no_retries,
-        retry_delay_secs, verbose);
+int init_ndb_connection(ndb_connection_context_s& ndb_ctx)
+{
+    ndb_api_s& api = get_ndb_api(ndb_ctx);
 
-    if (ret != 0) {
-        Cerr "ndb_mgm_get_latest_error: "
-            << ndb_mgm_get_latest_error_msg(ndb_ctx.ndb_mgm_handle)
-            << endl;
-        close_ndb_connection(ndb_ctx);
+    if (api.connect(ndb_ctx)) {
         return 1;
     }
 
-    ndb_mgm_node_type node_types[2] = {
-        /* NDB_MGM_NODE_TYPE_MGM, */ /* SKIP management server node */
-        NDB_MGM_NODE_TYPE_NDB, /* database node, what we actually want */
-        NDB_MGM_NODE_TYPE_UNKNOWN /* weird */
-    };
-
-    ndb_ctx.cluster_state = ndb_mgm_get_status2(ndb_ctx.ndb_mgm_handle,
-        node_types);
-
-    if (!ndb_ctx.cluster_state) {
-        Cerr << "ndb_mgm_get_status2 returned null?" << endl;
+    if (refresh_cluster_state(ndb_ctx)) {
         close_ndb_connection(ndb_ctx);
         return 1;
     }
@@ -119,11 +149,9 @@ int init_ndb_connection(ndb_connection_context_s& ndb_ctx)
     return 0;
 }
 
-static const string get_ndb_mgm_dump_state(NdbMgmHandle ndb_mgm_handle,
+const string get_ndb_mgm_dump_state(ndb_connection_context_s& ndb_ctx,
     ndb_mgm_node_state node_state)
 {
-    assert(ndb_mgm_handle);
-
     int arg_count = 1;
     int args[1] = { 1000 };
     ndb_mgm_reply reply;
@@ -131,7 +159,8 @@ static const string get_ndb_mgm_dump_state(NdbMgmHandle ndb_mgm_handle,
     int node_id = node_state.node_id;
     int rv;
 
-    rv = ndb_mgm_dump_state(ndb_mgm_handle, node_id, args, arg_count, &reply);
+    rv = get_ndb_api(ndb_ctx).dump_state(ndb_ctx, node_id, args, arg_count,
+        &reply);
     if (rv == -1) {
         return "error: Could not dump state";
     }
@@ -143,100 +172,692 @@ static const string get_ndb_mgm_dump_state(NdbMgmHandle ndb_mgm_handle,
     return "ok";
 }
 
-static int get_online_node_count(ndb_mgm_cluster_state* cluster_state)
+static int get_online_node_count(const node_table_s& table)
 {
-    int online_nodes = 0;
+    return (int)table.started.count();
+}
 
-    assert(cluster_state);
-    for (int i = 0; i < cluster_state->no_of_nodes; ++i) {
-        auto node_state = &(cluster_state->node_states[i]);
-        if (node_state->node_status == NDB_MGM_NODE_STATUS_STARTED) {
-            ++online_nodes;
+static void sleep_reconnect(ndb_connection_context_s& ndb_ctx,
+    const vector<node_restart_progress_s>* progress)
+{
+    trace_span_s span(ndb_ctx.trace, "sleep_reconnect", "connection",
+        TRACE_TRACK_ORCHESTRATOR);
+
+    metrics_count(ndb_ctx.metrics, METRICS_RECONNECTS);
+    close_ndb_connection(ndb_ctx);
+    Cout(ndb_ctx) << "sleep(" << ndb_ctx.wait_seconds << ")";
+    get_ndb_api(ndb_ctx).sleep(ndb_ctx,
+        chrono::seconds(ndb_ctx.wait_seconds));
+    int err = get_ndb_api(ndb_ctx).connect(ndb_ctx);
+    if (!err) {
+        err = refresh_cluster_state(ndb_ctx, progress);
+    }
+    if (err) {
+        Cerr(ndb_ctx) << "could not reconnect to ndb";
+    }
+}
+
+static string progress_phase_name(const node_restart_progress_s& node)
+{
+    if (node.node_status == NDB_MGM_NODE_STATUS_STARTING) {
+        return "start_phase " + to_string(node.start_phase);
+    }
+    return ndb_mgm_get_node_status_string(node.node_status);
+}
+
+static void record_restart_phase(ndb_connection_context_s& ndb_ctx,
+    const node_restart_progress_s& node, chrono::steady_clock::time_point now)
+{
+    if (node.node_status == NDB_MGM_NODE_STATUS_UNKNOWN) {
+        return;
+    }
+    trace_add_span(ndb_ctx.trace, progress_phase_name(node), "phase",
+        node.node_id, node.phase_begin, now);
+    stats_phase_done(ndb_ctx.stats, progress_phase_name(node),
+        chrono::duration_cast<chrono::milliseconds>(now - node.phase_begin));
+}
+
+/* how far the data copy of a recovering node got, at most once per
+   report_interval unless done is set */
+static void report_copy_progress(ndb_connection_context_s& ndb_ctx,
+    int node_id, chrono::steady_clock::time_point now, bool done)
+{
+    ndb_copy_monitor_s* monitor = ndb_ctx.copy_monitor;
+    if (!monitor) {
+        return;
+    }
+    auto last = monitor->last_report.find(node_id);
+    if (!done && last != monitor->last_report.end()
+        && now - last->second < monitor->report_interval) {
+        return;
+    }
+    copy_estimate_s estimate = copy_monitor_estimate(*monitor, node_id, now);
+    string progress = format_copy_estimate(estimate);
+    if (progress.empty()) {
+        return;
+    }
+    if (done) {
+        monitor->last_report.erase(node_id);
+    } else {
+        monitor->last_report[node_id] = now;
+    }
+    Cnode(ndb_ctx, node_id) << "node " << node_id << ": " << progress;
+}
+
+static void update_node_progress(ndb_connection_context_s& ndb_ctx,
+    node_restart_progress_s& node, ndb_mgm_node_status node_status,
+    int start_phase, int connect_count, chrono::steady_clock::time_point now,
+    bool log_unchanged)
+{
+    auto in_phase = chrono::duration_cast<chrono::seconds>(
+        now - node.phase_begin);
+    auto in_restart = chrono::duration_cast<chrono::seconds>(
+        now - node.restart_begin);
+
+    bool changed = (node_status != node.node_status)
+        || (start_phase != node.start_phase);
+
+    if (node_status != NDB_MGM_NODE_STATUS_STARTED
+        || (node.connect_count >= 0 && connect_count != node.connect_count)) {
+        node.went_down = true;
+    }
+    if (!changed && !log_unchanged) {
+        return;
+    }
+
+    log_line_s line(ndb_ctx, RESTART_EVENT_LOG, node.node_id);
+    line.out << "node " << node.node_id << ": "
+             << ndb_mgm_get_node_status_string(node_status) << " start_phase "
+             << start_phase;
+    if (changed) {
+        line.out << " (previous took " << in_phase.count() << "s,";
+        record_restart_phase(ndb_ctx, node, now);
+        node.node_status = node_status;
+        node.start_phase = start_phase;
+        node.phase_begin = now;
+        emit_restart_event(ndb_ctx, RESTART_EVENT_NODE_PHASE, node.node_id,
+            node.start_phase, ndb_mgm_get_node_status_string(node.node_status));
+    } else {
+        line.out << " (for " << in_phase.count() << "s,";
+    }
+    line.out << " " << in_restart.count() << "s since restart)";
+}
+
+/* with log_unchanged false only changes of status or start phase are
+   logged, which suits frequent polling, returns 1 if there was no
+   status */
+static int update_restart_progress(ndb_connection_context_s& ndb_ctx,
+    vector<node_restart_progress_s>& progress, bool log_unchanged)
+{
+    ndb_mgm_node_type node_types[2] = {
+        NDB_MGM_NODE_TYPE_NDB,
+        NDB_MGM_NODE_TYPE_UNKNOWN
+    };
+    ndb_mgm_cluster_state* cluster_state = get_ndb_api(ndb_ctx).get_status2(
+        ndb_ctx, node_types);
+    if (!cluster_state) {
+        Cerr(ndb_ctx) << "ndb_mgm_get_status2 returned null?";
+        return 1;
+    }
+    metrics_update_live_replicas(ndb_ctx.metrics, cluster_state);
+    sample_cluster_state(ndb_ctx, cluster_state, &progress);
+
+    const node_table_s& table = ndb_ctx.node_table;
+    auto now = chrono::steady_clock::now();
+    for (auto& node : progress) {
+        int row = node_table_row(table, node.node_id);
+        if (row >= 0) {
+            update_node_progress(ndb_ctx, node, table.node_statuses[row],
+                table.start_phases[row], table.connect_counts[row], now,
+                log_unchanged);
         }
+        report_copy_progress(ndb_ctx, node.node_id, now, false);
     }
+    free((void*)cluster_state);
+    return 0;
+}
 
-    return online_nodes;
-    // this has some off-by-one error returning node_states+1
-    // return std::count_if(
-    //      cluster_state->node_states,
-    //      cluster_state->node_states +
-    //	    cluster_state->no_of_nodes*sizeof(ndb_mgm_node_state),
-    //      [](const ndb_mgm_node_state& state) {
-    //              return state.node_status == NDB_MGM_NODE_STATUS_STARTED; });
+static string node_list(const vector<int>& node_ids)
+{
+    string list;
+    for (auto node_id : node_ids) {
+        list += " " + to_string(node_id);
+    }
+    return list;
 }
 
-static void sleep_reconnect(ndb_connection_context_s& ndb_ctx)
+static vector<int> progress_node_ids(
+    const vector<node_restart_progress_s>& progress)
 {
-    close_ndb_connection(ndb_ctx);
-    cout << "sleep(" << ndb_ctx.wait_seconds << ")" << endl;
-    this_thread::sleep_for(chrono::seconds(ndb_ctx.wait_seconds));
-    int err = init_ndb_connection(ndb_ctx);
-    if (err) {
-        Cerr << "could not reconnect to ndb" << endl;
+    vector<int> node_ids;
+    for (const auto& node : progress) {
+        node_ids.push_back(node.node_id);
     }
+    return node_ids;
 }
 
 static int loop_wait_until_ready(ndb_connection_context_s& ndb_ctx,
-    int node_id)
+    const vector<int>& node_ids, vector<node_restart_progress_s>* progress)
 {
-    assert(ndb_ctx.connection);
+    assert(node_ids.size());
 
-    int cnt = 1;
-    int nodes[1] = { node_id };
+    ndb_api_s& api = get_ndb_api(ndb_ctx);
+    int cnt = (int)node_ids.size();
+    auto wait_begin = chrono::steady_clock::now();
 
     int ret = -1;
     while (ret == -1) {
-        cout << "wait_until_ready node " << nodes[0]
-             << " timeout: " << ndb_ctx.wait_seconds << endl;
-        ret = ndb_ctx.connection->wait_until_ready(nodes, cnt,
+        if (progress) {
+            update_restart_progress(ndb_ctx, *progress, true);
+        }
+        Cout(ndb_ctx) << "wait_until_ready node" << node_list(node_ids)
+                      << " timeout: " << ndb_ctx.wait_seconds;
+        ret = api.wait_until_ready(ndb_ctx, node_ids.data(), cnt,
             ndb_ctx.wait_seconds);
+        if (ret <= -1 && api.aborted()) {
+            return 1;
+        }
         if (ret <= -1) {
-            Cerr << "ndb_mgm_restart4 returned error: " << ret << endl;
-            sleep_reconnect(ndb_ctx);
+            Cerr(ndb_ctx) << "wait_until_ready returned error: " << ret;
+            metrics_count(ndb_ctx.metrics, METRICS_WAIT_RETRIES);
+            sleep_reconnect(ndb_ctx, progress);
         }
     }
+
+    auto wait_end = chrono::steady_clock::now();
+    for (auto node_id : node_ids) {
+        trace_add_span(ndb_ctx.trace, "wait_until_ready", "wait", node_id,
+            wait_begin, wait_end);
+    }
     return 0;
 }
 
-int restart_node(ndb_connection_context_s& ndb_ctx, int node_id)
+static int get_node_group(ndb_connection_context_s& ndb_ctx, int node_id,
+    int* connect_count)
+{
+    const node_table_s& table = ndb_ctx.node_table;
+    int row = node_table_row(table, node_id);
+    *connect_count = row < 0 ? -1 : table.connect_counts[row];
+    return row < 0 ? -1 : table.node_groups[row];
+}
+
+static string get_node_host(ndb_connection_context_s& ndb_ctx, int node_id)
+{
+    if (!ndb_ctx.cluster_state) {
+        return "";
+    }
+    for (int i = 0; i < ndb_ctx.cluster_state->no_of_nodes; ++i) {
+        auto node_state = ndb_ctx.cluster_state->node_states[i];
+        if (node_state.node_id == node_id) {
+            return node_state.connect_address;
+        }
+    }
+    return "";
+}
+
+static restart_control_e get_restart_control(
+    ndb_connection_context_s& ndb_ctx);
+static int wait_restarts_ready(ndb_connection_context_s& ndb_ctx,
+    vector<node_restart_progress_s>& recovering,
+    const node_mask_t& next_group_nodes, bool all_started);
+
+/* the nodes of recovering which hold a slot on host */
+static node_mask_t host_slot_nodes(const ndb_host_locks_s& locks,
+    const vector<node_restart_progress_s>& recovering, const string& host)
+{
+    vector<int> node_ids;
+    for (const auto& node : recovering) {
+        auto it = locks.held.find(node.node_id);
+        if (it != locks.held.end() && it->second.host == host) {
+            node_ids.push_back(node.node_id);
+        }
+    }
+    return node_mask(node_ids);
+}
+
+/* Waits until every node has a slot on its host, polling every second,
+   returns 1 if the rollout was cancelled or aborted meanwhile. Nodes
+   with an unknown host take no slot. If nodes of recovering hold slots
+   of the busy host, they are waited for instead, also when they hold
+   every slot of it. */
+static int lock_restart_hosts(ndb_connection_context_s& ndb_ctx,
+    const vector<int>& node_ids, vector<node_restart_progress_s>* recovering)
+{
+    if (!ndb_ctx.host_locks) {
+        return 0;
+    }
+    vector<host_lock_node_s> nodes;
+    for (auto node_id : node_ids) {
+        string host = get_node_host(ndb_ctx, node_id);
+        if (!host.empty()) {
+            nodes.push_back(host_lock_node_s{ node_id, host });
+        }
+    }
+    string owner = "cluster " + ndb_ctx.connect_string + " node"
+        + node_list(node_ids);
+
+    ndb_api_s& api = get_ndb_api(ndb_ctx);
+    auto wait_begin = chrono::steady_clock::now();
+    string busy_host;
+    string waited_host;
+    while (host_locks_acquire(*ndb_ctx.host_locks, nodes, owner, busy_host)) {
+        if (busy_host != waited_host) {
+            Cout(ndb_ctx) << "node" << node_list(node_ids)
+                          << " waiting for a slot on host " << busy_host;
+            waited_host = busy_host;
+        }
+        if (get_restart_control(ndb_ctx) == RESTART_CONTROL_CANCEL) {
+            Cout(ndb_ctx) << "cancelled while waiting for host " << busy_host
+                          << ", not restarted: node" << node_list(node_ids);
+            return 1;
+        }
+        ndb_host_locks_s& locks = *ndb_ctx.host_locks;
+        node_mask_t own_nodes = recovering
+            ? host_slot_nodes(locks, *recovering, busy_host)
+            : node_mask_t();
+        if (own_nodes.any()) {
+            /* only STARTED nodes of own_nodes count as ready, and are
+               removed from recovering with their slots */
+            if (wait_restarts_ready(ndb_ctx, *recovering, own_nodes, false)) {
+                return 1;
+            }
+            continue;
+        }
+        api.sleep(ndb_ctx, chrono::seconds(1));
+        if (api.aborted()) {
+            return 1;
+        }
+    }
+    if (!waited_host.empty()) {
+        auto waited = chrono::duration_cast<chrono::seconds>(
+            chrono::steady_clock::now() - wait_begin);
+        Cout(ndb_ctx) << "node" << node_list(node_ids) << " got host slots ("
+                      << waited.count() << "s)";
+        trace_add_span(ndb_ctx.trace, "host slot", "wait",
+            TRACE_TRACK_ORCHESTRATOR, wait_begin, chrono::steady_clock::now());
+    }
+    return 0;
+}
+
+static void unlock_restart_hosts(ndb_connection_context_s& ndb_ctx,
+    const vector<int>& node_ids)
+{
+    if (!ndb_ctx.host_locks) {
+        return;
+    }
+    for (auto node_id : node_ids) {
+        host_locks_release(*ndb_ctx.host_locks, node_id);
+    }
+}
+
+/* returns 1 if the hook is set and failed */
+static int run_restart_hook(ndb_connection_context_s& ndb_ctx,
+    const string& hook, const string& point, const vector<int>& node_ids)
+{
+    if (hook.empty()) {
+        return 0;
+    }
+    trace_span_s span(ndb_ctx.trace, point + " hook", "hook",
+        TRACE_TRACK_ORCHESTRATOR);
+    auto begin = chrono::steady_clock::now();
+    string error;
+    if (run_wave_hook(hook, point, ndb_ctx.current_wave, node_ids,
+            ndb_ctx.hooks->timeout, error)) {
+        Cerr(ndb_ctx) << point << " hook node" << node_list(node_ids)
+                      << " failed: " << error;
+        return 1;
+    }
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(
+        chrono::steady_clock::now() - begin);
+    Cout(ndb_ctx) << point << " hook node" << node_list(node_ids) << " ok ("
+                  << elapsed.count() << "ms)";
+    return 0;
+}
+
+int wait_live_replicas(ndb_connection_context_s& ndb_ctx,
+    const vector<int>& node_ids)
+{
+    ndb_api_s& api = get_ndb_api(ndb_ctx);
+    const node_table_s& table = ndb_ctx.node_table;
+    node_mask_t nodes = node_mask(node_ids);
+    for (unsigned waited = 0;; ++waited) {
+        if (refresh_cluster_state(ndb_ctx)) {
+            if (waited >= ndb_ctx.wait_seconds || api.aborted()) {
+                return 1;
+            }
+            sleep_reconnect(ndb_ctx, nullptr);
+            continue;
+        }
+        node_mask_t last_replicas = nodes & table.started & table.grouped
+            & ~node_table_eligible(table, nodes);
+        if (last_replicas.none()) {
+            return 0;
+        }
+        bool give_up = waited >= ndb_ctx.wait_seconds || api.aborted()
+            || get_restart_control(ndb_ctx) == RESTART_CONTROL_CANCEL;
+        if (!waited || give_up) {
+            for (auto node_id : node_ids) {
+                if (!node_mask_test(last_replicas, node_id)) {
+                    continue;
+                }
+                Cerr(ndb_ctx) << "node " << node_id
+                              << " is the last live replica of node group "
+                              << node_table_group(table, node_id)
+                              << (give_up ? ", not restarted" : ", waiting");
+            }
+        }
+        if (give_up) {
+            return 1;
+        }
+        api.sleep(ndb_ctx, chrono::seconds(1));
+    }
+}
+
+/* a fresh look, as a preflight may be outdated by now, false if the
+   status could not be had */
+static bool nodes_started(ndb_connection_context_s& ndb_ctx,
+    const vector<int>& node_ids)
+{
+    if (refresh_cluster_state(ndb_ctx)) {
+        return false;
+    }
+    node_mask_t not_started = node_mask(node_ids)
+        & ~ndb_ctx.node_table.started;
+    for (auto node_id : node_ids) {
+        if (node_mask_test(not_started, node_id)) {
+            Cout(ndb_ctx) << "preflight of node " << node_id
+                          << " is outdated, it is no longer STARTED";
+        }
+    }
+    return not_started.none();
+}
+
+/* nodes which were told to restart and are not yet reported complete */
+struct pending_restart_s {
+    chrono::steady_clock::time_point begin;
+    vector<node_restart_progress_s> progress;
+};
+
+static int begin_locked_restart(ndb_connection_context_s& ndb_ctx,
+    const vector<int>& node_ids, bool ready, pending_restart_s& pending)
 {
     int ret = 0;
     int disconnect = 0;
-    int cnt = 1;
-    int nodes[1] = { node_id };
-    int initial = 0;
+    int cnt = (int)node_ids.size();
+    int initial = ndb_ctx.initial_restart ? 1 : 0;
     int nostart = 0;
     int abort = 0;
     int force = 0;
 
-    cout << "ndb_mgm_restart4 node " << nodes[0] << endl;
+    assert(cnt);
+
+    ndb_api_s& api = get_ndb_api(ndb_ctx);
+
+    if (ready && !nodes_started(ndb_ctx, node_ids)) {
+        /* the preflight ran while the wave before was still going */
+        ready = false;
+    }
+    if (!ready && loop_wait_until_ready(ndb_ctx, node_ids, nullptr)) {
+        return 1;
+    }
+    if (wait_live_replicas(ndb_ctx, node_ids)) {
+        return 1;
+    }
+    if (ndb_ctx.hooks
+        && run_restart_hook(ndb_ctx, ndb_ctx.hooks->pre_wave, "pre_wave",
+            node_ids)) {
+        /* the traffic may still go to the nodes, they stay up */
+        return 1;
+    }
+
+    /* counted from here, so that a restart given up on before it is not
+       left in flight */
+    Cout(ndb_ctx) << "ndb_mgm_restart4" << (initial ? " initial" : "")
+                  << " node" << node_list(node_ids);
+    for (auto node_id : node_ids) {
+        emit_restart_event(ndb_ctx, RESTART_EVENT_NODE_BEGIN, node_id,
+            initial, "");
+    }
+
+    metrics_nodes_begin(ndb_ctx.metrics, cnt);
 
-    loop_wait_until_ready(ndb_ctx, nodes[0]);
+    pending.begin = chrono::steady_clock::now();
+    stats_nodes_begin(ndb_ctx.stats, cnt, pending.begin);
 
+    node_table_s& table = ndb_ctx.node_table;
+    node_mask_t nodes = node_mask(node_ids);
+
+    auto stop_begin = chrono::steady_clock::now();
     ret = -1;
     while (ret <= 0) {
-        ret = ndb_mgm_restart4(ndb_ctx.ndb_mgm_handle, cnt, nodes, initial,
-            nostart, abort, force, &disconnect);
+        ret = api.restart4(ndb_ctx, cnt, node_ids.data(), initial, nostart,
+            abort, force, &disconnect);
+        if (ret <= 0 && api.aborted()) {
+            return 1;
+        }
         if (ret <= 0) {
-            cout << __FILE__ << ":" << __LINE__
-                 << ": ndb_mgm_restart4 node " << nodes[0]
-                 << " returned error: " << ret << endl;
-            sleep_reconnect(ndb_ctx);
+            Cerr(ndb_ctx) << "ndb_mgm_restart4 node" << node_list(node_ids)
+                          << " returned error: " << ret;
+            metrics_count(ndb_ctx.metrics, METRICS_RESTART_RETRIES);
+            sleep_reconnect(ndb_ctx, nullptr);
+        } else if (ret != cnt) {
+            Cerr(ndb_ctx) << "ndb_mgm_restart4 restarted " << ret << " of "
+                          << cnt << " nodes";
         }
     }
 
+    auto restart_begin = chrono::steady_clock::now();
+    table.in_flight |= nodes;
+    pending.progress.clear();
+    for (auto node_id : node_ids) {
+        trace_add_span(ndb_ctx.trace, "ndb_mgm_restart4", "stop", node_id,
+            stop_begin, restart_begin);
+        int connect_count;
+        int node_group = get_node_group(ndb_ctx, node_id, &connect_count);
+        pending.progress.emplace_back(node_restart_progress_s{ node_id,
+            node_group, connect_count, false, NDB_MGM_NODE_STATUS_UNKNOWN, 0,
+            restart_begin, restart_begin });
+    }
+
     if (disconnect) {
-        sleep_reconnect(ndb_ctx);
+        sleep_reconnect(ndb_ctx, &pending.progress);
     }
+    return 0;
+}
 
-    if (ndb_ctx.wait_after_restart) {
-        loop_wait_until_ready(ndb_ctx, nodes[0]);
+/* ready is true if the nodes were checked by a preflight, the wait
+   before the restart is then skipped if a fresh status still shows
+   the nodes STARTED, the host slots are held until
+   finish_restart. recovering are the nodes still recovering from
+   earlier restarts, if any. */
+static int begin_restart(ndb_connection_context_s& ndb_ctx,
+    const vector<int>& node_ids, bool ready, pending_restart_s& pending,
+    vector<node_restart_progress_s>* recovering)
+{
+    if (lock_restart_hosts(ndb_ctx, node_ids, recovering)) {
+        return 1;
+    }
+    if (begin_locked_restart(ndb_ctx, node_ids, ready, pending)) {
+        unlock_restart_hosts(ndb_ctx, node_ids);
+        return 1;
+    }
+    return 0;
+}
+
+static void finish_restart(ndb_connection_context_s& ndb_ctx,
+    const pending_restart_s& pending)
+{
+    assert(pending.progress.size());
+
+    auto end = chrono::steady_clock::now();
+    auto restart_begin = pending.progress.front().restart_begin;
+    auto restart_ms = chrono::duration_cast<chrono::milliseconds>(
+        end - restart_begin);
+    vector<int> node_ids;
+    for (const auto& node : pending.progress) {
+        node_ids.push_back(node.node_id);
+        metrics_node_done(ndb_ctx.metrics, restart_ms.count());
+        stats_node_done(ndb_ctx.stats, node.node_id, node.node_group,
+            restart_ms.count(), end);
+        emit_restart_event(ndb_ctx, RESTART_EVENT_NODE_DONE, node.node_id,
+            restart_ms.count(), "");
+        record_restart_phase(ndb_ctx, node, end);
+        trace_add_span(ndb_ctx.trace,
+            ndb_ctx.initial_restart ? "initial restart" : "restart",
+            "restart", node.node_id, pending.begin, end);
+        epochs_node_restarted(ndb_ctx.epochs, node.node_id, time(nullptr));
+        report_copy_progress(ndb_ctx, node.node_id, end, true);
+    }
+    node_mask_t nodes = node_mask(node_ids);
+    ndb_ctx.node_table.in_flight &= ~nodes;
+    ndb_ctx.node_table.done |= nodes;
+    unlock_restart_hosts(ndb_ctx, node_ids);
+
+    auto elapsed = chrono::duration_cast<chrono::seconds>(
+        end - restart_begin);
+    Cout(ndb_ctx) << "restart node" << node_list(node_ids) << " complete ("
+                  << elapsed.count() << "s)";
+    if (ndb_ctx.hooks && ndb_ctx.wait_after_restart) {
+        /* the nodes are up, a failure is reported but changes nothing,
+           without wait_after_restart they may not be, so it is skipped */
+        run_restart_hook(ndb_ctx, ndb_ctx.hooks->post_wave, "post_wave",
+            node_ids);
+    }
+}
+
+static int restart_nodes_ready(ndb_connection_context_s& ndb_ctx,
+    const vector<int>& node_ids, bool ready)
+{
+    pending_restart_s pending;
+    if (begin_restart(ndb_ctx, node_ids, ready, pending, nullptr)) {
+        return 1;
     }
 
-    cout << "restart node " << nodes[0] << " complete" << endl;
+    if (ndb_ctx.wait_after_restart
+        && loop_wait_until_ready(ndb_ctx, node_ids, &pending.progress)) {
+        return 1;
+    }
+
+    finish_restart(ndb_ctx, pending);
+    return 0;
+}
+
+/* A restarted node no longer holds up the next restart once it is
+   STARTED again, or, if it is not in one of the next node groups, once
+   it reached ready_start_phase. A node group of -1 is unknown and
+   counts as every node group. next_group_nodes are the nodes of the
+   next node groups, see node_table_group_nodes. */
+static bool restart_is_ready(ndb_connection_context_s& ndb_ctx,
+    const node_restart_progress_s& node, const node_mask_t& next_group_nodes)
+{
+    if (!node.went_down) {
+        return false;
+    }
+    if (node.node_status == NDB_MGM_NODE_STATUS_STARTED) {
+        return true;
+    }
+    if (node.node_group == -1
+        || node_mask_test(next_group_nodes, node.node_id)) {
+        return false;
+    }
+    return node.node_status == NDB_MGM_NODE_STATUS_STARTING
+        && node.start_phase >= ndb_ctx.ready_start_phase;
+}
+
+/* polls the recovering nodes until the nodes of next_group_nodes may
+   go down, nodes which are STARTED again are reported complete and
+   removed, returns 1 if the management server is gone */
+static int wait_restarts_ready(ndb_connection_context_s& ndb_ctx,
+    vector<node_restart_progress_s>& recovering,
+    const node_mask_t& next_group_nodes, bool all_started)
+{
+    ndb_api_s& api = get_ndb_api(ndb_ctx);
+    bool first = true;
+    int lost = 0;
+    while (!recovering.empty()) {
+        if (!first) {
+            api.sleep(ndb_ctx, chrono::seconds(1));
+        }
+        first = false;
+
+        if (update_restart_progress(ndb_ctx, recovering, false)) {
+            if (api.aborted()) {
+                return 1;
+            }
+            if (++lost > RESTART_STATUS_RETRIES) {
+                Cerr(ndb_ctx) << "no status from the management server,"
+                              << " giving up on node"
+                              << node_list(progress_node_ids(recovering));
+                return 1;
+            }
+            sleep_reconnect(ndb_ctx, &recovering);
+            continue;
+        }
+        lost = 0;
+        if (api.aborted()) {
+            return 1;
+        }
+
+        bool ready = true;
+        for (auto it = recovering.begin(); it != recovering.end();) {
+            if (it->went_down
+                && it->node_status == NDB_MGM_NODE_STATUS_STARTED) {
+                finish_restart(ndb_ctx,
+                    pending_restart_s{ it->restart_begin, { *it } });
+                it = recovering.erase(it);
+                continue;
+            }
+            if (all_started
+                || !restart_is_ready(ndb_ctx, *it, next_group_nodes)) {
+                ready = false;
+            }
+            ++it;
+        }
+        if (ready) {
+            return 0;
+        }
+    }
     return 0;
 }
 
+/* With ready_start_phase the next nodes go down as soon as the nodes
+   restarted before them are ready for it, the nodes which are still
+   recovering are kept in recovering. Otherwise each restart waits as
+   wait_after_restart says. */
+static int restart_nodes_pipelined(ndb_connection_context_s& ndb_ctx,
+    const vector<int>& node_ids, bool ready,
+    vector<node_restart_progress_s>& recovering)
+{
+    if (!ndb_ctx.wait_after_restart || !ndb_ctx.ready_start_phase) {
+        return restart_nodes_ready(ndb_ctx, node_ids, ready);
+    }
+
+    node_mask_t next_group_nodes = node_table_group_nodes(ndb_ctx.node_table,
+        node_mask(node_ids));
+    if (wait_restarts_ready(ndb_ctx, recovering, next_group_nodes, false)) {
+        return 1;
+    }
+
+    pending_restart_s pending;
+    if (begin_restart(ndb_ctx, node_ids, ready, pending, &recovering)) {
+        return 1;
+    }
+    recovering.insert(recovering.end(), pending.progress.begin(),
+        pending.progress.end());
+    return 0;
+}
+
+int restart_nodes(ndb_connection_context_s& ndb_ctx,
+    const vector<int>& node_ids)
+{
+    return restart_nodes_ready(ndb_ctx, node_ids, false);
+}
+
+int restart_node(ndb_connection_context_s& ndb_ctx, int node_id)
+{
+    return restart_nodes(ndb_ctx, vector<int>{ node_id });
+}
+
 void sort_node_restarts(std::vector<restart_node_status_s>& nodes)
 {
     //Build a multimap so that different index fall into different group
@@ -263,6 +884,26 @@ void sort_node_restarts(std::vector<restart_node_status_s>& nodes)
     sorted_nodes.swap(nodes);
 }
 
+vector<vector<restart_node_status_s>> get_restart_waves(
+    const vector<restart_node_status_s>& sorted_nodes)
+{
+    // the n-th pending node of a node group goes into the n-th wave, so
+    // nodes which were already restarted do not cost an extra wave
+    vector<vector<restart_node_status_s>> waves;
+    map<int, size_t> group_pending;
+    for (const auto& node : sorted_nodes) {
+        if (node.was_restarted) {
+            continue;
+        }
+        size_t wave = group_pending[node.node_group]++;
+        if (wave == waves.size()) {
+            waves.emplace_back();
+        }
+        waves[wave].push_back(node);
+    }
+    return waves;
+}
+
 vector<restart_node_status_s> get_node_restarts(
     ndb_mgm_cluster_state* cluster_state, size_t number_of_nodes)
 {
@@ -281,98 +922,447 @@ vector<restart_node_status_s> get_node_restarts(
 
 void report_cluster_state(ndb_connection_context_s& ndb_ctx)
 {
-    assert(ndb_ctx.connection);
     assert(ndb_ctx.cluster_state);
 
-    auto cluster_name = ndb_ctx.connection->get_system_name();
-    cout << "cluster_name: " << cluster_name << endl;
-    cout << "cluster_state->no_of_nodes: "
-         << ndb_ctx.cluster_state->no_of_nodes << endl;
+    trace_span_s span(ndb_ctx.trace, "report_cluster_state", "report",
+        TRACE_TRACK_ORCHESTRATOR);
 
-    for (int i = 0; i < ndb_ctx.cluster_state->no_of_nodes; ++i) {
+    auto cluster_name = get_ndb_api(ndb_ctx).get_system_name(ndb_ctx);
+    Cout(ndb_ctx) << "cluster_name: " << cluster_name;
+    Cout(ndb_ctx) << "cluster_state->no_of_nodes: "
+                  << ndb_ctx.cluster_state->no_of_nodes;
+
+    vector<node_snapshot_s> nodes;
+    vector<node_change_s> changes;
+    get_node_snapshots(ndb_ctx.cluster_state, nodes);
+    diff_node_snapshots(ndb_ctx.snapshot.reported, nodes, changes);
+    ndb_ctx.snapshot.reported.swap(nodes);
+
+    set<int> changed;
+    for (const auto& change : changes) {
+        if (!(change.changes & NODE_CHANGE_REMOVED)) {
+            changed.insert(change.after.node_id);
+        }
+    }
+
+    /* the status of a selected node changes as it is restarted, so the
+       report leaves out only the nodes which are not targeted at all */
+    node_selection_s targeted;
+    if (ndb_ctx.selection) {
+        targeted = *ndb_ctx.selection;
+        targeted.status_mask = 0;
+    }
 
+    vector<int> reported;
+    map<int, ndb_mgm_node_state> reported_states;
+    for (int i = 0; i < ndb_ctx.cluster_state->no_of_nodes; ++i) {
         auto node_state = ndb_ctx.cluster_state->node_states[i];
+        if (changed.count(node_state.node_id)
+            && node_selected(targeted, node_state)) {
+            reported.push_back(node_state.node_id);
+            reported_states[node_state.node_id] = node_state;
+        }
+    }
 
-        cout << "node_id: " << node_state.node_id << " ("
-             << ndb_mgm_get_node_type_string(node_state.node_type) << ")"
-             << endl
-             << "\tstatus: " << node_state.node_status << " ("
-             << ndb_mgm_get_node_status_string(node_state.node_status)
-             << ")" << endl;
+    /* with an executor the dump states are fetched in parallel */
+    mutex dump_states_lock;
+    map<int, string> dump_states;
+    executor_for_each_node(ndb_ctx.executor, ndb_ctx, reported,
+        [&](ndb_connection_context_s& node_ctx, int node_id,
+            int connect_err) {
+            string dump_state = "could not connect";
+            if (!connect_err) {
+                trace_span_s dump_span(node_ctx.trace, "ndb_mgm_dump_state",
+                    "report", node_id);
+                dump_state = get_ndb_mgm_dump_state(node_ctx,
+                    reported_states.at(node_id));
+            }
+            lock_guard<mutex> guard(dump_states_lock);
+            dump_states[node_id] = dump_state;
+        });
+
+    for (auto node_id : reported) {
+        const ndb_mgm_node_state& node_state = reported_states[node_id];
+
+        log_line_s line(ndb_ctx, RESTART_EVENT_LOG, node_state.node_id);
+        line.out << "node_id: " << node_state.node_id << " ("
+                 << ndb_mgm_get_node_type_string(node_state.node_type) << ")"
+                 << endl
+                 << "\tstatus: " << node_state.node_status << " ("
+                 << ndb_mgm_get_node_status_string(node_state.node_status)
+                 << ")" << endl;
 
         if ((node_state.node_type == NDB_MGM_NODE_TYPE_NDB)
             && (node_state.node_status == NDB_MGM_NODE_STATUS_STARTING)) {
-            cout << "\tstart_phase: " << node_state.start_phase
-                 << endl;
+            line.out << "\tstart_phase: " << node_state.start_phase
+                     << endl;
         }
 
-        cout << "\tdynamic_id: " << node_state.dynamic_id << endl
-             << "\tnode_group: " << node_state.node_group << endl
-             << "\tversion: " << node_state.version << endl
-             << "\tmysql_version: " << node_state.mysql_version << endl
-             << "\tconnect_count: " << node_state.connect_count << endl
-             << "\tconnect_address: " << node_state.connect_address << endl
-             << "\tndb_mgm_dump_state: "
-             << get_ndb_mgm_dump_state(ndb_ctx.ndb_mgm_handle, node_state)
-             << endl;
+        line.out << "\tdynamic_id: " << node_state.dynamic_id << endl
+                 << "\tnode_group: " << node_state.node_group << endl
+                 << "\tversion: " << node_state.version << endl
+                 << "\tmysql_version: " << node_state.mysql_version << endl
+                 << "\tconnect_count: " << node_state.connect_count << endl
+                 << "\tconnect_address: " << node_state.connect_address
+                 << endl
+                 << "\tndb_mgm_dump_state: " << dump_states[node_id];
     }
 
-    int online_nodes = get_online_node_count(ndb_ctx.cluster_state);
+    metrics_update_live_replicas(ndb_ctx.metrics, ndb_ctx.cluster_state);
+
+    int online_nodes = get_online_node_count(ndb_ctx.node_table);
 
     int offline_nodes = (ndb_ctx.cluster_state->no_of_nodes - online_nodes);
 
-    cout << "no_of_nodes: " << ndb_ctx.cluster_state->no_of_nodes << endl
-         << "online_nodes: " << online_nodes << endl
-         << "offline_nodes: " << offline_nodes << endl;
+    log_line_s line(ndb_ctx, RESTART_EVENT_LOG, 0);
+    line.out << "no_of_nodes: " << ndb_ctx.cluster_state->no_of_nodes << endl
+             << "online_nodes: " << online_nodes << endl
+             << "offline_nodes: " << offline_nodes;
+    size_t unchanged = ndb_ctx.cluster_state->no_of_nodes - changed.size();
+    if (unchanged) {
+        line.out << endl
+                 << "unchanged_nodes: " << unchanged;
+    }
 }
 
-int ndb_rolling_restart(ndb_connection_context_s& ndb_ctx)
+/* waits for the preflight of the next wave and logs its result */
+static bool preflight_passed(ndb_connection_context_s& ndb_ctx,
+    ndb_preflight_s& preflight)
+{
+    const preflight_result_s* result = preflight_finish(preflight);
+    if (!result) {
+        return false;
+    }
+    auto age = chrono::duration_cast<chrono::seconds>(
+        chrono::steady_clock::now() - result->checked);
+    if (age.count() > PREFLIGHT_MAX_AGE_SECONDS) {
+        Cout(ndb_ctx) << "preflight node" << node_list(result->node_ids)
+                      << ": too old (" << age.count() << "s ago), checked"
+                      << " again before the restart";
+        return false;
+    }
+    if (result->problems.empty()) {
+        Cout(ndb_ctx) << "preflight node" << node_list(result->node_ids)
+                      << ": ok (" << age.count() << "s ago)";
+        return true;
+    }
+    for (const auto& problem : result->problems) {
+        Cout(ndb_ctx) << "preflight " << problem;
+    }
+    return false;
+}
+
+/* the summary of the run, compared to the baseline of the cluster */
+static void report_run_stats(ndb_connection_context_s& ndb_ctx)
 {
-    ndb_init();
+    if (!ndb_ctx.stats) {
+        return;
+    }
 
-    int err = init_ndb_connection(ndb_ctx);
-    if (err) {
-        Cerr << "error connecting to ndb '" << ndb_ctx.connect_string << "'"
-             << endl;
-        return 1;
+    ndb_stats_s& stats = *ndb_ctx.stats;
+    stats_summary_s summary = summarize_stats(stats);
+    for (const auto& line : format_stats_summary(summary, 3)) {
+        Cout(ndb_ctx) << line;
     }
 
-    report_cluster_state(ndb_ctx);
+    auto values = stats_baseline_values(summary);
+    if (stats.baseline_path.empty() || values.empty()) {
+        return;
+    }
+    map<string, map<string, uint64_t>> baselines;
+    if (read_stats_baselines(stats.baseline_path, baselines)) {
+        Cerr(ndb_ctx) << "could not read baselines '" << stats.baseline_path
+                      << "'";
+        return;
+    }
+    string cluster_name = get_ndb_api(ndb_ctx).get_system_name(ndb_ctx);
+    auto found = baselines.find(cluster_name);
+    if (found == baselines.end()) {
+        Cout(ndb_ctx) << "no baseline for " << cluster_name << " yet";
+    } else {
+        auto warnings = compare_stats_baseline(found->second, values,
+            stats.regression_threshold, stats.regression_min_ms);
+        for (const auto& warning : warnings) {
+            Cerr(ndb_ctx) << "warning: " << warning;
+        }
+        if (warnings.empty()) {
+            Cout(ndb_ctx) << "no regressions against the baseline";
+        }
+    }
+    baselines[cluster_name] = values;
+    if (write_stats_baselines(stats.baseline_path, baselines)) {
+        Cerr(ndb_ctx) << "could not write baselines '" << stats.baseline_path
+                      << "'";
+    }
+}
 
-    if (ndb_ctx.cluster_state->no_of_nodes < 1) {
-        Cerr << "cluster_state->no_of_nodes == "
-             << ndb_ctx.cluster_state->no_of_nodes << " ?" << endl;
-        close_ndb_connection(ndb_ctx);
-        return EXIT_FAILURE;
+/* drops the nodes which restarted since they were planned */
+static vector<int> unrestarted_nodes(ndb_connection_context_s& ndb_ctx,
+    const vector<restart_node_status_s>& wave_nodes)
+{
+    vector<int> node_ids;
+    for (const auto& node : wave_nodes) {
+        int connect_count;
+        get_node_group(ndb_ctx, node.node_id, &connect_count);
+        string reason;
+        if (epochs_skip_node(ndb_ctx.epochs, node.node_id, connect_count,
+                &reason)) {
+            Cnode(ndb_ctx, node.node_id) << "skipping node " << node.node_id
+                                         << ", " << reason;
+            continue;
+        }
+        node_ids.push_back(node.node_id);
     }
+    return node_ids;
+}
 
+vector<restart_node_status_s> get_selected_node_restarts(
+    ndb_connection_context_s& ndb_ctx)
+{
     auto number_of_nodes = (size_t)ndb_ctx.cluster_state->no_of_nodes;
     auto node_restarts = get_node_restarts(ndb_ctx.cluster_state,
         number_of_nodes);
 
     assert(number_of_nodes == node_restarts.size());
 
-    sort_node_restarts(node_restarts);
+    if (ndb_ctx.selection) {
+        auto selected = select_nodes(*ndb_ctx.selection,
+            ndb_ctx.cluster_state);
+        node_restarts.erase(remove_if(node_restarts.begin(),
+                                node_restarts.end(),
+                                [&selected](const restart_node_status_s& node) {
+                                    return !selected.count(node.node_id);
+                                }),
+            node_restarts.end());
+        Cout(ndb_ctx) << "selected " << node_restarts.size() << " of "
+                      << number_of_nodes << " nodes";
+    }
+
+    if (ndb_ctx.epochs) {
+        epochs_run_begin(ndb_ctx.epochs, ndb_ctx.cluster_state, time(nullptr));
+        for (auto& node : node_restarts) {
+            string reason;
+            if (epochs_skip_node(ndb_ctx.epochs, node.node_id, -1, &reason)) {
+                Cnode(ndb_ctx, node.node_id) << "skipping node "
+                                             << node.node_id << ", " << reason;
+                node.was_restarted = true;
+            }
+        }
+    }
+    return node_restarts;
+}
+
+/* the nodes of the plan from node i of wave w on */
+static vector<int> remaining_nodes(
+    const vector<vector<restart_node_status_s>>& waves, size_t w, size_t i)
+{
+    vector<int> node_ids;
+    for (; w < waves.size(); ++w, i = 0) {
+        for (; i < waves[w].size(); ++i) {
+            node_ids.push_back(waves[w][i].node_id);
+        }
+    }
+    return node_ids;
+}
+
+static restart_control_e get_restart_control(
+    ndb_connection_context_s& ndb_ctx)
+{
+    return get_restart_control(ndb_ctx.cancel, ndb_ctx.pause,
+        ndb_ctx.control_file);
+}
 
-    size_t restarted = 0;
-    int last_group = -1;
-    for (size_t i = 0; restarted < number_of_nodes; ++i) {
-        if (i >= number_of_nodes) {
-            i = 0;
-            last_group = -1;
+/* Between restarts, returns true if the rollout is cancelled, or the
+   backend aborted or lost the nodes still recovering. While paused the
+   nodes still recovering are finished first, then the control is asked
+   again every second. */
+static bool stop_at_safe_point(ndb_connection_context_s& ndb_ctx,
+    vector<node_restart_progress_s>& recovering, const string& where,
+    const vector<int>& remaining)
+{
+    ndb_api_s& api = get_ndb_api(ndb_ctx);
+    restart_control_e control = get_restart_control(ndb_ctx);
+    if (control == RESTART_CONTROL_PAUSE) {
+        if (wait_restarts_ready(ndb_ctx, recovering, node_mask_t(), true)) {
+            return true;
+        }
+        Cout(ndb_ctx) << "paused " << where << ", remaining node"
+                      << node_list(remaining);
+        trace_span_s span(ndb_ctx.trace, "paused", "control",
+            TRACE_TRACK_ORCHESTRATOR);
+        auto pause_begin = chrono::steady_clock::now();
+        while (control == RESTART_CONTROL_PAUSE) {
+            api.sleep(ndb_ctx, chrono::seconds(1));
+            if (api.aborted()) {
+                return true;
+            }
+            control = get_restart_control(ndb_ctx);
         }
-        if ((node_restarts[i].node_group != last_group)
-            && !node_restarts[i].was_restarted) {
-            ++restarted;
-            node_restarts[i].was_restarted = true;
-            last_group = node_restarts[i].node_group;
-            restart_node(ndb_ctx, node_restarts[i].node_id);
+        auto paused = chrono::duration_cast<chrono::seconds>(
+            chrono::steady_clock::now() - pause_begin);
+        if (control == RESTART_CONTROL_RUN) {
+            Cout(ndb_ctx) << "resumed after " << paused.count() << "s";
         }
     }
+    if (control == RESTART_CONTROL_CANCEL) {
+        Cout(ndb_ctx) << "cancelled " << where << ", not restarted: node"
+                      << node_list(remaining);
+        wait_restarts_ready(ndb_ctx, recovering, node_mask_t(), true);
+        return true;
+    }
+    return false;
+}
+
+static int rolling_restart(ndb_connection_context_s& ndb_ctx)
+{
+    int err = init_ndb_connection(ndb_ctx);
+    if (err) {
+        Cerr(ndb_ctx) << "error connecting to ndb '" << ndb_ctx.connect_string
+                      << "'";
+        return 1;
+    }
 
     report_cluster_state(ndb_ctx);
 
+    if (ndb_ctx.cluster_state->no_of_nodes < 1) {
+        Cerr(ndb_ctx) << "cluster_state->no_of_nodes == "
+                      << ndb_ctx.cluster_state->no_of_nodes << " ?";
+        close_ndb_connection(ndb_ctx);
+        return EXIT_FAILURE;
+    }
+
+    auto node_restarts = get_selected_node_restarts(ndb_ctx);
+    if (node_restarts.empty()) {
+        close_ndb_connection(ndb_ctx);
+        return 0;
+    }
+
+    vector<vector<restart_node_status_s>> waves;
+    uint64_t fingerprint = 0;
+    if (!ndb_ctx.plan_cache.empty()) {
+        fingerprint = topology_fingerprint(ndb_ctx.cluster_state,
+            node_restarts, ndb_ctx.schedule ? ndb_ctx.schedule->name() : "");
+        if (read_plan_cache(ndb_ctx.plan_cache, fingerprint, waves) == 0) {
+            Cout(ndb_ctx) << "cached plan for topology "
+                          << fingerprint_hex(fingerprint);
+        }
+    }
+    if (waves.empty()) {
+        if (ndb_ctx.schedule) {
+            Cout(ndb_ctx) << "schedule: " << ndb_ctx.schedule->name();
+            auto nodes = get_schedule_nodes(ndb_ctx.cluster_state,
+                node_restarts);
+            if (ndb_ctx.stats) {
+                /* the restart times of the last runs, as in a dry run */
+                set_expected_seconds(nodes,
+                    read_cluster_baseline(ndb_ctx,
+                        ndb_ctx.stats->baseline_path));
+            }
+            waves = ndb_ctx.schedule->plan(nodes);
+        } else {
+            sort_node_restarts(node_restarts);
+            waves = get_restart_waves(node_restarts);
+        }
+        if (!ndb_ctx.plan_cache.empty() && !waves.empty()
+            && write_plan_cache(ndb_ctx.plan_cache, fingerprint, waves)) {
+            Cerr(ndb_ctx) << "could not write plan cache '"
+                          << ndb_ctx.plan_cache << "'";
+        }
+    }
+    size_t planned = 0;
+    for (const auto& wave : waves) {
+        planned += wave.size();
+    }
+    metrics_plan(ndb_ctx.metrics, planned, waves.size());
+    emit_restart_event(ndb_ctx, RESTART_EVENT_PLAN, 0, planned, "");
+    ndb_preflight_s preflight;
+    bool wave_ready = false;
+    vector<node_restart_progress_s> recovering;
+    for (size_t w = 0; w < waves.size(); ++w) {
+        if (stop_at_safe_point(ndb_ctx, recovering,
+                "before wave " + to_string(w + 1),
+                remaining_nodes(waves, w, 0))) {
+            close_ndb_connection(ndb_ctx);
+            return 1;
+        }
+        ndb_ctx.current_wave = w + 1;
+        Cout(ndb_ctx) << "wave " << (w + 1) << " of " << waves.size();
+        emit_restart_event(ndb_ctx, RESTART_EVENT_WAVE_BEGIN, 0,
+            waves[w].size(), "");
+        metrics_wave_begin(ndb_ctx.metrics, w + 1);
+        trace_span_s span(ndb_ctx.trace, "wave " + to_string(w + 1), "wave",
+            TRACE_TRACK_ORCHESTRATOR);
+        if (ndb_ctx.preflight_next_wave && w + 1 < waves.size()
+            && ndb_ctx.cluster_state
+            && preflight_begin(preflight, ndb_ctx, waves[w + 1])) {
+            Cerr(ndb_ctx) << "could not start preflight of wave " << (w + 2);
+        }
+        if (ndb_ctx.parallel_node_groups) {
+            vector<int> node_ids = unrestarted_nodes(ndb_ctx, waves[w]);
+            if (node_ids.size()
+                && restart_nodes_pipelined(ndb_ctx, node_ids, wave_ready,
+                    recovering)) {
+                close_ndb_connection(ndb_ctx);
+                return 1;
+            }
+        } else {
+            for (size_t i = 0; i < waves[w].size(); ++i) {
+                if (i
+                    && stop_at_safe_point(ndb_ctx, recovering,
+                        "in wave " + to_string(w + 1),
+                        remaining_nodes(waves, w, i))) {
+                    close_ndb_connection(ndb_ctx);
+                    return 1;
+                }
+                vector<int> node_ids = unrestarted_nodes(ndb_ctx,
+                    vector<restart_node_status_s>{ waves[w][i] });
+                if (node_ids.empty()) {
+                    continue;
+                }
+                if (restart_nodes_pipelined(ndb_ctx, node_ids, wave_ready,
+                        recovering)) {
+                    close_ndb_connection(ndb_ctx);
+                    return 1;
+                }
+                /* only the first restart of a wave follows the preflight */
+                wave_ready = false;
+            }
+        }
+        wave_ready = preflight_passed(ndb_ctx, preflight);
+    }
+
+    if (wait_restarts_ready(ndb_ctx, recovering, node_mask_t(), true)) {
+        close_ndb_connection(ndb_ctx);
+        return 1;
+    }
+
+    if (refresh_cluster_state(ndb_ctx) == 0) {
+        report_cluster_state(ndb_ctx);
+    }
+    report_run_stats(ndb_ctx);
+
     close_ndb_connection(ndb_ctx);
-    ndb_end(NDB_NORMAL_USER);
     return 0;
 }
+
+int ndb_rolling_restart(ndb_connection_context_s& ndb_ctx)
+{
+    int rv = rolling_restart(ndb_ctx);
+    emit_restart_event(ndb_ctx, RESTART_EVENT_FINISHED, 0, rv, "");
+    return rv;
+}
+
+int ndb_rolling_restart_status(ndb_connection_context_s& ndb_ctx)
+{
+    int rv = 0;
+    if (init_ndb_connection(ndb_ctx)) {
+        Cerr(ndb_ctx) << "error connecting to ndb '" << ndb_ctx.connect_string
+                      << "'";
+        rv = 1;
+    } else {
+        report_cluster_state(ndb_ctx);
+        close_ndb_connection(ndb_ctx);
+    }
+    emit_restart_event(ndb_ctx, RESTART_EVENT_FINISHED, 0, rv, "");
+    return rv;
+}
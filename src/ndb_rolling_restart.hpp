@@ -18,11 +18,47 @@
 
 #include <mgmapi/mgmapi.h> // typedef struct ndb_mgm_handle * NdbMgmHandle;
 #include <ndbapi/NdbApi.hpp> // class Ndb_cluster_connection
+#include "ndb_rolling_restart_node_table.hpp"
+#include "ndb_rolling_restart_snapshot.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <string>
 #include <vector>
 
 #define NDB_NORMAL_USER 0
 
+struct ndb_api_s;
+struct ndb_trace_s;
+struct ndb_metrics_s;
+struct ndb_stats_s;
+struct node_selection_s;
+struct restart_epochs_s;
+struct ndb_schedule_policy_s;
+struct ndb_executor_s;
+struct ndb_copy_monitor_s;
+struct ndb_wave_hooks_s;
+struct ndb_host_locks_s;
+
+enum restart_event_type_e {
+    RESTART_EVENT_LOG = 0, /* informational message */
+    RESTART_EVENT_ERROR, /* error message */
+    RESTART_EVENT_PLAN, /* value: number of nodes to restart */
+    RESTART_EVENT_WAVE_BEGIN, /* value: number of nodes in the wave */
+    RESTART_EVENT_NODE_BEGIN,
+    RESTART_EVENT_NODE_PHASE, /* value: start phase, message: status */
+    RESTART_EVENT_NODE_DONE, /* value: restart duration in ms */
+    RESTART_EVENT_FINISHED /* value: return code of ndb_rolling_restart */
+};
+
+struct restart_event_s {
+    restart_event_type_e type;
+    int node_id; /* 0 if the event is not about a single node */
+    unsigned wave; /* 1 based, 0 before the first wave */
+    long long value;
+    std::string message;
+};
+
 struct ndb_connection_context_s {
     std::string connect_string;
     unsigned wait_seconds = 30;
@@ -30,9 +66,67 @@ struct ndb_connection_context_s {
        failure to wait after restart can be fatal:
        https://pastebin.com/raw/1mxgb99s */
     bool wait_after_restart = true;
-    Ndb_cluster_connection* connection;
-    NdbMgmHandle ndb_mgm_handle; /* a ptr */
-    ndb_mgm_cluster_state* cluster_state;
+    /* if not 0, the next node may go down once the nodes restarted before
+       it reached this start phase, but nodes in the node group of the
+       next node must have finished copying data and be STARTED */
+    int ready_start_phase = 0;
+    /* an initial restart discards the node file system and copies all
+       data from the node group partner, this is required for some
+       upgrades, e.g.: 7.5 to 7.6 */
+    bool initial_restart = false;
+    /* restart one node of every node group at the same time */
+    bool parallel_node_groups = false;
+    /* check the next wave on a second connection while the current wave
+       recovers, if it passes the next wave is restarted without waiting */
+    bool preflight_next_wave = false;
+    ndb_api_s* api = nullptr; /* optional, not owned, live NDB if null */
+    ndb_trace_s* trace = nullptr; /* optional, not owned */
+    ndb_metrics_s* metrics = nullptr; /* optional, not owned */
+    /* summarized at the end, see ndb_rolling_restart_stats.hpp */
+    ndb_stats_s* stats = nullptr; /* optional, not owned */
+    /* only the selected nodes are restarted, all nodes if null */
+    const node_selection_s* selection = nullptr; /* not owned */
+    /* if set, nodes which already restarted are skipped and the restart
+       of each node is recorded, see ndb_rolling_restart_epochs.hpp */
+    restart_epochs_s* epochs = nullptr; /* optional, not owned */
+    /* the order of the restarts, round robin over the node groups if
+       null, see ndb_rolling_restart_schedule.hpp */
+    const ndb_schedule_policy_s* schedule = nullptr; /* not owned */
+    /* if set, the plan is kept in this file and reused while the
+       topology fingerprint stays the same */
+    std::string plan_cache;
+    /* runs per-node MGM operations on a pool of connections, all on
+       the one connection if null */
+    ndb_executor_s* executor = nullptr; /* optional, not owned */
+    /* reports the data copy of recovering nodes, see
+       ndb_rolling_restart_copy_progress.hpp */
+    ndb_copy_monitor_s* copy_monitor = nullptr; /* optional, not owned */
+    /* run around each ndb_mgm_restart4, see
+       ndb_rolling_restart_hooks.hpp */
+    const ndb_wave_hooks_s* hooks = nullptr; /* optional, not owned */
+    /* limits the recovering nodes per host across the orchestrators of
+       clusters which share hosts, see ndb_rolling_restart_host_locks.hpp */
+    ndb_host_locks_s* host_locks = nullptr; /* optional, not owned */
+    /* all output is passed here, nothing is written to stdout directly */
+    std::function<void(const restart_event_s&)> on_event;
+    /* checked between restarts, nodes already restarting are finished */
+    std::atomic<bool>* cancel = nullptr; /* optional, not owned */
+    /* while set no further node goes down, checked as cancel is */
+    std::atomic<bool>* pause = nullptr; /* optional, not owned */
+    /* if set, read as cancel and pause are, it may say "pause",
+       "resume" or "cancel", see ndb_rolling_restart_control.hpp */
+    std::string control_file;
+    unsigned current_wave = 0;
+    /* to the data nodes, only made when a call needs it */
+    Ndb_cluster_connection* connection = nullptr;
+    NdbMgmHandle ndb_mgm_handle = nullptr; /* a ptr */
+    /* fetched once per connection by get_system_name, empty until then */
+    std::string system_name;
+    ndb_mgm_cluster_state* cluster_state = nullptr;
+    /* every status poll is sampled here, only changes are logged */
+    cluster_snapshot_s snapshot;
+    /* the latest status poll, for lookups which do not scan it */
+    node_table_s node_table;
 };
 
 struct restart_node_status_s {
@@ -41,19 +135,66 @@ struct restart_node_status_s {
     bool was_restarted;
 };
 
+/* tracks a restarting node through its start phases, the later phases
+   copy data from the node group partner and can take a long time */
+struct node_restart_progress_s {
+    int node_id;
+    int node_group;
+    int connect_count; /* before the restart */
+    bool went_down; /* seen not STARTED, or reconnected */
+    ndb_mgm_node_status node_status;
+    int start_phase;
+    std::chrono::steady_clock::time_point restart_begin;
+    std::chrono::steady_clock::time_point phase_begin;
+};
+
 void close_ndb_connection(ndb_connection_context_s& ndb_ctx);
 
 int init_ndb_connection(ndb_connection_context_s& ndb_ctx);
 
 int restart_node(ndb_connection_context_s& ndb_ctx, int node_id);
 
+int restart_nodes(ndb_connection_context_s& ndb_ctx,
+    const std::vector<int>& node_ids);
+
 void sort_node_restarts(std::vector<restart_node_status_s>& nodes);
 
+/* splits sorted nodes into waves with at most one node per node group,
+   nodes which were already restarted are left out */
+std::vector<std::vector<restart_node_status_s>> get_restart_waves(
+    const std::vector<restart_node_status_s>& sorted_nodes);
+
 std::vector<restart_node_status_s> get_node_restarts(
     ndb_mgm_cluster_state* cluster_state, size_t number_of_nodes);
 
+/* the nodes of the cluster_state of ndb_ctx to restart, only those of
+   the selection, nodes which already restarted are marked so */
+std::vector<restart_node_status_s> get_selected_node_restarts(
+    ndb_connection_context_s& ndb_ctx);
+
+/* returns "ok" or the reason the dump state failed */
+const std::string get_ndb_mgm_dump_state(ndb_connection_context_s& ndb_ctx,
+    ndb_mgm_node_state node_state);
+
+/* replaces cluster_state with a fresh one */
+int refresh_cluster_state(ndb_connection_context_s& ndb_ctx);
+
+/* Polls once a second, for at most wait_seconds, until none of the
+   nodes is the last live replica of its node group, as the management
+   server would refuse to stop it. Returns 1 if one still is, or the
+   rollout was cancelled meanwhile. */
+int wait_live_replicas(ndb_connection_context_s& ndb_ctx,
+    const std::vector<int>& node_ids);
+
+/* reports the nodes which changed since the last report, all nodes the
+   first time */
 void report_cluster_state(ndb_connection_context_s& ndb_ctx);
 
+/* the caller is responsible for ndb_init() and ndb_end() */
 int ndb_rolling_restart(ndb_connection_context_s& ndb_ctx);
 
+/* reports the cluster state and restarts nothing, only the management
+   server is asked, so it does not wait for the data nodes */
+int ndb_rolling_restart_status(ndb_connection_context_s& ndb_ctx);
+
 #endif /* NDB_ROLLING_RESTART_HPP */
@@ -0,0 +1,215 @@
+/*
+ * ndb_rolling_restart_api
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_api.hpp"
+#include "ndb_rolling_restart_log.hpp"
+
+#include <mgmapi/mgmapi_config_parameters.h>
+
+#include <cassert>
+#include <thread>
+
+using namespace std;
+
+static Ndb_cluster_connection* ndb_connect(ndb_connection_context_s& ndb_ctx)
+{
+    const char* connect_string = ndb_ctx.connect_string.c_str();
+    unsigned wait_seconds = ndb_ctx.wait_seconds;
+    Ndb_cluster_connection* cluster_connection;
+
+    cluster_connection = new Ndb_cluster_connection(connect_string);
+    if (!cluster_connection) {
+        Cerr(ndb_ctx) << "new Ndb_cluster_connection() returned 0";
+        return nullptr;
+    }
+
+    int no_retries = 10;
+    int retry_delay_in_seconds = wait_seconds;
+    int verbose = 1;
+    cluster_connection->connect(no_retries, retry_delay_in_seconds, verbose);
+
+    int before_wait = wait_seconds;
+    int after_wait = wait_seconds;
+    if (cluster_connection->wait_until_ready(before_wait, after_wait) < 0) {
+        Cerr(ndb_ctx) << "Cluster was not ready within " << wait_seconds
+                      << " seconds";
+        delete (cluster_connection);
+        return nullptr;
+    }
+    return cluster_connection;
+}
+
+/* the data node connection waits for the data nodes, which can take
+   wait_seconds, so it is only made once a call needs it */
+static int connect_data_nodes(ndb_connection_context_s& ndb_ctx)
+{
+    if (!ndb_ctx.connection) {
+        ndb_ctx.connection = ndb_connect(ndb_ctx);
+    }
+    return ndb_ctx.connection ? 0 : 1;
+}
+
+/* the Name of the [system] section of the configuration, empty if the
+   management server did not send it */
+static string mgm_system_name(NdbMgmHandle handle)
+{
+    ndb_mgm_configuration* config = ndb_mgm_get_configuration(handle, 0);
+    if (!config) {
+        return "";
+    }
+    string name;
+    ndb_mgm_configuration_iterator* iter
+        = ndb_mgm_create_configuration_iterator(config, CFG_SECTION_SYSTEM);
+    const char* value = nullptr;
+    if (iter && ndb_mgm_first(iter) == 0
+        && ndb_mgm_get_string_parameter(iter, CFG_SYS_NAME, &value) == 0
+        && value) {
+        name = value;
+    }
+    if (iter) {
+        ndb_mgm_destroy_iterator(iter);
+    }
+    ndb_mgm_destroy_configuration(config);
+    return name;
+}
+
+int ndb_live_api_s::connect(ndb_connection_context_s& ndb_ctx)
+{
+    ndb_ctx.ndb_mgm_handle = ndb_mgm_create_handle();
+    if (!ndb_ctx.ndb_mgm_handle) {
+        Cerr(ndb_ctx) << "Error: ndb_mgm_create_handle returned null?";
+        return 1;
+    }
+
+    if (ndb_mgm_set_connectstring(ndb_ctx.ndb_mgm_handle,
+            ndb_ctx.connect_string.c_str())
+        != 0) {
+        Cerr(ndb_ctx) << "bad connect string '" << ndb_ctx.connect_string
+                      << "': "
+                      << ndb_mgm_get_latest_error_msg(ndb_ctx.ndb_mgm_handle);
+        disconnect(ndb_ctx);
+        return 1;
+    }
+
+    int no_retries = 10;
+    int retry_delay_secs = 3;
+    int verbose = 1;
+
+    int ret = ndb_mgm_connect(ndb_ctx.ndb_mgm_handle, no_retries,
+        retry_delay_secs, verbose);
+
+    if (ret != 0) {
+        Cerr(ndb_ctx) << "ndb_mgm_get_latest_error: "
+                      << ndb_mgm_get_latest_error_msg(ndb_ctx.ndb_mgm_handle);
+        disconnect(ndb_ctx);
+        return 1;
+    }
+    return 0;
+}
+
+void ndb_live_api_s::disconnect(ndb_connection_context_s& ndb_ctx)
+{
+    if (ndb_ctx.ndb_mgm_handle) {
+        ndb_mgm_destroy_handle(&(ndb_ctx.ndb_mgm_handle));
+        ndb_ctx.ndb_mgm_handle = nullptr;
+    }
+
+    if (ndb_ctx.connection) {
+        delete (ndb_ctx.connection);
+        ndb_ctx.connection = nullptr;
+    }
+    ndb_ctx.system_name.clear();
+}
+
+string ndb_live_api_s::get_system_name(ndb_connection_context_s& ndb_ctx)
+{
+    assert(ndb_ctx.ndb_mgm_handle);
+    /* the whole configuration is sent for it, so it is fetched once */
+    if (ndb_ctx.system_name.empty()) {
+        ndb_ctx.system_name = mgm_system_name(ndb_ctx.ndb_mgm_handle);
+    }
+    if (ndb_ctx.system_name.empty() && connect_data_nodes(ndb_ctx) == 0) {
+        ndb_ctx.system_name = ndb_ctx.connection->get_system_name();
+    }
+    return ndb_ctx.system_name;
+}
+
+ndb_mgm_cluster_state* ndb_live_api_s::get_status2(
+    ndb_connection_context_s& ndb_ctx, const ndb_mgm_node_type node_types[])
+{
+    assert(ndb_ctx.ndb_mgm_handle);
+    return ndb_mgm_get_status2(ndb_ctx.ndb_mgm_handle, node_types);
+}
+
+int ndb_live_api_s::restart4(ndb_connection_context_s& ndb_ctx, int cnt,
+    const int* nodes, int initial, int nostart, int abort, int force,
+    int* disconnect)
+{
+    assert(ndb_ctx.ndb_mgm_handle);
+    return ndb_mgm_restart4(ndb_ctx.ndb_mgm_handle, cnt, nodes, initial,
+        nostart, abort, force, disconnect);
+}
+
+int ndb_live_api_s::wait_until_ready(ndb_connection_context_s& ndb_ctx,
+    const int* nodes, int cnt, int timeout)
+{
+    if (connect_data_nodes(ndb_ctx)) {
+        return -1;
+    }
+    return ndb_ctx.connection->wait_until_ready(nodes, cnt, timeout);
+}
+
+int ndb_live_api_s::dump_state(ndb_connection_context_s& ndb_ctx,
+    int node_id, const int* args, int num_args, ndb_mgm_reply* reply)
+{
+    assert(ndb_ctx.ndb_mgm_handle);
+    return ndb_mgm_dump_state(ndb_ctx.ndb_mgm_handle, node_id, args,
+        num_args, reply);
+}
+
+void ndb_live_api_s::sleep(ndb_connection_context_s&,
+    chrono::milliseconds duration)
+{
+    this_thread::sleep_for(duration);
+}
+
+NdbLogEventHandle ndb_live_api_s::open_restart_events(
+    ndb_connection_context_s& ndb_ctx)
+{
+    assert(ndb_ctx.ndb_mgm_handle);
+    /* level 15 of the node restart category includes every fragment */
+    int filter[] = { 15, NDB_MGM_EVENT_CATEGORY_NODE_RESTART, 0 };
+    return ndb_mgm_create_logevent_handle(ndb_ctx.ndb_mgm_handle, filter);
+}
+
+int ndb_live_api_s::next_restart_event(NdbLogEventHandle handle,
+    ndb_logevent* event, unsigned timeout_ms)
+{
+    return ndb_logevent_get_next(handle, event, timeout_ms);
+}
+
+void ndb_live_api_s::close_restart_events(NdbLogEventHandle handle)
+{
+    ndb_mgm_destroy_logevent_handle(&handle);
+}
+
+ndb_api_s& get_ndb_api(ndb_connection_context_s& ndb_ctx)
+{
+    static ndb_live_api_s live_api;
+    if (ndb_ctx.api) {
+        return *ndb_ctx.api;
+    }
+    return live_api;
+}
@@ -0,0 +1,111 @@
+/*
+ * ndb_rolling_restart_api.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_API_HPP
+#define NDB_ROLLING_RESTART_API_HPP 1
+
+#include "ndb_rolling_restart.hpp"
+#include <chrono>
+#include <string>
+
+/* Every call the restart makes to the NDB MGM API and the NDB API goes
+   through this interface, so that the calls can be recorded and played
+   back, see ndb_rolling_restart_replay.hpp */
+struct ndb_api_s {
+    virtual ~ndb_api_s() {}
+
+    /* sets up ndb_ctx.ndb_mgm_handle, ndb_ctx.connection to the data
+       nodes may be set up later, by the calls which need it */
+    virtual int connect(ndb_connection_context_s& ndb_ctx) = 0;
+
+    virtual void disconnect(ndb_connection_context_s& ndb_ctx) = 0;
+
+    virtual std::string get_system_name(ndb_connection_context_s& ndb_ctx)
+        = 0;
+
+    /* node_types ends with NDB_MGM_NODE_TYPE_UNKNOWN,
+       the result is released with free() */
+    virtual ndb_mgm_cluster_state* get_status2(
+        ndb_connection_context_s& ndb_ctx,
+        const ndb_mgm_node_type node_types[])
+        = 0;
+
+    virtual int restart4(ndb_connection_context_s& ndb_ctx, int cnt,
+        const int* nodes, int initial, int nostart, int abort, int force,
+        int* disconnect)
+        = 0;
+
+    virtual int wait_until_ready(ndb_connection_context_s& ndb_ctx,
+        const int* nodes, int cnt, int timeout)
+        = 0;
+
+    virtual int dump_state(ndb_connection_context_s& ndb_ctx, int node_id,
+        const int* args, int num_args, ndb_mgm_reply* reply)
+        = 0;
+
+    virtual void sleep(ndb_connection_context_s& ndb_ctx,
+        std::chrono::milliseconds duration)
+        = 0;
+
+    /* true once the backend can not answer calls any more, for example
+       at the end of a replay log, the retry loops give up then */
+    virtual bool aborted() { return false; }
+
+    /* subscribes to the node restart log events of the management
+       server, on a socket of its own, null if the backend has none */
+    virtual NdbLogEventHandle open_restart_events(
+        ndb_connection_context_s& ndb_ctx)
+    {
+        return nullptr;
+    }
+
+    /* 1 with event filled in, 0 if none came within timeout_ms, -1 on
+       error */
+    virtual int next_restart_event(NdbLogEventHandle handle,
+        ndb_logevent* event, unsigned timeout_ms)
+    {
+        return -1;
+    }
+
+    virtual void close_restart_events(NdbLogEventHandle handle) {}
+};
+
+/* talks to a real cluster */
+struct ndb_live_api_s : ndb_api_s {
+    int connect(ndb_connection_context_s& ndb_ctx) override;
+    void disconnect(ndb_connection_context_s& ndb_ctx) override;
+    std::string get_system_name(ndb_connection_context_s& ndb_ctx) override;
+    ndb_mgm_cluster_state* get_status2(ndb_connection_context_s& ndb_ctx,
+        const ndb_mgm_node_type node_types[]) override;
+    int restart4(ndb_connection_context_s& ndb_ctx, int cnt,
+        const int* nodes, int initial, int nostart, int abort, int force,
+        int* disconnect) override;
+    int wait_until_ready(ndb_connection_context_s& ndb_ctx, const int* nodes,
+        int cnt, int timeout) override;
+    int dump_state(ndb_connection_context_s& ndb_ctx, int node_id,
+        const int* args, int num_args, ndb_mgm_reply* reply) override;
+    void sleep(ndb_connection_context_s& ndb_ctx,
+        std::chrono::milliseconds duration) override;
+    NdbLogEventHandle open_restart_events(
+        ndb_connection_context_s& ndb_ctx) override;
+    int next_restart_event(NdbLogEventHandle handle, ndb_logevent* event,
+        unsigned timeout_ms) override;
+    void close_restart_events(NdbLogEventHandle handle) override;
+};
+
+/* ndb_ctx.api if set, otherwise a shared ndb_live_api_s */
+ndb_api_s& get_ndb_api(ndb_connection_context_s& ndb_ctx);
+
+#endif /* NDB_ROLLING_RESTART_API_HPP */
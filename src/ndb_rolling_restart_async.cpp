@@ -0,0 +1,131 @@
+/*
+ * ndb_rolling_restart_async
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_async.hpp"
+
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+using namespace std;
+
+struct ndb_rr_job_s {
+    ndb_connection_context_s ndb_ctx;
+    ndb_rr_callback callback;
+    atomic<bool> cancel{ false };
+    atomic<bool> pause{ false };
+
+    mutex lock;
+    condition_variable finished_cond;
+    deque<restart_event_s> events;
+    bool finished = false;
+    int return_code = 0;
+
+    thread runner;
+};
+
+static void ndb_rr_run(ndb_rr_job_s* job)
+{
+    int rv = ndb_rolling_restart(job->ndb_ctx);
+
+    lock_guard<mutex> guard(job->lock);
+    job->return_code = rv;
+    job->finished = true;
+    job->finished_cond.notify_all();
+}
+
+ndb_rr_handle ndb_rr_submit(const ndb_connection_context_s& plan,
+    ndb_rr_callback callback)
+{
+    assert(!plan.connection);
+    assert(!plan.ndb_mgm_handle);
+    assert(!plan.cluster_state);
+
+    ndb_rr_job_s* job = new ndb_rr_job_s();
+    job->callback = callback;
+
+    job->ndb_ctx = plan;
+    job->ndb_ctx.cancel = &job->cancel;
+    job->ndb_ctx.pause = &job->pause;
+    job->ndb_ctx.on_event = [job](const restart_event_s& event) {
+        if (job->callback) {
+            job->callback(event);
+            return;
+        }
+        lock_guard<mutex> guard(job->lock);
+        job->events.push_back(event);
+    };
+
+    try {
+        job->runner = thread(ndb_rr_run, job);
+    } catch (const system_error&) {
+        delete job;
+        return nullptr;
+    }
+    return job;
+}
+
+bool ndb_rr_poll(ndb_rr_handle job, vector<restart_event_s>& events)
+{
+    assert(job);
+
+    lock_guard<mutex> guard(job->lock);
+    while (!job->events.empty()) {
+        events.push_back(move(job->events.front()));
+        job->events.pop_front();
+    }
+    return job->finished;
+}
+
+void ndb_rr_cancel(ndb_rr_handle job)
+{
+    assert(job);
+    job->cancel.store(true);
+}
+
+void ndb_rr_pause(ndb_rr_handle job)
+{
+    assert(job);
+    job->pause.store(true);
+}
+
+void ndb_rr_resume(ndb_rr_handle job)
+{
+    assert(job);
+    job->pause.store(false);
+}
+
+int ndb_rr_wait(ndb_rr_handle job)
+{
+    assert(job);
+
+    unique_lock<mutex> guard(job->lock);
+    job->finished_cond.wait(guard, [job] { return job->finished; });
+    return job->return_code;
+}
+
+void ndb_rr_release(ndb_rr_handle job)
+{
+    if (!job) {
+        return;
+    }
+    if (job->runner.joinable()) {
+        job->runner.join();
+    }
+    delete job;
+}
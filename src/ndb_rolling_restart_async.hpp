@@ -0,0 +1,60 @@
+/*
+ * ndb_rolling_restart_async.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_ASYNC_HPP
+#define NDB_ROLLING_RESTART_ASYNC_HPP 1
+
+#include "ndb_rolling_restart.hpp"
+#include <vector>
+
+/* Non-blocking interface for embedding the rolling restart in another
+   process. Each submitted plan runs on its own thread, several may run
+   at the same time against different clusters. As with any NDB API
+   program, the host calls ndb_init() before the first submit and
+   ndb_end() after the last handle is released. */
+
+typedef struct ndb_rr_job_s* ndb_rr_handle;
+
+typedef std::function<void(const restart_event_s&)> ndb_rr_callback;
+
+/* plan holds the settings, its connection members must be null and its
+   on_event, cancel and pause members are replaced. If callback is set
+   it is called on the restart thread for every event, otherwise events
+   are queued for ndb_rr_poll. Returns null if the thread can not
+   start. */
+ndb_rr_handle ndb_rr_submit(const ndb_connection_context_s& plan,
+    ndb_rr_callback callback = nullptr);
+
+/* moves queued events to the end of events, returns true once the
+   restart has finished and all events have been delivered */
+bool ndb_rr_poll(ndb_rr_handle handle, std::vector<restart_event_s>& events);
+
+/* asks the restart to stop before the next node or wave, nodes which
+   are already restarting are waited for */
+void ndb_rr_cancel(ndb_rr_handle handle);
+
+/* no further node goes down until ndb_rr_resume, nodes which are
+   already restarting are waited for */
+void ndb_rr_pause(ndb_rr_handle handle);
+
+void ndb_rr_resume(ndb_rr_handle handle);
+
+/* blocks until the restart has finished, returns its return code */
+int ndb_rr_wait(ndb_rr_handle handle);
+
+/* waits for the restart to finish and frees the handle */
+void ndb_rr_release(ndb_rr_handle handle);
+
+#endif /* NDB_ROLLING_RESTART_ASYNC_HPP */
@@ -0,0 +1,60 @@
+/*
+ * ndb_rolling_restart_control
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_control.hpp"
+
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+restart_control_e parse_restart_control(const string& text)
+{
+    istringstream words(text);
+    string word;
+    words >> word;
+    if (word == "pause") {
+        return RESTART_CONTROL_PAUSE;
+    }
+    if (word == "cancel") {
+        return RESTART_CONTROL_CANCEL;
+    }
+    return RESTART_CONTROL_RUN;
+}
+
+restart_control_e read_restart_control(const string& path)
+{
+    ifstream in(path.c_str());
+    if (!in) {
+        return RESTART_CONTROL_RUN;
+    }
+    string line;
+    getline(in, line);
+    return parse_restart_control(line);
+}
+
+restart_control_e get_restart_control(const atomic<bool>* cancel,
+    const atomic<bool>* pause, const string& path)
+{
+    if (cancel && cancel->load()) {
+        return RESTART_CONTROL_CANCEL;
+    }
+    restart_control_e control = path.empty() ? RESTART_CONTROL_RUN
+                                             : read_restart_control(path);
+    if (control == RESTART_CONTROL_RUN && pause && pause->load()) {
+        return RESTART_CONTROL_PAUSE;
+    }
+    return control;
+}
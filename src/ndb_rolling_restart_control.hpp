@@ -0,0 +1,42 @@
+/*
+ * ndb_rolling_restart_control.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_CONTROL_HPP
+#define NDB_ROLLING_RESTART_CONTROL_HPP 1
+
+#include <atomic>
+#include <string>
+
+/* what an operator asked the rollout to do, it is asked at the safe
+   points between restarts, nodes already restarting are finished */
+enum restart_control_e {
+    RESTART_CONTROL_RUN = 0,
+    RESTART_CONTROL_PAUSE,
+    RESTART_CONTROL_CANCEL
+};
+
+/* the first word of a control file: "pause" or "cancel", anything
+   else, e.g. "resume", lets the rollout run */
+restart_control_e parse_restart_control(const std::string& text);
+
+/* a missing or empty file lets the rollout run */
+restart_control_e read_restart_control(const std::string& path);
+
+/* cancel wins over pause, either flag may be null, the file is only
+   read if path is not empty */
+restart_control_e get_restart_control(const std::atomic<bool>* cancel,
+    const std::atomic<bool>* pause, const std::string& path);
+
+#endif /* NDB_ROLLING_RESTART_CONTROL_HPP */
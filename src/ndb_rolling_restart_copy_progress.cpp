@@ -0,0 +1,243 @@
+/*
+ * ndb_rolling_restart_copy_progress
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_copy_progress.hpp"
+#include "ndb_rolling_restart_api.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <system_error>
+
+using namespace std;
+
+#define COPY_EVENT_TIMEOUT_MS 200
+
+static double seconds_between(copy_time_t begin, copy_time_t end)
+{
+    return chrono::duration_cast<chrono::milliseconds>(end - begin).count()
+        / 1000.0;
+}
+
+static double median(vector<double> values)
+{
+    if (values.empty()) {
+        return -1;
+    }
+    size_t middle = values.size() / 2;
+    nth_element(values.begin(), values.begin() + middle, values.end());
+    return values[middle];
+}
+
+void copy_monitor_event(ndb_copy_monitor_s& monitor,
+    const ndb_logevent& event, copy_time_t now)
+{
+    switch (event.type) {
+    case NDB_LE_NR_CopyFragsStarted: {
+        int node_id = (int)event.NR_CopyFragsStarted.dest_node;
+        /* a node restarted again starts over */
+        monitor.nodes[node_id] = copy_progress_s{ true, false, 0, now, now };
+        break;
+    }
+    case NDB_LE_NR_CopyFragDone: {
+        int node_id = (int)event.NR_CopyFragDone.dest_node;
+        auto found = monitor.nodes.find(node_id);
+        if (found == monitor.nodes.end()) {
+            /* subscribed after the copy started, counted from here */
+            found = monitor.nodes.insert(make_pair(node_id,
+                                             copy_progress_s{ true, false,
+                                                 0, now, now }))
+                        .first;
+        }
+        ++found->second.fragments;
+        found->second.last = now;
+        break;
+    }
+    case NDB_LE_NR_CopyFragsCompleted: {
+        int node_id = (int)event.NR_CopyFragsCompleted.dest_node;
+        auto found = monitor.nodes.find(node_id);
+        if (found == monitor.nodes.end() || found->second.completed) {
+            break;
+        }
+        copy_progress_s& node = found->second;
+        node.completed = true;
+        node.last = now;
+        double seconds = seconds_between(node.begin, node.last);
+        if (node.fragments && seconds > 0) {
+            monitor.completed.push_back(make_pair(node.fragments, seconds));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+copy_estimate_s copy_monitor_estimate(ndb_copy_monitor_s& monitor,
+    int node_id, copy_time_t now)
+{
+    copy_estimate_s estimate{ false, false, 0, 0, 0, -1, -1, false };
+
+    lock_guard<mutex> guard(monitor.lock);
+    vector<double> rates;
+    vector<double> totals;
+    for (const auto& copy : monitor.completed) {
+        rates.push_back(copy.first / copy.second);
+        totals.push_back(copy.first);
+    }
+    estimate.usual_fragments_per_second = median(rates);
+
+    auto found = monitor.nodes.find(node_id);
+    if (found == monitor.nodes.end()) {
+        return estimate;
+    }
+    const copy_progress_s& node = found->second;
+    estimate.started = node.started;
+    estimate.completed = node.completed;
+    estimate.fragments = node.fragments;
+    estimate.seconds = seconds_between(node.begin,
+        node.completed ? node.last : now);
+    if (estimate.seconds > 0) {
+        estimate.fragments_per_second = node.fragments / estimate.seconds;
+    }
+    if (node.completed) {
+        estimate.eta_seconds = 0;
+        return estimate;
+    }
+
+    double expected = median(totals);
+    if (expected > node.fragments && estimate.fragments_per_second > 0) {
+        estimate.eta_seconds = (expected - node.fragments)
+            / estimate.fragments_per_second;
+    }
+    /* too early to tell before the usual rate copied one fragment */
+    estimate.slow = estimate.usual_fragments_per_second > 0
+        && estimate.seconds * estimate.usual_fragments_per_second >= 1
+        && estimate.fragments_per_second
+            < monitor.slow_fraction * estimate.usual_fragments_per_second;
+    return estimate;
+}
+
+string format_copy_estimate(const copy_estimate_s& estimate)
+{
+    if (!estimate.started) {
+        return "";
+    }
+    char buf[200];
+    int len = snprintf(buf, sizeof(buf),
+        "copied %lu fragments in %.1fs (%.1f/s)", estimate.fragments,
+        estimate.seconds, estimate.fragments_per_second);
+    if (estimate.completed) {
+        return buf;
+    }
+    if (estimate.eta_seconds >= 0) {
+        len += snprintf(buf + len, sizeof(buf) - len, ", about %.1fs left",
+            estimate.eta_seconds);
+    }
+    if (estimate.slow) {
+        snprintf(buf + len, sizeof(buf) - len, ", slow: usually %.1f/s",
+            estimate.usual_fragments_per_second);
+    }
+    return buf;
+}
+
+static void copy_monitor_run(ndb_copy_monitor_s* monitor)
+{
+    ndb_api_s& api = get_ndb_api(monitor->ndb_ctx);
+    while (!monitor->stopping) {
+        if (!monitor->handle) {
+            api.sleep(monitor->ndb_ctx, chrono::seconds(1));
+            monitor->handle = api.open_restart_events(monitor->ndb_ctx);
+            continue;
+        }
+
+        ndb_logevent event;
+        int ret = api.next_restart_event(monitor->handle, &event,
+            COPY_EVENT_TIMEOUT_MS);
+        if (ret < 0) {
+            /* the management server went away, subscribe again */
+            api.close_restart_events(monitor->handle);
+            monitor->handle = nullptr;
+            continue;
+        }
+        if (ret > 0) {
+            lock_guard<mutex> guard(monitor->lock);
+            copy_monitor_event(*monitor, event, chrono::steady_clock::now());
+        }
+    }
+}
+
+int copy_monitor_start(ndb_copy_monitor_s& monitor,
+    ndb_connection_context_s& ndb_ctx)
+{
+    if (monitor.reader.joinable()) {
+        return 1;
+    }
+
+    /* as with the preflight, events and metrics stay with the
+       orchestrator */
+    monitor.ndb_ctx = ndb_ctx;
+    monitor.ndb_ctx.connection = nullptr;
+    monitor.ndb_ctx.ndb_mgm_handle = nullptr;
+    monitor.ndb_ctx.cluster_state = nullptr;
+    monitor.ndb_ctx.snapshot = cluster_snapshot_s();
+    monitor.ndb_ctx.metrics = nullptr;
+    monitor.ndb_ctx.stats = nullptr;
+    monitor.ndb_ctx.epochs = nullptr;
+    monitor.ndb_ctx.executor = nullptr;
+    monitor.ndb_ctx.copy_monitor = nullptr;
+    monitor.ndb_ctx.on_event = nullptr;
+
+    ndb_api_s& api = get_ndb_api(monitor.ndb_ctx);
+    if (api.connect(monitor.ndb_ctx)) {
+        return 1;
+    }
+    monitor.handle = api.open_restart_events(monitor.ndb_ctx);
+    if (!monitor.handle) {
+        api.disconnect(monitor.ndb_ctx);
+        return 1;
+    }
+
+    monitor.stopping = false;
+    try {
+        monitor.reader = thread(copy_monitor_run, &monitor);
+    } catch (const system_error&) {
+        api.close_restart_events(monitor.handle);
+        monitor.handle = nullptr;
+        api.disconnect(monitor.ndb_ctx);
+        return 1;
+    }
+    return 0;
+}
+
+void copy_monitor_stop(ndb_copy_monitor_s& monitor)
+{
+    if (!monitor.reader.joinable()) {
+        return;
+    }
+    monitor.stopping = true;
+    monitor.reader.join();
+
+    ndb_api_s& api = get_ndb_api(monitor.ndb_ctx);
+    if (monitor.handle) {
+        api.close_restart_events(monitor.handle);
+        monitor.handle = nullptr;
+    }
+    api.disconnect(monitor.ndb_ctx);
+}
+
+ndb_copy_monitor_s::~ndb_copy_monitor_s()
+{
+    copy_monitor_stop(*this);
+}
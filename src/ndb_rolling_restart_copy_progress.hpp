@@ -0,0 +1,89 @@
+/*
+ * ndb_rolling_restart_copy_progress.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_COPY_PROGRESS_HPP
+#define NDB_ROLLING_RESTART_COPY_PROGRESS_HPP 1
+
+#include "ndb_rolling_restart.hpp"
+#include <map>
+#include <mutex>
+#include <thread>
+
+typedef std::chrono::steady_clock::time_point copy_time_t;
+
+/* the data copy of one restarting node, as told by its log events */
+struct copy_progress_s {
+    bool started;
+    bool completed;
+    unsigned long fragments;
+    copy_time_t begin;
+    copy_time_t last; /* the last fragment, or the completion */
+};
+
+/* Follows the node restart log events of the management server on a
+   connection of its own, so a node copying data from its node group
+   partner shows how far it got while the orchestrator waits for it.
+   The log events count fragments, the bytes copied are not reported.
+   The reader thread only collects, the orchestrator reports. */
+struct ndb_copy_monitor_s {
+    ~ndb_copy_monitor_s(); /* stops the reader */
+
+    ndb_connection_context_s ndb_ctx;
+    NdbLogEventHandle handle = nullptr;
+    std::mutex lock;
+    std::map<int, copy_progress_s> nodes;
+    /* the fragments and seconds of every copy completed in this run */
+    std::vector<std::pair<unsigned long, double>> completed;
+    std::atomic<bool> stopping{ false };
+    std::thread reader;
+
+    /* a copy below this fraction of the usual rate is slow */
+    double slow_fraction = 0.5;
+    /* how often the progress of a node is reported */
+    std::chrono::seconds report_interval{ 10 };
+    std::map<int, copy_time_t> last_report;
+};
+
+/* connects and starts the reader, returns 0 if started, the api of
+   ndb_ctx may have no log events, as the replay, then this fails */
+int copy_monitor_start(ndb_copy_monitor_s& monitor,
+    ndb_connection_context_s& ndb_ctx);
+
+void copy_monitor_stop(ndb_copy_monitor_s& monitor);
+
+/* takes a single log event, other than node restart events are ignored */
+void copy_monitor_event(ndb_copy_monitor_s& monitor,
+    const ndb_logevent& event, copy_time_t now);
+
+struct copy_estimate_s {
+    bool started;
+    bool completed;
+    unsigned long fragments;
+    double seconds; /* since the copy started */
+    double fragments_per_second;
+    /* from the copies completed in this run, -1 if there were none */
+    double usual_fragments_per_second;
+    double eta_seconds; /* -1 if unknown */
+    bool slow;
+};
+
+copy_estimate_s copy_monitor_estimate(ndb_copy_monitor_s& monitor,
+    int node_id, copy_time_t now);
+
+/* e.g. "copied 12 fragments in 4.0s (3.0/s), about 2.7s left", or
+   empty if the node did not start copying */
+std::string format_copy_estimate(const copy_estimate_s& estimate);
+
+#endif /* NDB_ROLLING_RESTART_COPY_PROGRESS_HPP */
@@ -0,0 +1,178 @@
+/*
+ * ndb_rolling_restart_dry_run
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_dry_run.hpp"
+#include "ndb_rolling_restart_api.hpp"
+#include "ndb_rolling_restart_epochs.hpp"
+#include "ndb_rolling_restart_log.hpp"
+#include "ndb_rolling_restart_stats.hpp"
+
+#include <cstdio>
+
+using namespace std;
+
+vector<dry_run_wave_s> dry_run_timeline(
+    const vector<vector<restart_node_status_s>>& waves,
+    const schedule_estimate_s& estimate)
+{
+    vector<dry_run_wave_s> timeline;
+    double begin = 0.0;
+    for (size_t w = 0; w < waves.size() && w < estimate.wave_seconds.size();
+         ++w) {
+        dry_run_wave_s timed{ begin, begin + estimate.wave_seconds[w], {} };
+        for (const auto& node : waves[w]) {
+            timed.node_ids.push_back(node.node_id);
+        }
+        begin = timed.end_seconds;
+        timeline.push_back(timed);
+    }
+    return timeline;
+}
+
+string format_dry_run_wave(unsigned wave, const dry_run_wave_s& timed)
+{
+    char buf[80];
+    snprintf(buf, sizeof(buf), "wave %u +%.1fs to +%.1fs: node", wave,
+        timed.begin_seconds, timed.end_seconds);
+    string line = buf;
+    for (auto node_id : timed.node_ids) {
+        line += " " + to_string(node_id);
+    }
+    return line;
+}
+
+size_t set_expected_seconds(vector<schedule_node_s>& nodes,
+    const map<string, uint64_t>& baseline)
+{
+    size_t known = 0;
+    for (auto& node : nodes) {
+        uint64_t ms = stats_baseline_node_ms(baseline, node.node_id);
+        node.expected_seconds = ms / 1000.0;
+        if (ms) {
+            ++known;
+        }
+    }
+    return known;
+}
+
+map<string, uint64_t> read_cluster_baseline(
+    ndb_connection_context_s& ndb_ctx, const string& baseline_path)
+{
+    map<string, map<string, uint64_t>> baselines;
+    if (baseline_path.empty()) {
+        return map<string, uint64_t>();
+    }
+    if (read_stats_baselines(baseline_path, baselines)) {
+        Cerr(ndb_ctx) << "could not read baselines '" << baseline_path << "'";
+        return map<string, uint64_t>();
+    }
+    string cluster_name = get_ndb_api(ndb_ctx).get_system_name(ndb_ctx);
+    auto found = baselines.find(cluster_name);
+    if (found == baselines.end()) {
+        Cout(ndb_ctx) << "no baseline for " << cluster_name << " yet";
+        return map<string, uint64_t>();
+    }
+    return found->second;
+}
+
+static string makespan_line(const ndb_schedule_policy_s& policy,
+    const schedule_estimate_s& parallel, const schedule_estimate_s& serial)
+{
+    char buf[160];
+    snprintf(buf, sizeof(buf),
+        "%s: %.1fs parallel, %.1fs serial, %lu waves, %d live replicas",
+        policy.name(), parallel.makespan_seconds, serial.makespan_seconds,
+        (unsigned long)parallel.waves, parallel.min_live_replicas);
+    return buf;
+}
+
+static int dry_run(ndb_connection_context_s& ndb_ctx,
+    const string& baseline_path)
+{
+    if (init_ndb_connection(ndb_ctx)) {
+        Cerr(ndb_ctx) << "error connecting to ndb '" << ndb_ctx.connect_string
+                      << "'";
+        return 1;
+    }
+    report_cluster_state(ndb_ctx);
+    Cout(ndb_ctx) << "dry run, no node is restarted";
+
+    auto node_restarts = get_selected_node_restarts(ndb_ctx);
+    auto nodes = get_schedule_nodes(ndb_ctx.cluster_state, node_restarts);
+    size_t known = set_expected_seconds(nodes,
+        read_cluster_baseline(ndb_ctx, baseline_path));
+    for (const auto& node : nodes) {
+        if (!node.pending) {
+            continue;
+        }
+        char buf[40];
+        snprintf(buf, sizeof(buf), "%.1fs",
+            node.expected_seconds > 0 ? node.expected_seconds
+                                      : DRY_RUN_DEFAULT_SECONDS);
+        Cnode(ndb_ctx, node.node_id)
+            << "node " << node.node_id << ": expected " << buf
+            << (node.expected_seconds > 0 ? "" : " (default)");
+    }
+    Cout(ndb_ctx) << known << " of " << nodes.size()
+                  << " nodes with a restart time from history";
+
+    const ndb_schedule_policy_s* selected = ndb_ctx.schedule
+        ? ndb_ctx.schedule
+        : find_schedule_policy("round_robin");
+    vector<string> makespans;
+    for (const auto* policy : schedule_policies()) {
+        auto waves = policy->plan(nodes);
+        auto parallel = simulate_schedule(nodes, waves, true,
+            DRY_RUN_HOST_CONTENTION, DRY_RUN_DEFAULT_SECONDS);
+        auto serial = simulate_schedule(nodes, waves, false,
+            DRY_RUN_HOST_CONTENTION, DRY_RUN_DEFAULT_SECONDS);
+        makespans.push_back(makespan_line(*policy, parallel, serial)
+            + (policy == selected ? " (selected)" : ""));
+
+        const auto& estimate = ndb_ctx.parallel_node_groups ? parallel
+                                                            : serial;
+        Cout(ndb_ctx) << "timeline of " << policy->name()
+                      << (ndb_ctx.parallel_node_groups ? " parallel"
+                                                       : " serial");
+        auto timeline = dry_run_timeline(waves, estimate);
+        for (size_t w = 0; w < timeline.size(); ++w) {
+            Cout(ndb_ctx) << "  " << format_dry_run_wave(w + 1, timeline[w]);
+        }
+    }
+    Cout(ndb_ctx) << "predicted makespan:";
+    for (const auto& line : makespans) {
+        Cout(ndb_ctx) << "  " << line;
+    }
+
+    close_ndb_connection(ndb_ctx);
+    return 0;
+}
+
+int ndb_rolling_restart_dry_run(ndb_connection_context_s& ndb_ctx,
+    const string& baseline_path)
+{
+    /* the epochs say which nodes are skipped, but are not written */
+    restart_epochs_s* epochs = ndb_ctx.epochs;
+    restart_epochs_s unwritten;
+    if (epochs) {
+        unwritten = *epochs;
+        unwritten.path.clear();
+        ndb_ctx.epochs = &unwritten;
+    }
+    int rv = dry_run(ndb_ctx, baseline_path);
+    ndb_ctx.epochs = epochs;
+    emit_restart_event(ndb_ctx, RESTART_EVENT_FINISHED, 0, rv, "");
+    return rv;
+}
@@ -0,0 +1,63 @@
+/*
+ * ndb_rolling_restart_dry_run.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_DRY_RUN_HPP
+#define NDB_ROLLING_RESTART_DRY_RUN_HPP 1
+
+#include "ndb_rolling_restart.hpp"
+#include "ndb_rolling_restart_schedule.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+/* the restart time of a node without history */
+#define DRY_RUN_DEFAULT_SECONDS 60.0
+
+/* as in the schedule benchmark, see simulate_schedule */
+#define DRY_RUN_HOST_CONTENTION 0.5
+
+struct dry_run_wave_s {
+    double begin_seconds;
+    double end_seconds;
+    std::vector<int> node_ids;
+};
+
+/* the waves one after the other, as long as the estimate says */
+std::vector<dry_run_wave_s> dry_run_timeline(
+    const std::vector<std::vector<restart_node_status_s>>& waves,
+    const schedule_estimate_s& estimate);
+
+/* e.g. "wave 2 +60.0s to +120.0s: node 2 4" */
+std::string format_dry_run_wave(unsigned wave, const dry_run_wave_s& timed);
+
+/* the expected restart time of each node from a baseline, as written by
+   --baseline_file, returns the number of nodes which had history */
+size_t set_expected_seconds(std::vector<schedule_node_s>& nodes,
+    const std::map<std::string, uint64_t>& baseline);
+
+/* the baseline of the connected cluster in baseline_path, as written
+   by --baseline_file, empty if there is none */
+std::map<std::string, uint64_t> read_cluster_baseline(
+    ndb_connection_context_s& ndb_ctx, const std::string& baseline_path);
+
+/* Connects and plans the restart as every schedule policy would, then
+   reports the predicted timeline and makespan of each, nothing is
+   restarted, nor is the epochs file written. The restart times are
+   taken from the baseline of the cluster in baseline_path if there is
+   one. */
+int ndb_rolling_restart_dry_run(ndb_connection_context_s& ndb_ctx,
+    const std::string& baseline_path);
+
+#endif /* NDB_ROLLING_RESTART_DRY_RUN_HPP */
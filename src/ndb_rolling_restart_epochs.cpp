@@ -0,0 +1,143 @@
+/*
+ * ndb_rolling_restart_epochs
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_epochs.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+int read_restart_epochs(restart_epochs_s& epochs, const string& path)
+{
+    epochs.path = path;
+    epochs.nodes.clear();
+
+    ifstream in(path.c_str());
+    if (!in) {
+        return 0;
+    }
+
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        istringstream fields(line);
+        node_epoch_s node;
+        long long epoch;
+        if (!(fields >> node.node_id >> node.connect_count >> epoch)) {
+            return 1;
+        }
+        node.epoch = epoch;
+        epochs.nodes[node.node_id] = node;
+    }
+    return in.bad() ? 1 : 0;
+}
+
+int write_restart_epochs(const restart_epochs_s& epochs)
+{
+    if (epochs.path.empty()) {
+        return 0;
+    }
+
+    string tmp_path = epochs.path + ".tmp";
+    {
+        ofstream out(tmp_path.c_str());
+        if (!out) {
+            return 1;
+        }
+        out << "# node_id connect_count epoch\n";
+        for (const auto& entry : epochs.nodes) {
+            const node_epoch_s& node = entry.second;
+            out << node.node_id << " " << node.connect_count << " "
+                << (long long)node.epoch << "\n";
+        }
+        if (!out) {
+            return 1;
+        }
+    }
+    return rename(tmp_path.c_str(), epochs.path.c_str()) ? 1 : 0;
+}
+
+void epochs_run_begin(restart_epochs_s* epochs,
+    const ndb_mgm_cluster_state* cluster_state, int64_t now)
+{
+    if (!epochs) {
+        return;
+    }
+
+    epochs->run_connect_counts.clear();
+    for (int i = 0; i < cluster_state->no_of_nodes; ++i) {
+        const ndb_mgm_node_state& node_state = cluster_state->node_states[i];
+        epochs->run_connect_counts[node_state.node_id]
+            = node_state.connect_count;
+
+        auto found = epochs->nodes.find(node_state.node_id);
+        if (found == epochs->nodes.end()) {
+            epochs->nodes[node_state.node_id] = node_epoch_s{
+                node_state.node_id, node_state.connect_count, 0
+            };
+            continue;
+        }
+        node_epoch_s& node = found->second;
+        if (node.connect_count != -1
+            && node.connect_count != node_state.connect_count) {
+            node.epoch = now;
+        }
+        node.connect_count = node_state.connect_count;
+    }
+    write_restart_epochs(*epochs);
+}
+
+bool epochs_skip_node(const restart_epochs_s* epochs, int node_id,
+    int connect_count, string* reason)
+{
+    if (!epochs) {
+        return false;
+    }
+
+    auto found = epochs->nodes.find(node_id);
+    if (epochs->skip_since && found != epochs->nodes.end()
+        && found->second.epoch >= epochs->skip_since) {
+        *reason = "restarted at " + to_string(found->second.epoch)
+            + ", not before " + to_string(epochs->skip_since);
+        return true;
+    }
+
+    auto run_count = epochs->run_connect_counts.find(node_id);
+    if (run_count != epochs->run_connect_counts.end()
+        && connect_count > run_count->second) {
+        *reason = "restarted since the run began, connect_count "
+            + to_string(run_count->second) + " -> "
+            + to_string(connect_count);
+        return true;
+    }
+    return false;
+}
+
+void epochs_node_restarted(restart_epochs_s* epochs, int node_id,
+    int64_t now)
+{
+    if (!epochs) {
+        return;
+    }
+
+    /* the connect_count after the restart is taken when next seen */
+    epochs->nodes[node_id] = node_epoch_s{ node_id, -1, now };
+    epochs->run_connect_counts.erase(node_id);
+    write_restart_epochs(*epochs);
+}
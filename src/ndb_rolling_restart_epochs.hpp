@@ -0,0 +1,65 @@
+/*
+ * ndb_rolling_restart_epochs.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_EPOCHS_HPP
+#define NDB_ROLLING_RESTART_EPOCHS_HPP 1
+
+#include <mgmapi/mgmapi.h>
+#include <cstdint>
+#include <map>
+#include <string>
+
+/* when a node was last seen to restart, epoch is in unix seconds, 0 if
+   unknown, connect_count is -1 until it was seen after the restart */
+struct node_epoch_s {
+    int node_id;
+    int connect_count;
+    int64_t epoch;
+};
+
+/* The restart epoch of every node, kept in a file of
+   "node_id connect_count epoch" lines so that a run which is started
+   again after a failure knows which nodes are already done. A node
+   whose connect_count differs from the one recorded has restarted
+   without us, at the latest when that was noticed. */
+struct restart_epochs_s {
+    std::string path; /* rewritten after every change, if not empty */
+    std::map<int, node_epoch_s> nodes;
+    /* the connect_count of each node when the run began */
+    std::map<int, int> run_connect_counts;
+    /* nodes which restarted at or after this are skipped, 0 for none */
+    int64_t skip_since = 0;
+};
+
+/* a missing file is not an error, returns 0 on success */
+int read_restart_epochs(restart_epochs_s& epochs, const std::string& path);
+
+int write_restart_epochs(const restart_epochs_s& epochs);
+
+/* the following accept a null epochs and then do nothing */
+
+/* notes restarts which happened since the file was written */
+void epochs_run_begin(restart_epochs_s* epochs,
+    const ndb_mgm_cluster_state* cluster_state, int64_t now);
+
+/* true, with the reason, if the node restarted after skip_since or since
+   the run began, connect_count is the latest one seen */
+bool epochs_skip_node(const restart_epochs_s* epochs, int node_id,
+    int connect_count, std::string* reason);
+
+void epochs_node_restarted(restart_epochs_s* epochs, int node_id,
+    int64_t now);
+
+#endif /* NDB_ROLLING_RESTART_EPOCHS_HPP */
@@ -0,0 +1,188 @@
+/*
+ * ndb_rolling_restart_executor
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_executor.hpp"
+#include "ndb_rolling_restart_api.hpp"
+
+#include <system_error>
+
+using namespace std;
+
+/* own queue from the front, others from the back */
+static bool take_job(ndb_executor_s& executor, size_t self,
+    executor_job_t& job)
+{
+    size_t count = executor.workers.size();
+    for (size_t i = 0; i < count; ++i) {
+        executor_worker_s& worker = *executor.workers[(self + i) % count];
+        {
+            lock_guard<mutex> guard(worker.lock);
+            if (worker.jobs.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                job = move(worker.jobs.front());
+                worker.jobs.pop_front();
+            } else {
+                job = move(worker.jobs.back());
+                worker.jobs.pop_back();
+            }
+        }
+        lock_guard<mutex> guard(executor.lock);
+        --executor.queued;
+        if (i) {
+            ++executor.steals;
+        }
+        return true;
+    }
+    return false;
+}
+
+static void executor_run(ndb_executor_s* executor, size_t self)
+{
+    executor_worker_s& worker = *executor->workers[self];
+    for (;;) {
+        executor_job_t job;
+        if (!take_job(*executor, self, job)) {
+            unique_lock<mutex> guard(executor->lock);
+            if (executor->queued) {
+                continue;
+            }
+            if (executor->stopping) {
+                break;
+            }
+            executor->wake.wait(guard);
+            continue;
+        }
+
+        int connect_err = 0;
+        if (!worker.connected) {
+            connect_err = get_ndb_api(worker.ndb_ctx).connect(worker.ndb_ctx);
+            worker.connected = !connect_err;
+        }
+        job(worker.ndb_ctx, connect_err);
+    }
+
+    if (worker.connected) {
+        get_ndb_api(worker.ndb_ctx).disconnect(worker.ndb_ctx);
+        worker.connected = false;
+    }
+}
+
+int executor_start(ndb_executor_s& executor, ndb_connection_context_s& ndb_ctx,
+    unsigned workers)
+{
+    if (workers > EXECUTOR_MAX_WORKERS) {
+        workers = EXECUTOR_MAX_WORKERS;
+    }
+    if (!workers || executor.workers.size()) {
+        return 1;
+    }
+
+    for (unsigned i = 0; i < workers; ++i) {
+        unique_ptr<executor_worker_s> worker(new executor_worker_s());
+        /* as with the preflight, events and metrics stay with the
+           orchestrator */
+        worker->ndb_ctx = ndb_ctx;
+        worker->ndb_ctx.connection = nullptr;
+        worker->ndb_ctx.ndb_mgm_handle = nullptr;
+        worker->ndb_ctx.cluster_state = nullptr;
+        worker->ndb_ctx.snapshot = cluster_snapshot_s();
+        worker->ndb_ctx.metrics = nullptr;
+        worker->ndb_ctx.epochs = nullptr;
+        worker->ndb_ctx.executor = nullptr;
+        worker->ndb_ctx.copy_monitor = nullptr;
+        worker->ndb_ctx.host_locks = nullptr;
+        worker->ndb_ctx.on_event = nullptr;
+        executor.workers.push_back(move(worker));
+    }
+
+    executor.stopping = false;
+    for (size_t i = 0; i < executor.workers.size(); ++i) {
+        try {
+            executor.workers[i]->runner = thread(executor_run, &executor, i);
+        } catch (const system_error&) {
+            executor_stop(executor);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void executor_submit(ndb_executor_s& executor, int node_id,
+    executor_job_t job)
+{
+    executor_worker_s& worker
+        = *executor.workers[(size_t)node_id % executor.workers.size()];
+    {
+        /* counted before a worker can take it, see executor_run */
+        lock_guard<mutex> guard(executor.lock);
+        lock_guard<mutex> worker_guard(worker.lock);
+        worker.jobs.push_back(move(job));
+        ++executor.queued;
+    }
+    executor.wake.notify_all();
+}
+
+void executor_for_each_node(ndb_executor_s* executor,
+    ndb_connection_context_s& ndb_ctx, const vector<int>& node_ids,
+    function<void(ndb_connection_context_s& node_ctx, int node_id,
+        int connect_err)>
+        job)
+{
+    if (!executor || executor->workers.empty()) {
+        for (auto node_id : node_ids) {
+            job(ndb_ctx, node_id, 0);
+        }
+        return;
+    }
+
+    mutex lock;
+    condition_variable done;
+    size_t remaining = node_ids.size();
+    for (auto node_id : node_ids) {
+        executor_submit(*executor, node_id,
+            [&, node_id](ndb_connection_context_s& worker_ctx,
+                int connect_err) {
+                job(worker_ctx, node_id, connect_err);
+                lock_guard<mutex> guard(lock);
+                if (--remaining == 0) {
+                    done.notify_one();
+                }
+            });
+    }
+    unique_lock<mutex> guard(lock);
+    done.wait(guard, [&remaining]() { return remaining == 0; });
+}
+
+void executor_stop(ndb_executor_s& executor)
+{
+    {
+        lock_guard<mutex> guard(executor.lock);
+        executor.stopping = true;
+    }
+    executor.wake.notify_all();
+    for (auto& worker : executor.workers) {
+        if (worker->runner.joinable()) {
+            worker->runner.join();
+        }
+    }
+    executor.workers.clear();
+}
+
+ndb_executor_s::~ndb_executor_s()
+{
+    executor_stop(*this);
+}
@@ -0,0 +1,79 @@
+/*
+ * ndb_rolling_restart_executor.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_EXECUTOR_HPP
+#define NDB_ROLLING_RESTART_EXECUTOR_HPP 1
+
+#include "ndb_rolling_restart.hpp"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/* the hard cap on the connections the executor opens to the management
+   server, one per worker */
+#define EXECUTOR_MAX_WORKERS 16
+
+/* runs on a worker, worker_ctx is connected unless connect_err is set */
+typedef std::function<void(ndb_connection_context_s& worker_ctx,
+    int connect_err)>
+    executor_job_t;
+
+struct executor_worker_s {
+    /* a copy of the orchestrator's context with its own connection,
+       opened with the first job */
+    ndb_connection_context_s ndb_ctx;
+    bool connected = false;
+    std::mutex lock;
+    std::deque<executor_job_t> jobs;
+    std::thread runner;
+};
+
+/* A fixed pool of workers for per-node MGM operations such as dump state
+   and status polls, so they do not wait for each other on one handle.
+   A job is queued with the worker chosen by its node id, an idle worker
+   takes jobs from the back of the other queues. */
+struct ndb_executor_s {
+    ~ndb_executor_s(); /* stops the workers */
+
+    std::vector<std::unique_ptr<executor_worker_s>> workers;
+    std::mutex lock;
+    std::condition_variable wake;
+    size_t queued = 0;
+    bool stopping = false;
+    unsigned long steals = 0;
+};
+
+/* workers is capped at EXECUTOR_MAX_WORKERS, the workers share nothing
+   with ndb_ctx but the api, trace and cancel, returns 0 if started */
+int executor_start(ndb_executor_s& executor, ndb_connection_context_s& ndb_ctx,
+    unsigned workers);
+
+void executor_submit(ndb_executor_s& executor, int node_id,
+    executor_job_t job);
+
+/* runs job for each node and waits for them all, with a null executor
+   the jobs run one after the other on ndb_ctx itself */
+void executor_for_each_node(ndb_executor_s* executor,
+    ndb_connection_context_s& ndb_ctx, const std::vector<int>& node_ids,
+    std::function<void(ndb_connection_context_s& node_ctx, int node_id,
+        int connect_err)>
+        job);
+
+/* finishes the queued jobs, then closes the worker connections */
+void executor_stop(ndb_executor_s& executor);
+
+#endif /* NDB_ROLLING_RESTART_EXECUTOR_HPP */
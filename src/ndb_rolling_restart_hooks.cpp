@@ -0,0 +1,198 @@
+/*
+ * ndb_rolling_restart_hooks
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_hooks.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+#define HOOK_POLL_MS 20
+
+static vector<string> hook_words(const string& point, unsigned wave,
+    const vector<int>& node_ids)
+{
+    vector<string> words{ point, to_string(wave) };
+    for (auto node_id : node_ids) {
+        words.push_back(to_string(node_id));
+    }
+    return words;
+}
+
+static int run_executable(const string& path, const vector<string>& words,
+    chrono::milliseconds timeout, string& error)
+{
+    /* everything the child needs is made before the fork, after it
+       only exec is called */
+    vector<char*> argv;
+    argv.push_back(const_cast<char*>(path.c_str()));
+    for (const auto& word : words) {
+        argv.push_back(const_cast<char*>(word.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        error = string("fork: ") + strerror(errno);
+        return 1;
+    }
+    if (pid == 0) {
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+
+    auto deadline = chrono::steady_clock::now() + timeout;
+    int status = 0;
+    for (;;) {
+        pid_t done = waitpid(pid, &status, WNOHANG);
+        if (done == pid) {
+            break;
+        }
+        if (done < 0 && errno != EINTR) {
+            error = string("waitpid: ") + strerror(errno);
+            return 1;
+        }
+        if (chrono::steady_clock::now() >= deadline) {
+            kill(pid, SIGKILL);
+            while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+            }
+            error = "timed out after " + to_string(timeout.count()) + "ms";
+            return 1;
+        }
+        this_thread::sleep_for(chrono::milliseconds(HOOK_POLL_MS));
+    }
+
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        return 0;
+    }
+    if (WIFEXITED(status)) {
+        error = "exited with " + to_string(WEXITSTATUS(status));
+    } else if (WIFSIGNALED(status)) {
+        error = "killed by signal " + to_string(WTERMSIG(status));
+    } else {
+        error = "failed";
+    }
+    return 1;
+}
+
+/* -1 on error or timeout, else the milliseconds left */
+static int ms_left(chrono::steady_clock::time_point deadline)
+{
+    auto left = chrono::duration_cast<chrono::milliseconds>(
+        deadline - chrono::steady_clock::now());
+    return left.count() > 0 ? (int)left.count() : -1;
+}
+
+static int call_socket(const string& path, const vector<string>& words,
+    chrono::milliseconds timeout, string& error)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        error = "socket path too long";
+        return 1;
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error = string("socket: ") + strerror(errno);
+        return 1;
+    }
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr))) {
+        error = "connect " + path + ": " + strerror(errno);
+        close(fd);
+        return 1;
+    }
+
+    string request;
+    for (const auto& word : words) {
+        request += (request.empty() ? "" : " ") + word;
+    }
+    request += "\n";
+
+    auto deadline = chrono::steady_clock::now() + timeout;
+    size_t sent = 0;
+    string reply;
+    int err = 0;
+    while (!err && sent < request.size()) {
+        ssize_t len = send(fd, request.data() + sent, request.size() - sent,
+            MSG_NOSIGNAL);
+        if (len < 0 && errno != EINTR) {
+            error = string("send: ") + strerror(errno);
+            err = 1;
+        } else if (len > 0) {
+            sent += (size_t)len;
+        }
+    }
+    while (!err && reply.find('\n') == string::npos) {
+        int wait_ms = ms_left(deadline);
+        if (wait_ms < 0) {
+            error = "timed out after " + to_string(timeout.count()) + "ms";
+            err = 1;
+            break;
+        }
+        pollfd readable{ fd, POLLIN, 0 };
+        int ready = poll(&readable, 1, wait_ms);
+        if (ready < 0 && errno != EINTR) {
+            error = string("poll: ") + strerror(errno);
+            err = 1;
+        } else if (ready > 0) {
+            char buf[256];
+            ssize_t len = recv(fd, buf, sizeof(buf), 0);
+            if (len == 0) {
+                break;
+            }
+            if (len < 0 && errno != EINTR) {
+                error = string("recv: ") + strerror(errno);
+                err = 1;
+            } else if (len > 0) {
+                reply.append(buf, (size_t)len);
+            }
+        }
+    }
+    close(fd);
+    if (err) {
+        return 1;
+    }
+
+    reply = reply.substr(0, reply.find('\n'));
+    if (reply.compare(0, 2, "ok") == 0) {
+        return 0;
+    }
+    error = reply.empty() ? "no answer" : "answered: " + reply;
+    return 1;
+}
+
+int run_wave_hook(const string& hook, const string& point, unsigned wave,
+    const vector<int>& node_ids, chrono::milliseconds timeout, string& error)
+{
+    vector<string> words = hook_words(point, wave, node_ids);
+    const string socket_prefix = WAVE_HOOK_SOCKET_PREFIX;
+    if (hook.compare(0, socket_prefix.size(), socket_prefix) == 0) {
+        return call_socket(hook.substr(socket_prefix.size()), words, timeout,
+            error);
+    }
+    return run_executable(hook, words, timeout, error);
+}
@@ -0,0 +1,47 @@
+/*
+ * ndb_rolling_restart_hooks.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_HOOKS_HPP
+#define NDB_ROLLING_RESTART_HOOKS_HPP 1
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/* a hook given as "unix:" and a path calls a socket, anything else is
+   an executable */
+#define WAVE_HOOK_SOCKET_PREFIX "unix:"
+
+/* Tells the outside world which nodes are about to go down and which
+   are back, e.g. so proxies can drain the SQL traffic from them.
+   pre_wave runs before ndb_mgm_restart4, the nodes are only stopped if
+   it succeeds, post_wave runs once the nodes are STARTED again, and
+   not at all if the restart is not waited for. */
+struct ndb_wave_hooks_s {
+    std::string pre_wave; /* none if empty */
+    std::string post_wave; /* none if empty */
+    std::chrono::seconds timeout{ 60 };
+};
+
+/* An executable is run as: hook point wave node_id...
+   and succeeds if it exits with 0. A socket is sent the same words on
+   one line and succeeds if the line it answers begins with "ok".
+   Either is given up on after timeout, an executable is then killed.
+   Returns 0 on success, else the reason is in error. */
+int run_wave_hook(const std::string& hook, const std::string& point,
+    unsigned wave, const std::vector<int>& node_ids,
+    std::chrono::milliseconds timeout, std::string& error);
+
+#endif /* NDB_ROLLING_RESTART_HOOKS_HPP */
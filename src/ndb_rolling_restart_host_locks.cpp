@@ -0,0 +1,104 @@
+/*
+ * ndb_rolling_restart_host_locks
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_host_locks.hpp"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+using namespace std;
+
+ndb_host_locks_s::~ndb_host_locks_s()
+{
+    for (auto& held_slot : held) {
+        close(held_slot.second.fd);
+    }
+}
+
+string host_lock_path(const ndb_host_locks_s& locks, const string& host,
+    unsigned slot)
+{
+    string name;
+    for (char c : host) {
+        bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+            || (c >= '0' && c <= '9') || c == '.' || c == '-';
+        name += safe ? c : '_';
+    }
+    return locks.dir + "/" + name + "." + to_string(slot) + ".lock";
+}
+
+static int lock_slot(const string& path, const string& owner)
+{
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        close(fd);
+        return -1;
+    }
+    string line = owner + " pid " + to_string(getpid()) + "\n";
+    if (ftruncate(fd, 0) != 0
+        || write(fd, line.c_str(), line.size()) != (ssize_t)line.size()) {
+        /* only for people looking, the lock is what counts */
+    }
+    return fd;
+}
+
+static int lock_any_slot(const ndb_host_locks_s& locks, const string& host,
+    const string& owner)
+{
+    for (unsigned slot = 0; slot < locks.slots_per_host; ++slot) {
+        int fd = lock_slot(host_lock_path(locks, host, slot), owner);
+        if (fd >= 0) {
+            return fd;
+        }
+    }
+    return -1;
+}
+
+int host_locks_acquire(ndb_host_locks_s& locks,
+    const vector<host_lock_node_s>& nodes, const string& owner,
+    string& busy_host)
+{
+    vector<int> taken;
+    for (auto& node : nodes) {
+        if (locks.held.count(node.node_id)) {
+            continue;
+        }
+        int fd = lock_any_slot(locks, node.host, owner);
+        if (fd < 0) {
+            for (int node_id : taken) {
+                host_locks_release(locks, node_id);
+            }
+            busy_host = node.host;
+            return 1;
+        }
+        locks.held[node.node_id] = host_lock_slot_s{ node.host, fd };
+        taken.push_back(node.node_id);
+    }
+    return 0;
+}
+
+void host_locks_release(ndb_host_locks_s& locks, int node_id)
+{
+    auto it = locks.held.find(node_id);
+    if (it == locks.held.end()) {
+        return;
+    }
+    close(it->second.fd);
+    locks.held.erase(it);
+}
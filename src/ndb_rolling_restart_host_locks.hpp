@@ -0,0 +1,61 @@
+/*
+ * ndb_rolling_restart_host_locks.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_HOST_LOCKS_HPP
+#define NDB_ROLLING_RESTART_HOST_LOCKS_HPP 1
+
+#include <map>
+#include <string>
+#include <vector>
+
+struct host_lock_node_s {
+    int node_id;
+    std::string host;
+};
+
+struct host_lock_slot_s {
+    std::string host;
+    int fd;
+};
+
+/* Lets the orchestrators of several clusters share hosts: each
+   recovering node holds one of slots_per_host lock files of its host
+   in dir, "host.slot.lock", with flock(2). The locks go with the
+   process, one which dies frees its slots. The directory must be on a
+   file system all orchestrators see and which supports flock. */
+struct ndb_host_locks_s {
+    ~ndb_host_locks_s(); /* releases every slot */
+
+    std::string dir;
+    unsigned slots_per_host = 1;
+    /* by node id */
+    std::map<int, host_lock_slot_s> held;
+};
+
+/* Takes a slot for every node, or none: if a host has no free slot the
+   slots taken are released again, busy_host is set and 1 returned,
+   also if the slots are held by this process. owner is written to the
+   lock files, to see who holds them. */
+int host_locks_acquire(ndb_host_locks_s& locks,
+    const std::vector<host_lock_node_s>& nodes, const std::string& owner,
+    std::string& busy_host);
+
+void host_locks_release(ndb_host_locks_s& locks, int node_id);
+
+/* the lock file of a slot, the host made safe for a file name */
+std::string host_lock_path(const ndb_host_locks_s& locks,
+    const std::string& host, unsigned slot);
+
+#endif /* NDB_ROLLING_RESTART_HOST_LOCKS_HPP */
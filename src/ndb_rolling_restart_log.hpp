@@ -0,0 +1,62 @@
+/*
+ * ndb_rolling_restart_log.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_LOG_HPP
+#define NDB_ROLLING_RESTART_LOG_HPP 1
+
+#include "ndb_rolling_restart.hpp"
+#include <sstream>
+
+/* passes the event to ndb_ctx.on_event, if set */
+void emit_restart_event(ndb_connection_context_s& ndb_ctx,
+    restart_event_type_e type, int node_id, long long value,
+    const std::string& message);
+
+/* collects one message and emits it as an event when it goes out of
+   scope, at the end of the full expression for a temporary */
+struct log_line_s {
+    log_line_s(ndb_connection_context_s& ndb_ctx, restart_event_type_e type,
+        int node_id)
+        : ndb_ctx(ndb_ctx)
+        , type(type)
+        , node_id(node_id)
+    {
+    }
+
+    ~log_line_s()
+    {
+        std::string message = out.str();
+        while (!message.empty() && message.back() == '\n') {
+            message.pop_back();
+        }
+        emit_restart_event(ndb_ctx, type, node_id, 0, message);
+    }
+
+    ndb_connection_context_s& ndb_ctx;
+    restart_event_type_e type;
+    int node_id;
+    std::ostringstream out;
+};
+
+#define Cout(ndb_ctx) log_line_s(ndb_ctx, RESTART_EVENT_LOG, 0).out
+
+#define Cnode(ndb_ctx, node_id) \
+    log_line_s(ndb_ctx, RESTART_EVENT_LOG, node_id).out
+
+#define Cerr(ndb_ctx) \
+    log_line_s(ndb_ctx, RESTART_EVENT_ERROR, 0).out \
+        << __FILE__ << ":" << __LINE__ << ": "
+
+#endif /* NDB_ROLLING_RESTART_LOG_HPP */
@@ -0,0 +1,236 @@
+/*
+ * ndb_rolling_restart_logger
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_logger.hpp"
+#include "ndb_rolling_restart_trace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <system_error>
+
+using namespace std;
+
+static atomic<unsigned long> next_logger_id{ 1 };
+
+struct thread_ring_s {
+    unsigned long logger_id;
+    log_ring_s* ring;
+};
+
+/* the rings this thread logs to, at most one per logger */
+static thread_local vector<thread_ring_s> thread_rings;
+
+log_ring_s::log_ring_s(size_t capacity)
+    : slots(capacity)
+{
+}
+
+ndb_logger_s::ndb_logger_s()
+    : id(next_logger_id++)
+    , epoch(chrono::steady_clock::now())
+{
+}
+
+ndb_logger_s::~ndb_logger_s()
+{
+    stop_logger(*this);
+}
+
+static const char* event_type_name(restart_event_type_e type)
+{
+    switch (type) {
+    case RESTART_EVENT_LOG:
+        return "log";
+    case RESTART_EVENT_ERROR:
+        return "error";
+    case RESTART_EVENT_PLAN:
+        return "plan";
+    case RESTART_EVENT_WAVE_BEGIN:
+        return "wave_begin";
+    case RESTART_EVENT_NODE_BEGIN:
+        return "node_begin";
+    case RESTART_EVENT_NODE_PHASE:
+        return "node_phase";
+    case RESTART_EVENT_NODE_DONE:
+        return "node_done";
+    case RESTART_EVENT_FINISHED:
+        return "finished";
+    }
+    return "unknown";
+}
+
+void format_log_record(const log_record_s& record, log_format_e format,
+    ostream& out)
+{
+    const restart_event_s& event = record.event;
+
+    if (format == LOG_FORMAT_JSON) {
+        out << "{\"ts_us\":" << record.timestamp_us << ",\"type\":\""
+            << event_type_name(event.type) << "\",\"wave\":" << event.wave
+            << ",\"node\":" << event.node_id << ",\"value\":" << event.value
+            << ",\"message\":\"" << json_escape(event.message) << "\"}\n";
+        return;
+    }
+
+    if (event.type != RESTART_EVENT_LOG && event.type != RESTART_EVENT_ERROR) {
+        /* progress events are already described by the log messages */
+        return;
+    }
+    char timestamp[32];
+    snprintf(timestamp, sizeof(timestamp), "[%11.6f] ",
+        record.timestamp_us / 1000000.0);
+    out << timestamp;
+    if (event.wave) {
+        out << "[wave " << event.wave << "] ";
+    }
+    out << event.message << "\n";
+}
+
+static log_ring_s* get_thread_ring(ndb_logger_s& logger)
+{
+    for (const auto& thread_ring : thread_rings) {
+        if (thread_ring.logger_id == logger.id) {
+            return thread_ring.ring;
+        }
+    }
+
+    log_ring_s* ring = new log_ring_s(logger.ring_capacity);
+    {
+        lock_guard<mutex> guard(logger.rings_lock);
+        logger.rings.emplace_back(ring);
+    }
+    thread_rings.push_back(thread_ring_s{ logger.id, ring });
+    return ring;
+}
+
+void log_restart_event(ndb_logger_s& logger, const restart_event_s& event)
+{
+    auto now = chrono::steady_clock::now();
+    log_ring_s* ring = get_thread_ring(logger);
+
+    size_t head = ring->head.load(memory_order_relaxed);
+    size_t tail = ring->tail.load(memory_order_acquire);
+    if (head - tail >= ring->slots.size()) {
+        logger.dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    log_record_s& record = ring->slots[head % ring->slots.size()];
+    record.timestamp_us = chrono::duration_cast<chrono::microseconds>(
+        now - logger.epoch)
+                              .count();
+    record.event = event;
+    ring->head.store(head + 1, memory_order_release);
+}
+
+static void drain_rings(ndb_logger_s& logger, vector<log_record_s>& batch)
+{
+    vector<log_ring_s*> rings;
+    {
+        lock_guard<mutex> guard(logger.rings_lock);
+        for (const auto& ring : logger.rings) {
+            rings.push_back(ring.get());
+        }
+    }
+
+    for (auto ring : rings) {
+        size_t tail = ring->tail.load(memory_order_relaxed);
+        size_t head = ring->head.load(memory_order_acquire);
+        for (; tail != head; ++tail) {
+            batch.push_back(move(ring->slots[tail % ring->slots.size()]));
+        }
+        ring->tail.store(tail, memory_order_release);
+    }
+
+    stable_sort(batch.begin(), batch.end(),
+        [](const log_record_s& r1, const log_record_s& r2) {
+            return r1.timestamp_us < r2.timestamp_us;
+        });
+}
+
+static void write_batch(ndb_logger_s& logger, vector<log_record_s>& batch,
+    unsigned long& dropped_reported)
+{
+    batch.clear();
+    drain_rings(logger, batch);
+
+    unsigned long dropped = logger.dropped.load(memory_order_relaxed);
+    if (dropped != dropped_reported) {
+        log_record_s record;
+        record.timestamp_us = chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now() - logger.epoch)
+                                  .count();
+        record.event = restart_event_s{ RESTART_EVENT_ERROR, 0, 0,
+            (long long)(dropped - dropped_reported),
+            "log buffer full, dropped "
+                + to_string(dropped - dropped_reported) + " records" };
+        batch.push_back(record);
+        dropped_reported = dropped;
+    }
+    if (batch.empty()) {
+        return;
+    }
+
+    bool wrote_err = false;
+    for (const auto& record : batch) {
+        ostream* out = logger.out;
+        if (logger.format == LOG_FORMAT_TEXT
+            && record.event.type == RESTART_EVENT_ERROR) {
+            out = logger.err;
+            wrote_err = true;
+        }
+        format_log_record(record, logger.format, *out);
+    }
+    logger.out->flush();
+    if (wrote_err) {
+        logger.err->flush();
+    }
+}
+
+static void logger_run(ndb_logger_s* logger)
+{
+    vector<log_record_s> batch;
+    unsigned long dropped_reported = 0;
+    while (!logger->writer_stop.load()) {
+        this_thread::sleep_for(
+            chrono::milliseconds(logger->flush_interval_ms));
+        write_batch(*logger, batch, dropped_reported);
+    }
+    write_batch(*logger, batch, dropped_reported);
+}
+
+int start_logger(ndb_logger_s& logger, log_format_e format, ostream& out,
+    ostream& err)
+{
+    logger.format = format;
+    logger.out = &out;
+    logger.err = &err;
+    logger.writer_stop = false;
+    try {
+        logger.writer = thread(logger_run, &logger);
+    } catch (const system_error&) {
+        return 1;
+    }
+    return 0;
+}
+
+void stop_logger(ndb_logger_s& logger)
+{
+    if (!logger.writer.joinable()) {
+        return;
+    }
+    logger.writer_stop = true;
+    logger.writer.join();
+}
@@ -0,0 +1,86 @@
+/*
+ * ndb_rolling_restart_logger.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_LOGGER_HPP
+#define NDB_ROLLING_RESTART_LOGGER_HPP 1
+
+#include "ndb_rolling_restart.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+enum log_format_e {
+    LOG_FORMAT_TEXT = 0, /* log and error messages, as before */
+    LOG_FORMAT_JSON /* one object per line, every event */
+};
+
+struct log_record_s {
+    int64_t timestamp_us; /* monotonic, since the logger was started */
+    restart_event_s event;
+};
+
+/* Single producer, single consumer ring. The producing thread only
+   writes head and the writer thread only writes tail, so neither side
+   takes a lock. When the ring is full the record is dropped and counted
+   rather than making the producer wait. */
+struct log_ring_s {
+    explicit log_ring_s(size_t capacity);
+
+    std::vector<log_record_s> slots;
+    std::atomic<size_t> head{ 0 };
+    std::atomic<size_t> tail{ 0 };
+};
+
+/* Events are handed to a ring of the calling thread and written by a
+   background thread, which merges the rings in timestamp order and
+   flushes once per batch. Restart threads never wait for the terminal
+   or the disk. */
+struct ndb_logger_s {
+    ndb_logger_s();
+    ~ndb_logger_s(); /* stops the writer */
+
+    log_format_e format = LOG_FORMAT_TEXT;
+    std::ostream* out = nullptr; /* not owned */
+    std::ostream* err = nullptr; /* errors in text format, not owned */
+    size_t ring_capacity = 4096;
+    unsigned flush_interval_ms = 50;
+
+    unsigned long id; /* tells apart loggers for the per-thread rings */
+    std::chrono::steady_clock::time_point epoch;
+    std::mutex rings_lock; /* only taken when a thread logs first */
+    std::vector<std::unique_ptr<log_ring_s>> rings;
+    std::atomic<unsigned long> dropped{ 0 };
+    std::atomic<bool> writer_stop{ false };
+    std::thread writer;
+};
+
+/* writes one record, with the trailing newline */
+void format_log_record(const log_record_s& record, log_format_e format,
+    std::ostream& out);
+
+/* starts the writer thread, err may be the same stream as out */
+int start_logger(ndb_logger_s& logger, log_format_e format, std::ostream& out,
+    std::ostream& err);
+
+/* does not block, may be called from any thread */
+void log_restart_event(ndb_logger_s& logger, const restart_event_s& event);
+
+/* writes what is left in the rings and joins the writer */
+void stop_logger(ndb_logger_s& logger);
+
+#endif /* NDB_ROLLING_RESTART_LOGGER_HPP */
@@ -14,10 +14,30 @@
  */
 
 #include "ndb_rolling_restart.hpp"
+#include "ndb_rolling_restart_copy_progress.hpp"
+#include "ndb_rolling_restart_dry_run.hpp"
+#include "ndb_rolling_restart_epochs.hpp"
+#include "ndb_rolling_restart_executor.hpp"
+#include "ndb_rolling_restart_hooks.hpp"
+#include "ndb_rolling_restart_host_locks.hpp"
+#include "ndb_rolling_restart_logger.hpp"
+#include "ndb_rolling_restart_metrics.hpp"
+#include "ndb_rolling_restart_replay.hpp"
+#include "ndb_rolling_restart_schedule.hpp"
+#include "ndb_rolling_restart_select.hpp"
+#include "ndb_rolling_restart_stats.hpp"
+#include "ndb_rolling_restart_trace.hpp"
+#include "ndb_rolling_restart_upgrade.hpp"
+#include "ndb_rolling_restart_watch.hpp"
 #include <assert.h>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <fstream>
 #include <getopt.h>
 #include <iostream>
 #include <stdlib.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -26,10 +46,80 @@ using namespace std;
 /* Global */
 int verbose_flag = 0;
 
+/* Global, set by the signal handlers */
+static std::atomic<bool> signal_cancel{ false };
+static std::atomic<bool> signal_pause{ false };
+
+/* SIGINT and SIGTERM cancel at the next safe point, a second one kills,
+   SIGUSR1 pauses and SIGUSR2 resumes */
+static void control_signal(int signum)
+{
+    switch (signum) {
+    case SIGUSR1:
+        signal_pause.store(true);
+        break;
+    case SIGUSR2:
+        signal_pause.store(false);
+        break;
+    default:
+        signal_cancel.store(true);
+        signal(signum, SIG_DFL);
+        break;
+    }
+}
+
+static void handle_control_signals()
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = control_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    int signums[] = { SIGINT, SIGTERM, SIGUSR1, SIGUSR2 };
+    for (auto signum : signums) {
+        sigaction(signum, &action, nullptr);
+    }
+}
+
 /* Global */
 static option long_options[] = {
     { "connection_string", required_argument, nullptr, 'c' },
     { "wait_seconds", required_argument, nullptr, 'w' },
+    { "initial", no_argument, nullptr, 'i' },
+    { "parallel", no_argument, nullptr, 'p' },
+    { "preflight", no_argument, nullptr, 'P' },
+    { "dry_run", no_argument, nullptr, 'D' },
+    { "status", no_argument, nullptr, 'Q' },
+    { "watch", no_argument, nullptr, 'M' },
+    { "watch_interval", required_argument, nullptr, 'I' },
+    { "upgrade", no_argument, nullptr, 'u' },
+    { "upgrade_to", required_argument, nullptr, 'U' },
+    { "upgrade_wait", required_argument, nullptr, 'Y' },
+    { "upgrade_start_hook", required_argument, nullptr, 'y' },
+    { "ready_start_phase", required_argument, nullptr, 'S' },
+    { "select", required_argument, nullptr, 'n' },
+    { "schedule", required_argument, nullptr, 'o' },
+    { "plan_cache", required_argument, nullptr, 'C' },
+    { "workers", required_argument, nullptr, 'W' },
+    { "stats", no_argument, nullptr, 'T' },
+    { "copy_progress", no_argument, nullptr, 'k' },
+    { "control_file", required_argument, nullptr, 'F' },
+    { "pre_wave_hook", required_argument, nullptr, 'b' },
+    { "post_wave_hook", required_argument, nullptr, 'a' },
+    { "hook_timeout", required_argument, nullptr, 'x' },
+    { "host_lock_dir", required_argument, nullptr, 'H' },
+    { "host_slots", required_argument, nullptr, 'N' },
+    { "baseline_file", required_argument, nullptr, 'B' },
+    { "regression_percent", required_argument, nullptr, 'G' },
+    { "epoch_file", required_argument, nullptr, 'e' },
+    { "restarted_since", required_argument, nullptr, 'E' },
+    { "trace_file", required_argument, nullptr, 't' },
+    { "metrics_file", required_argument, nullptr, 'm' },
+    { "record", required_argument, nullptr, 'r' },
+    { "replay", required_argument, nullptr, 'R' },
+    { "replay_speed", required_argument, nullptr, 's' },
+    { "log_file", required_argument, nullptr, 'l' },
+    { "log_format", required_argument, nullptr, 'f' },
     { "verbose", no_argument, &verbose_flag, 1 },
     { 0, 0, 0, 0 }
 };
@@ -37,10 +127,32 @@ static option long_options[] = {
 int main(int argc, char** argv)
 {
     ndb_connection_context_s ndb_ctx;
+    node_selection_s selection;
+    restart_epochs_s epochs;
+    string epoch_file;
+    bool skip_fresh = false;
+    unsigned workers = 0;
+    ndb_stats_s stats;
+    bool copy_progress = false;
+    bool dry_run = false;
+    bool status = false;
+    bool watch_mode = false;
+    ndb_watch_s watch;
+    bool upgrade_mode = false;
+    ndb_upgrade_s upgrade;
+    ndb_wave_hooks_s hooks;
+    ndb_host_locks_s host_locks;
+    string log_file;
+    log_format_e log_format = LOG_FORMAT_TEXT;
+    string trace_file;
+    string metrics_file;
+    string record_file;
+    string replay_file;
+    double replay_speed = 10.0;
 
     int option_index = 0;
     int c;
-    while ((c = getopt_long(argc, argv, "c:w:", long_options, &option_index)) != -1) {
+    while ((c = getopt_long(argc, argv, "c:w:ipPDQMI:uU:Y:y:S:n:o:C:W:TkF:b:a:x:H:N:B:G:e:E:t:m:r:R:s:l:f:", long_options, &option_index)) != -1) {
 
         switch (c) {
         case 0: {
@@ -61,11 +173,376 @@ int main(int argc, char** argv)
             }
             break;
         }
+        case 'i': {
+            ndb_ctx.initial_restart = true;
+            break;
+        }
+        case 'p': {
+            ndb_ctx.parallel_node_groups = true;
+            break;
+        }
+        case 'P': {
+            ndb_ctx.preflight_next_wave = true;
+            break;
+        }
+        case 'D': {
+            dry_run = true;
+            break;
+        }
+        case 'Q': {
+            status = true;
+            break;
+        }
+        case 'M': {
+            watch_mode = true;
+            break;
+        }
+        case 'I': {
+            char* temp;
+            unsigned long interval_arg = strtoul(optarg, &temp, 10);
+            if (optarg == temp || *temp != '\0' || !interval_arg) {
+                Cerr << "bad --watch_interval '" << optarg << "'" << endl;
+                return EXIT_FAILURE;
+            }
+            watch.interval = chrono::milliseconds(interval_arg);
+            break;
+        }
+        case 'u': {
+            upgrade_mode = true;
+            break;
+        }
+        case 'U': {
+            if (parse_ndb_version(optarg, upgrade.target)) {
+                Cerr << "bad --upgrade_to '" << optarg << "'" << endl;
+                return EXIT_FAILURE;
+            }
+            upgrade_mode = true;
+            break;
+        }
+        case 'Y': {
+            char* temp;
+            unsigned long wait_arg = strtoul(optarg, &temp, 10);
+            if (optarg == temp || *temp != '\0' || !wait_arg) {
+                Cerr << "bad --upgrade_wait '" << optarg << "'" << endl;
+                return EXIT_FAILURE;
+            }
+            upgrade.node_wait = chrono::seconds(wait_arg);
+            break;
+        }
+        case 'y': {
+            upgrade.start_hook = optarg;
+            break;
+        }
+        case 'S': {
+            char* temp;
+            long phase_arg = strtol(optarg, &temp, 10);
+            if (optarg != temp && *temp == '\0' && phase_arg >= 0) {
+                ndb_ctx.ready_start_phase = (int)phase_arg;
+            }
+            break;
+        }
+        case 'n': {
+            string error;
+            if (parse_node_selection(optarg, selection, error)) {
+                Cerr << "--select: " << error << endl
+                     << NODE_SELECTION_USAGE;
+                return EXIT_FAILURE;
+            }
+            ndb_ctx.selection = &selection;
+            break;
+        }
+        case 'o': {
+            ndb_ctx.schedule = find_schedule_policy(optarg);
+            if (!ndb_ctx.schedule) {
+                Cerr << "unknown schedule '" << optarg << "', one of:";
+                for (const auto* policy : schedule_policies()) {
+                    cerr << " " << policy->name();
+                }
+                cerr << endl;
+                return EXIT_FAILURE;
+            }
+            break;
+        }
+        case 'C': {
+            ndb_ctx.plan_cache = optarg;
+            break;
+        }
+        case 'W': {
+            char* temp;
+            unsigned long workers_arg = strtoul(optarg, &temp, 10);
+            if (optarg == temp || *temp != '\0'
+                || workers_arg > EXECUTOR_MAX_WORKERS) {
+                Cerr << "--workers: 0 to " << EXECUTOR_MAX_WORKERS << endl;
+                return EXIT_FAILURE;
+            }
+            workers = (unsigned)workers_arg;
+            break;
+        }
+        case 'T': {
+            ndb_ctx.stats = &stats;
+            break;
+        }
+        case 'k': {
+            copy_progress = true;
+            break;
+        }
+        case 'F': {
+            ndb_ctx.control_file = optarg;
+            break;
+        }
+        case 'b': {
+            hooks.pre_wave = optarg;
+            ndb_ctx.hooks = &hooks;
+            break;
+        }
+        case 'a': {
+            hooks.post_wave = optarg;
+            ndb_ctx.hooks = &hooks;
+            break;
+        }
+        case 'x': {
+            char* temp;
+            unsigned long timeout_arg = strtoul(optarg, &temp, 10);
+            if (optarg == temp || *temp != '\0' || !timeout_arg) {
+                Cerr << "bad --hook_timeout '" << optarg << "'" << endl;
+                return EXIT_FAILURE;
+            }
+            hooks.timeout = chrono::seconds(timeout_arg);
+            upgrade.hook_timeout = hooks.timeout;
+            break;
+        }
+        case 'H': {
+            host_locks.dir = optarg;
+            ndb_ctx.host_locks = &host_locks;
+            break;
+        }
+        case 'N': {
+            char* temp;
+            unsigned long slots_arg = strtoul(optarg, &temp, 10);
+            if (optarg == temp || *temp != '\0' || !slots_arg) {
+                Cerr << "bad --host_slots '" << optarg << "'" << endl;
+                return EXIT_FAILURE;
+            }
+            host_locks.slots_per_host = (unsigned)slots_arg;
+            break;
+        }
+        case 'B': {
+            stats.baseline_path = optarg;
+            ndb_ctx.stats = &stats;
+            break;
+        }
+        case 'G': {
+            char* temp;
+            double percent_arg = strtod(optarg, &temp);
+            if (optarg == temp || *temp != '\0' || percent_arg < 0) {
+                Cerr << "bad --regression_percent '" << optarg << "'" << endl;
+                return EXIT_FAILURE;
+            }
+            stats.regression_threshold = percent_arg / 100.0;
+            break;
+        }
+        case 'e': {
+            epoch_file = optarg;
+            skip_fresh = true;
+            break;
+        }
+        case 'E': {
+            /* unix seconds, or if negative that many seconds ago */
+            char* temp;
+            long long since_arg = strtoll(optarg, &temp, 10);
+            if (optarg == temp || *temp != '\0' || since_arg == 0) {
+                Cerr << "bad --restarted_since '" << optarg << "'" << endl;
+                return EXIT_FAILURE;
+            }
+            epochs.skip_since = since_arg > 0 ? since_arg
+                                              : time(nullptr) + since_arg;
+            skip_fresh = true;
+            break;
+        }
+        case 't': {
+            trace_file = optarg;
+            break;
+        }
+        case 'm': {
+            metrics_file = optarg;
+            break;
+        }
+        case 'r': {
+            record_file = optarg;
+            break;
+        }
+        case 'R': {
+            replay_file = optarg;
+            break;
+        }
+        case 's': {
+            char* temp;
+            double speed_arg = strtod(optarg, &temp);
+            if (optarg != temp && *temp == '\0' && speed_arg >= 0) {
+                replay_speed = speed_arg;
+            }
+            break;
+        }
+        case 'l': {
+            log_file = optarg;
+            break;
+        }
+        case 'f': {
+            if (string(optarg) == "json") {
+                log_format = LOG_FORMAT_JSON;
+            } else if (string(optarg) == "text") {
+                log_format = LOG_FORMAT_TEXT;
+            } else {
+                Cerr << "unknown log format '" << optarg << "'" << endl;
+                return EXIT_FAILURE;
+            }
+            break;
+        }
         default: {
             abort();
         }
         }
     }
 
-    return ndb_rolling_restart(ndb_ctx);
+    ndb_live_api_s live_api;
+    ndb_record_api_s record_api(live_api);
+    ndb_replay_api_s replay_api(replay_speed);
+    if (!replay_file.empty()) {
+        if (replay_api.open(replay_file)) {
+            Cerr << "could not read replay log '" << replay_file << "'"
+                 << endl;
+            return EXIT_FAILURE;
+        }
+        ndb_ctx.api = &replay_api;
+    } else if (!record_file.empty()) {
+        if (record_api.open(record_file)) {
+            Cerr << "could not create record log '" << record_file << "'"
+                 << endl;
+            return EXIT_FAILURE;
+        }
+        ndb_ctx.api = &record_api;
+    }
+
+    if (ndb_ctx.host_locks && access(host_locks.dir.c_str(), W_OK) != 0) {
+        Cerr << "can not write host locks to '" << host_locks.dir << "'"
+             << endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!epoch_file.empty() && read_restart_epochs(epochs, epoch_file)) {
+        Cerr << "could not read epoch file '" << epoch_file << "'" << endl;
+        return EXIT_FAILURE;
+    }
+    if (skip_fresh) {
+        ndb_ctx.epochs = &epochs;
+    }
+
+    ndb_trace_s trace;
+    if (!trace_file.empty()) {
+        ndb_ctx.trace = &trace;
+    }
+
+    ndb_metrics_s metrics;
+    if (!metrics_file.empty()) {
+        if (start_metrics_writer(metrics, metrics_file)) {
+            Cerr << "could not write metrics to '" << metrics_file << "'"
+                 << endl;
+            return EXIT_FAILURE;
+        }
+        ndb_ctx.metrics = &metrics;
+    }
+
+    ofstream log_stream;
+    if (!log_file.empty()) {
+        log_stream.open(log_file.c_str(), ios::app);
+        if (!log_stream) {
+            Cerr << "could not open log file '" << log_file << "'" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    ndb_logger_s logger;
+    int err;
+    if (log_file.empty()) {
+        err = start_logger(logger, log_format, cout, cerr);
+    } else {
+        err = start_logger(logger, log_format, log_stream, log_stream);
+    }
+    if (err) {
+        Cerr << "could not start the logger" << endl;
+        return EXIT_FAILURE;
+    }
+    ndb_ctx.on_event = [&logger](const restart_event_s& event) {
+        log_restart_event(logger, event);
+    };
+
+    ndb_ctx.cancel = &signal_cancel;
+    ndb_ctx.pause = &signal_pause;
+    handle_control_signals();
+
+    auto begin = chrono::steady_clock::now();
+    ndb_init();
+    ndb_executor_s executor;
+    if (workers) {
+        if (executor_start(executor, ndb_ctx, workers)) {
+            Cerr << "could not start " << workers << " workers" << endl;
+        } else {
+            ndb_ctx.executor = &executor;
+        }
+    }
+    ndb_copy_monitor_s copy_monitor;
+    if (copy_progress) {
+        /* the monitor's connection is not part of a recording */
+        ndb_connection_context_s monitor_ctx = ndb_ctx;
+        if (ndb_ctx.api == &record_api) {
+            monitor_ctx.api = &live_api;
+        }
+        if (copy_monitor_start(copy_monitor, monitor_ctx)) {
+            Cerr << "no copy progress, could not subscribe to log events"
+                 << endl;
+        } else {
+            ndb_ctx.copy_monitor = &copy_monitor;
+        }
+    }
+    int rv;
+    if (watch_mode) {
+        watch.color = log_file.empty() && log_format == LOG_FORMAT_TEXT
+            && isatty(STDOUT_FILENO);
+        rv = ndb_rolling_restart_watch(ndb_ctx, watch);
+    } else if (status) {
+        rv = ndb_rolling_restart_status(ndb_ctx);
+    } else if (upgrade_mode) {
+        rv = ndb_rolling_restart_upgrade(ndb_ctx, upgrade);
+    } else if (dry_run) {
+        rv = ndb_rolling_restart_dry_run(ndb_ctx, stats.baseline_path);
+    } else {
+        rv = ndb_rolling_restart(ndb_ctx);
+    }
+    copy_monitor_stop(copy_monitor);
+    executor_stop(executor);
+    ndb_end(NDB_NORMAL_USER);
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(
+        chrono::steady_clock::now() - begin);
+
+    stop_logger(logger);
+
+    if (!replay_file.empty()) {
+        cout << "replayed " << replay_api.calls_replayed << " of "
+             << replay_api.records.size() << " calls in "
+             << elapsed.count() << " ms, divergences: "
+             << replay_api.divergences << endl;
+        if (replay_api.divergences) {
+            rv = EXIT_FAILURE;
+        }
+    } else if (!record_file.empty()) {
+        cout << "recorded " << record_api.calls_recorded << " calls to '"
+             << record_file << "'" << endl;
+    }
+
+    stop_metrics_writer(metrics);
+
+    if (!trace_file.empty() && write_chrome_trace(trace, trace_file)) {
+        Cerr << "could not write trace to '" << trace_file << "'" << endl;
+    }
+
+    return rv;
 }
@@ -0,0 +1,244 @@
+/*
+ * ndb_rolling_restart_metrics
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_metrics.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace std;
+
+#define METRIC_PREFIX "ndb_rolling_restart_"
+
+/* upper bounds in seconds, node restarts take from minutes to hours */
+static const unsigned duration_bucket_le[METRICS_DURATION_BUCKETS] = {
+    30, 60, 120, 300, 600, 1200, 1800, 3600, 7200, 14400
+};
+
+static const char* counter_names[METRICS_COUNTERS] = {
+    "restart_retries_total",
+    "wait_retries_total",
+    "reconnects_total"
+};
+
+ndb_metrics_s::ndb_metrics_s()
+{
+    for (auto& replicas : live_replicas) {
+        replicas.store(-1);
+    }
+    for (auto& bucket : duration_buckets) {
+        bucket.store(0);
+    }
+    for (auto& counter : counters) {
+        counter.store(0);
+    }
+}
+
+void metrics_plan(ndb_metrics_s* metrics, unsigned nodes, unsigned waves)
+{
+    if (!metrics) {
+        return;
+    }
+    metrics->nodes_pending.store(nodes, memory_order_relaxed);
+    metrics->waves_total.store(waves, memory_order_relaxed);
+}
+
+void metrics_wave_begin(ndb_metrics_s* metrics, unsigned wave)
+{
+    if (!metrics) {
+        return;
+    }
+    metrics->current_wave.store(wave, memory_order_relaxed);
+}
+
+void metrics_nodes_begin(ndb_metrics_s* metrics, unsigned nodes)
+{
+    if (!metrics) {
+        return;
+    }
+    metrics->nodes_pending.fetch_sub(nodes, memory_order_relaxed);
+    metrics->nodes_in_flight.fetch_add(nodes, memory_order_relaxed);
+}
+
+void metrics_node_done(ndb_metrics_s* metrics, uint64_t duration_ms)
+{
+    if (!metrics) {
+        return;
+    }
+    metrics->nodes_in_flight.fetch_sub(1, memory_order_relaxed);
+    metrics->nodes_done.fetch_add(1, memory_order_relaxed);
+
+    /* buckets are stored non-cumulative and summed up when formatting */
+    for (size_t i = 0; i < METRICS_DURATION_BUCKETS; ++i) {
+        if (duration_ms <= duration_bucket_le[i] * 1000ULL) {
+            metrics->duration_buckets[i].fetch_add(1, memory_order_relaxed);
+            break;
+        }
+    }
+    metrics->duration_count.fetch_add(1, memory_order_relaxed);
+    metrics->duration_sum_ms.fetch_add(duration_ms, memory_order_relaxed);
+}
+
+void metrics_count(ndb_metrics_s* metrics, metrics_counter_e counter)
+{
+    if (!metrics) {
+        return;
+    }
+    metrics->counters[counter].fetch_add(1, memory_order_relaxed);
+}
+
+void metrics_update_live_replicas(ndb_metrics_s* metrics,
+    const ndb_mgm_cluster_state* cluster_state)
+{
+    if (!metrics || !cluster_state) {
+        return;
+    }
+
+    int live[METRICS_MAX_NODE_GROUPS];
+    for (auto& replicas : live) {
+        replicas = -1;
+    }
+    for (int i = 0; i < cluster_state->no_of_nodes; ++i) {
+        auto& node_state = cluster_state->node_states[i];
+        if (node_state.node_type != NDB_MGM_NODE_TYPE_NDB
+            || node_state.node_group < 0
+            || node_state.node_group >= METRICS_MAX_NODE_GROUPS) {
+            continue;
+        }
+        int& replicas = live[node_state.node_group];
+        if (replicas < 0) {
+            replicas = 0;
+        }
+        if (node_state.node_status == NDB_MGM_NODE_STATUS_STARTED) {
+            ++replicas;
+        }
+    }
+    for (size_t i = 0; i < METRICS_MAX_NODE_GROUPS; ++i) {
+        metrics->live_replicas[i].store(live[i], memory_order_relaxed);
+    }
+}
+
+static void format_gauge(ostream& out, const char* name, const char* help,
+    uint64_t value)
+{
+    out << "# HELP " METRIC_PREFIX << name << " " << help << "\n"
+        << "# TYPE " METRIC_PREFIX << name << " gauge\n"
+        << METRIC_PREFIX << name << " " << value << "\n";
+}
+
+void format_metrics(const ndb_metrics_s& metrics, ostream& out)
+{
+    format_gauge(out, "nodes_pending", "Nodes not yet restarted.",
+        metrics.nodes_pending.load(memory_order_relaxed));
+    format_gauge(out, "nodes_in_flight", "Nodes currently restarting.",
+        metrics.nodes_in_flight.load(memory_order_relaxed));
+    format_gauge(out, "nodes_done", "Nodes restarted.",
+        metrics.nodes_done.load(memory_order_relaxed));
+    format_gauge(out, "current_wave", "Restart wave in progress.",
+        metrics.current_wave.load(memory_order_relaxed));
+    format_gauge(out, "waves_total", "Restart waves planned.",
+        metrics.waves_total.load(memory_order_relaxed));
+
+    out << "# HELP " METRIC_PREFIX "node_group_live_replicas"
+        << " Started data nodes per node group.\n"
+        << "# TYPE " METRIC_PREFIX "node_group_live_replicas gauge\n";
+    for (size_t i = 0; i < METRICS_MAX_NODE_GROUPS; ++i) {
+        int replicas = metrics.live_replicas[i].load(memory_order_relaxed);
+        if (replicas >= 0) {
+            out << METRIC_PREFIX "node_group_live_replicas{node_group=\""
+                << i << "\"} " << replicas << "\n";
+        }
+    }
+
+    out << "# HELP " METRIC_PREFIX "node_restart_duration_seconds"
+        << " Time from ndb_mgm_restart4 until the node is started.\n"
+        << "# TYPE " METRIC_PREFIX "node_restart_duration_seconds"
+        << " histogram\n";
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < METRICS_DURATION_BUCKETS; ++i) {
+        cumulative += metrics.duration_buckets[i].load(memory_order_relaxed);
+        out << METRIC_PREFIX "node_restart_duration_seconds_bucket{le=\""
+            << duration_bucket_le[i] << "\"} " << cumulative << "\n";
+    }
+    uint64_t count = metrics.duration_count.load(memory_order_relaxed);
+    out << METRIC_PREFIX "node_restart_duration_seconds_bucket{le=\"+Inf\"} "
+        << count << "\n"
+        << METRIC_PREFIX "node_restart_duration_seconds_sum "
+        << (metrics.duration_sum_ms.load(memory_order_relaxed) / 1000.0)
+        << "\n"
+        << METRIC_PREFIX "node_restart_duration_seconds_count " << count
+        << "\n";
+
+    for (size_t i = 0; i < METRICS_COUNTERS; ++i) {
+        out << "# TYPE " METRIC_PREFIX << counter_names[i] << " counter\n"
+            << METRIC_PREFIX << counter_names[i] << " "
+            << metrics.counters[i].load(memory_order_relaxed) << "\n";
+    }
+}
+
+int write_metrics_file(const ndb_metrics_s& metrics)
+{
+    string tmp_path = metrics.path + ".tmp";
+    {
+        ofstream out(tmp_path.c_str());
+        if (!out) {
+            return 1;
+        }
+        format_metrics(metrics, out);
+        out.flush();
+        if (!out) {
+            return 1;
+        }
+    }
+    if (rename(tmp_path.c_str(), metrics.path.c_str()) != 0) {
+        return 1;
+    }
+    return 0;
+}
+
+static void metrics_writer_loop(ndb_metrics_s* metrics)
+{
+    unique_lock<mutex> guard(metrics->writer_lock);
+    while (!metrics->writer_stop) {
+        write_metrics_file(*metrics);
+        metrics->writer_wake.wait_for(guard,
+            chrono::seconds(metrics->interval_seconds));
+    }
+    write_metrics_file(*metrics);
+}
+
+int start_metrics_writer(ndb_metrics_s& metrics, const string& path)
+{
+    metrics.path = path;
+    metrics.writer_stop = false;
+    if (write_metrics_file(metrics)) {
+        return 1;
+    }
+    metrics.writer = thread(metrics_writer_loop, &metrics);
+    return 0;
+}
+
+void stop_metrics_writer(ndb_metrics_s& metrics)
+{
+    if (!metrics.writer.joinable()) {
+        return;
+    }
+    {
+        lock_guard<mutex> guard(metrics.writer_lock);
+        metrics.writer_stop = true;
+    }
+    metrics.writer_wake.notify_all();
+    metrics.writer.join();
+}
@@ -0,0 +1,87 @@
+/*
+ * ndb_rolling_restart_metrics.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_METRICS_HPP
+#define NDB_ROLLING_RESTART_METRICS_HPP 1
+
+#include <mgmapi/mgmapi.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#define METRICS_MAX_NODE_GROUPS 144
+#define METRICS_DURATION_BUCKETS 10
+
+enum metrics_counter_e {
+    METRICS_RESTART_RETRIES = 0,
+    METRICS_WAIT_RETRIES,
+    METRICS_RECONNECTS,
+    METRICS_COUNTERS
+};
+
+/* The orchestration code only does relaxed atomic updates, the writer
+   thread takes a snapshot of the counters and renames a freshly written
+   file over the previous one, so readers never see a partial file.
+   The format is the Prometheus text exposition format, suitable for the
+   node_exporter textfile collector. */
+struct ndb_metrics_s {
+    std::atomic<unsigned> nodes_pending{ 0 };
+    std::atomic<unsigned> nodes_in_flight{ 0 };
+    std::atomic<unsigned> nodes_done{ 0 };
+    std::atomic<unsigned> current_wave{ 0 };
+    std::atomic<unsigned> waves_total{ 0 };
+    std::atomic<int> live_replicas[METRICS_MAX_NODE_GROUPS];
+    std::atomic<uint64_t> duration_buckets[METRICS_DURATION_BUCKETS];
+    std::atomic<uint64_t> duration_count{ 0 };
+    std::atomic<uint64_t> duration_sum_ms{ 0 };
+    std::atomic<uint64_t> counters[METRICS_COUNTERS];
+
+    std::string path;
+    unsigned interval_seconds = 5;
+    std::thread writer;
+    std::mutex writer_lock;
+    std::condition_variable writer_wake;
+    bool writer_stop = false;
+
+    ndb_metrics_s();
+};
+
+/* all of the following accept a null metrics and then do nothing */
+void metrics_plan(ndb_metrics_s* metrics, unsigned nodes, unsigned waves);
+
+void metrics_wave_begin(ndb_metrics_s* metrics, unsigned wave);
+
+void metrics_nodes_begin(ndb_metrics_s* metrics, unsigned nodes);
+
+void metrics_node_done(ndb_metrics_s* metrics, uint64_t duration_ms);
+
+void metrics_count(ndb_metrics_s* metrics, metrics_counter_e counter);
+
+void metrics_update_live_replicas(ndb_metrics_s* metrics,
+    const ndb_mgm_cluster_state* cluster_state);
+
+void format_metrics(const ndb_metrics_s& metrics, std::ostream& out);
+
+int write_metrics_file(const ndb_metrics_s& metrics);
+
+int start_metrics_writer(ndb_metrics_s& metrics, const std::string& path);
+
+void stop_metrics_writer(ndb_metrics_s& metrics);
+
+#endif /* NDB_ROLLING_RESTART_METRICS_HPP */
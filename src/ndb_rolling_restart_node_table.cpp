@@ -0,0 +1,170 @@
+/*
+ * ndb_rolling_restart_node_table
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_node_table.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+node_table_s::node_table_s()
+{
+    fill(rows, rows + NODE_TABLE_MAX_NODES, -1);
+}
+
+static bool has_group(int node_group)
+{
+    return node_group >= 0 && node_group < NODE_TABLE_MAX_GROUPS;
+}
+
+void update_node_table(node_table_s& table,
+    const ndb_mgm_cluster_state* cluster_state)
+{
+    for (auto node_id : table.node_ids) {
+        table.rows[node_id] = -1;
+    }
+    table.node_ids.clear();
+    table.node_groups.clear();
+    table.node_statuses.clear();
+    table.start_phases.clear();
+    table.connect_counts.clear();
+    table.present.reset();
+    table.started.reset();
+    table.grouped.reset();
+    for (auto& nodes : table.group_nodes) {
+        nodes.reset();
+    }
+    fill(table.group_live.begin(), table.group_live.end(), 0);
+    if (!cluster_state) {
+        return;
+    }
+
+    /* the status comes sorted by node id, but that is not promised */
+    for (int i = 0; i < cluster_state->no_of_nodes; ++i) {
+        const ndb_mgm_node_state& node_state = cluster_state->node_states[i];
+        if (node_state.node_id <= 0
+            || node_state.node_id >= NODE_TABLE_MAX_NODES) {
+            continue;
+        }
+        table.node_ids.push_back(node_state.node_id);
+    }
+    sort(table.node_ids.begin(), table.node_ids.end());
+    for (size_t row = 0; row < table.node_ids.size(); ++row) {
+        table.rows[table.node_ids[row]] = (short)row;
+    }
+    table.node_groups.resize(table.node_ids.size());
+    table.node_statuses.resize(table.node_ids.size());
+    table.start_phases.resize(table.node_ids.size());
+    table.connect_counts.resize(table.node_ids.size());
+
+    for (int i = 0; i < cluster_state->no_of_nodes; ++i) {
+        const ndb_mgm_node_state& node_state = cluster_state->node_states[i];
+        int row = node_table_row(table, node_state.node_id);
+        if (row < 0) {
+            continue;
+        }
+        table.node_groups[row] = node_state.node_group;
+        table.node_statuses[row] = node_state.node_status;
+        table.start_phases[row] = node_state.start_phase;
+        table.connect_counts[row] = node_state.connect_count;
+
+        bool started = node_state.node_status == NDB_MGM_NODE_STATUS_STARTED;
+        table.present.set(node_state.node_id);
+        table.started.set(node_state.node_id, started);
+        if (!has_group(node_state.node_group)) {
+            continue;
+        }
+        table.grouped.set(node_state.node_id);
+        size_t group = node_state.node_group;
+        if (group >= table.group_nodes.size()) {
+            table.group_nodes.resize(group + 1);
+            table.group_live.resize(group + 1, 0);
+        }
+        table.group_nodes[group].set(node_state.node_id);
+        if (started) {
+            ++table.group_live[group];
+        }
+    }
+}
+
+int node_table_row(const node_table_s& table, int node_id)
+{
+    if (node_id <= 0 || node_id >= NODE_TABLE_MAX_NODES) {
+        return -1;
+    }
+    return table.rows[node_id];
+}
+
+int node_table_group(const node_table_s& table, int node_id)
+{
+    int row = node_table_row(table, node_id);
+    return row < 0 ? -1 : table.node_groups[row];
+}
+
+int node_table_live_replicas(const node_table_s& table, int node_group)
+{
+    if (!has_group(node_group)
+        || (size_t)node_group >= table.group_nodes.size()
+        || table.group_nodes[node_group].none()) {
+        return -1;
+    }
+    return table.group_live[node_group];
+}
+
+node_mask_t node_table_group_nodes(const node_table_s& table,
+    const node_mask_t& nodes)
+{
+    node_mask_t group_nodes;
+    for (size_t group = 0; group < table.group_nodes.size(); ++group) {
+        if ((table.group_nodes[group] & nodes).any()) {
+            group_nodes |= table.group_nodes[group];
+        }
+    }
+    if ((nodes & ~table.grouped).any()) {
+        return table.present | nodes;
+    }
+    return group_nodes;
+}
+
+node_mask_t node_table_eligible(const node_table_s& table,
+    const node_mask_t& candidates)
+{
+    node_mask_t eligible = candidates & table.started & table.grouped
+        & ~table.in_flight;
+    node_mask_t staying = table.started & ~table.in_flight & ~candidates;
+    for (const auto& group : table.group_nodes) {
+        if ((group & eligible).any() && (group & staying).none()) {
+            eligible &= ~group;
+        }
+    }
+    return eligible;
+}
+
+node_mask_t node_mask(const vector<int>& node_ids)
+{
+    node_mask_t mask;
+    for (auto node_id : node_ids) {
+        if (node_id > 0 && node_id < NODE_TABLE_MAX_NODES) {
+            mask.set(node_id);
+        }
+    }
+    return mask;
+}
+
+bool node_mask_test(const node_mask_t& mask, int node_id)
+{
+    return node_id > 0 && node_id < NODE_TABLE_MAX_NODES
+        && mask.test(node_id);
+}
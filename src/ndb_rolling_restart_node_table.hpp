@@ -0,0 +1,93 @@
+/*
+ * ndb_rolling_restart_node_table.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_NODE_TABLE_HPP
+#define NDB_ROLLING_RESTART_NODE_TABLE_HPP 1
+
+#include <mgmapi/mgmapi.h>
+#include <bitset>
+#include <vector>
+
+/* node ids are 1 to 255 */
+#define NODE_TABLE_MAX_NODES 256
+/* node groups from 0, a node without one, e.g. 65536, has no counters */
+#define NODE_TABLE_MAX_GROUPS 256
+
+/* a set of nodes, bit node_id */
+typedef std::bitset<NODE_TABLE_MAX_NODES> node_mask_t;
+
+/* The data nodes of the latest status poll as columns, a row per node
+   sorted by node id, with masks and per node group counters so that
+   the restart loop asks in constant time instead of scanning the
+   node_states of ndb_mgm_cluster_state. The vectors are reused, once
+   they have grown to the size of the cluster a poll does not allocate.
+   in_flight and done are kept by the restart, not by a poll. */
+struct node_table_s {
+    std::vector<int> node_ids;
+    std::vector<int> node_groups;
+    std::vector<ndb_mgm_node_status> node_statuses;
+    std::vector<int> start_phases;
+    std::vector<int> connect_counts;
+    /* by node id, -1 if the node is not in the table */
+    short rows[NODE_TABLE_MAX_NODES];
+
+    node_mask_t present;
+    node_mask_t started;
+    /* in a node group below NODE_TABLE_MAX_GROUPS */
+    node_mask_t grouped;
+    /* by node group */
+    std::vector<node_mask_t> group_nodes;
+    std::vector<int> group_live;
+
+    /* told to restart and not yet STARTED again */
+    node_mask_t in_flight;
+    /* restarted by this run */
+    node_mask_t done;
+
+    node_table_s();
+};
+
+/* rebuilds the columns, masks and counters from cluster_state, the
+   restart sets are kept */
+void update_node_table(node_table_s& table,
+    const ndb_mgm_cluster_state* cluster_state);
+
+/* -1 if the node is not in the table */
+int node_table_row(const node_table_s& table, int node_id);
+
+/* -1 if unknown */
+int node_table_group(const node_table_s& table, int node_id);
+
+/* the STARTED nodes of the node group, -1 if there is no such group */
+int node_table_live_replicas(const node_table_s& table, int node_group);
+
+/* the nodes of every node group any of nodes is in, all nodes if the
+   node group of one of them is unknown */
+node_mask_t node_table_group_nodes(const node_table_s& table,
+    const node_mask_t& nodes);
+
+/* those of candidates which may go down now: STARTED, not in flight,
+   and their node group keeps a STARTED node which is neither in flight
+   nor a candidate */
+node_mask_t node_table_eligible(const node_table_s& table,
+    const node_mask_t& candidates);
+
+/* node ids out of range are left out */
+node_mask_t node_mask(const std::vector<int>& node_ids);
+
+/* false for node ids out of range */
+bool node_mask_test(const node_mask_t& mask, int node_id);
+
+#endif /* NDB_ROLLING_RESTART_NODE_TABLE_HPP */
@@ -0,0 +1,164 @@
+/*
+ * ndb_rolling_restart_plan_cache
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_plan_cache.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+using namespace std;
+
+uint64_t fnv1a_64(const void* data, size_t len, uint64_t hash)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV1A_64_PRIME;
+    }
+    return hash;
+}
+
+static uint64_t fnv1a_64_int(int value, uint64_t hash)
+{
+    /* fixed width and byte order, the file may move between hosts */
+    unsigned char bytes[4];
+    for (size_t i = 0; i < sizeof(bytes); ++i) {
+        bytes[i] = (unsigned char)((uint32_t)value >> (8 * i));
+    }
+    return fnv1a_64(bytes, sizeof(bytes), hash);
+}
+
+uint64_t topology_fingerprint(const ndb_mgm_cluster_state* cluster_state,
+    const vector<restart_node_status_s>& node_restarts,
+    const string& schedule)
+{
+    set<int> pending;
+    for (const auto& node : node_restarts) {
+        if (!node.was_restarted) {
+            pending.insert(node.node_id);
+        }
+    }
+
+    vector<const ndb_mgm_node_state*> nodes;
+    for (int i = 0; i < cluster_state->no_of_nodes; ++i) {
+        nodes.push_back(&cluster_state->node_states[i]);
+    }
+    sort(nodes.begin(), nodes.end(),
+        [](const ndb_mgm_node_state* n1, const ndb_mgm_node_state* n2) {
+            return n1->node_id < n2->node_id;
+        });
+
+    uint64_t hash = FNV1A_64_OFFSET_BASIS;
+    for (const auto* node : nodes) {
+        hash = fnv1a_64_int(node->node_id, hash);
+        hash = fnv1a_64_int(node->node_group, hash);
+        /* the terminating nul separates the host from what follows */
+        hash = fnv1a_64(node->connect_address,
+            strnlen(node->connect_address, sizeof(node->connect_address)) + 1,
+            hash);
+        hash = fnv1a_64_int(node->version, hash);
+        hash = fnv1a_64_int(pending.count(node->node_id) ? 1 : 0, hash);
+    }
+    return fnv1a_64(schedule.c_str(), schedule.size() + 1, hash);
+}
+
+string fingerprint_hex(uint64_t fingerprint)
+{
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016" PRIx64, fingerprint);
+    return hex;
+}
+
+int read_plan_cache(const string& path, uint64_t fingerprint,
+    restart_waves_t& waves)
+{
+    ifstream in(path.c_str());
+    if (!in) {
+        return 1;
+    }
+
+    string line;
+    uint64_t cached = 0;
+    bool found = false;
+    restart_waves_t cached_waves;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        istringstream fields(line);
+        string kind;
+        fields >> kind;
+        if (kind == "fingerprint") {
+            string hex;
+            fields >> hex;
+            if (sscanf(hex.c_str(), "%" SCNx64, &cached) != 1) {
+                return 1;
+            }
+            found = true;
+        } else if (kind == "wave") {
+            cached_waves.emplace_back();
+            string node;
+            while (fields >> node) {
+                restart_node_status_s restart{ 0, 0, false };
+                if (sscanf(node.c_str(), "%d:%d", &restart.node_id,
+                        &restart.node_group)
+                    != 2) {
+                    return 1;
+                }
+                cached_waves.back().push_back(restart);
+            }
+            if (cached_waves.back().empty()) {
+                return 1;
+            }
+        } else {
+            return 1;
+        }
+    }
+    if (!found || cached != fingerprint) {
+        return 1;
+    }
+    waves.swap(cached_waves);
+    return 0;
+}
+
+int write_plan_cache(const string& path, uint64_t fingerprint,
+    const restart_waves_t& waves)
+{
+    string tmp_path = path + ".tmp";
+    {
+        ofstream out(tmp_path.c_str());
+        if (!out) {
+            return 1;
+        }
+        out << "# node_id:node_group of each wave\n";
+        out << "fingerprint " << fingerprint_hex(fingerprint) << "\n";
+        for (const auto& wave : waves) {
+            out << "wave";
+            for (const auto& node : wave) {
+                out << " " << node.node_id << ":" << node.node_group;
+            }
+            out << "\n";
+        }
+        if (!out) {
+            return 1;
+        }
+    }
+    return rename(tmp_path.c_str(), path.c_str()) ? 1 : 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * ndb_rolling_restart_plan_cache.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_PLAN_CACHE_HPP
+#define NDB_ROLLING_RESTART_PLAN_CACHE_HPP 1
+
+#include "ndb_rolling_restart.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+typedef std::vector<std::vector<restart_node_status_s>> restart_waves_t;
+
+#define FNV1A_64_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV1A_64_PRIME 0x100000001b3ULL
+
+/* 64 bit FNV-1a, start with hash = FNV1A_64_OFFSET_BASIS */
+uint64_t fnv1a_64(const void* data, size_t len, uint64_t hash);
+
+/* FNV-1a over the node id, node group, host and version of each node of
+   cluster_state, in node id order. The plan also depends on which nodes
+   are pending and on the schedule, so those are part of it as well. */
+uint64_t topology_fingerprint(const ndb_mgm_cluster_state* cluster_state,
+    const std::vector<restart_node_status_s>& node_restarts,
+    const std::string& schedule);
+
+/* 16 hex digits */
+std::string fingerprint_hex(uint64_t fingerprint);
+
+/* The cache file holds one plan, that of the last topology planned.
+   Returns 0 and fills waves if the file has a plan for fingerprint,
+   1 if not or if the file can not be read. */
+int read_plan_cache(const std::string& path, uint64_t fingerprint,
+    restart_waves_t& waves);
+
+/* returns 0 on success */
+int write_plan_cache(const std::string& path, uint64_t fingerprint,
+    const restart_waves_t& waves);
+
+#endif /* NDB_ROLLING_RESTART_PLAN_CACHE_HPP */
@@ -0,0 +1,168 @@
+/*
+ * ndb_rolling_restart_preflight
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_preflight.hpp"
+#include "ndb_rolling_restart_api.hpp"
+#include "ndb_rolling_restart_executor.hpp"
+#include "ndb_rolling_restart_trace.hpp"
+
+#include <cassert>
+#include <map>
+#include <mutex>
+#include <system_error>
+
+using namespace std;
+
+static string node_problem(int node_id, const string& problem)
+{
+    return "node " + to_string(node_id) + ": " + problem;
+}
+
+void preflight_check_nodes(ndb_connection_context_s& ndb_ctx,
+    const vector<preflight_node_s>& nodes, preflight_result_s& result)
+{
+    ndb_mgm_node_type node_types[2] = {
+        NDB_MGM_NODE_TYPE_NDB,
+        NDB_MGM_NODE_TYPE_UNKNOWN
+    };
+    ndb_mgm_cluster_state* cluster_state = get_ndb_api(ndb_ctx).get_status2(
+        ndb_ctx, node_types);
+    if (!cluster_state) {
+        result.problems.push_back("ndb_mgm_get_status2 returned null");
+        return;
+    }
+
+    vector<int> dump_node_ids;
+    map<int, ndb_mgm_node_state> node_states;
+    for (const auto& node : nodes) {
+        const ndb_mgm_node_state* node_state = nullptr;
+        for (int i = 0; i < cluster_state->no_of_nodes; ++i) {
+            if (cluster_state->node_states[i].node_id == node.node_id) {
+                node_state = &(cluster_state->node_states[i]);
+            }
+        }
+        if (!node_state) {
+            result.problems.push_back(node_problem(node.node_id,
+                "not in cluster state"));
+            continue;
+        }
+        if (node_state->node_status != NDB_MGM_NODE_STATUS_STARTED) {
+            result.problems.push_back(node_problem(node.node_id,
+                ndb_mgm_get_node_status_string(node_state->node_status)));
+            continue;
+        }
+        if (node_state->node_group != node.node_group) {
+            result.problems.push_back(node_problem(node.node_id,
+                "node group " + to_string(node_state->node_group)
+                    + ", planned " + to_string(node.node_group)));
+        }
+        if (node_state->version != node.version) {
+            result.problems.push_back(node_problem(node.node_id,
+                "version " + to_string(node_state->version) + ", planned "
+                    + to_string(node.version)));
+        }
+        dump_node_ids.push_back(node.node_id);
+        node_states[node.node_id] = *node_state;
+    }
+    free((void*)cluster_state);
+
+    mutex problems_lock;
+    map<int, string> dump_problems;
+    executor_for_each_node(ndb_ctx.executor, ndb_ctx, dump_node_ids,
+        [&](ndb_connection_context_s& node_ctx, int node_id,
+            int connect_err) {
+            string dump_state = connect_err
+                ? "could not connect"
+                : get_ndb_mgm_dump_state(node_ctx, node_states.at(node_id));
+            if (dump_state != "ok") {
+                lock_guard<mutex> guard(problems_lock);
+                dump_problems[node_id] = dump_state;
+            }
+        });
+    for (const auto& problem : dump_problems) {
+        result.problems.push_back(node_problem(problem.first,
+            "dump state " + problem.second));
+    }
+}
+
+static void preflight_run(ndb_preflight_s* preflight)
+{
+    ndb_connection_context_s& ndb_ctx = preflight->ndb_ctx;
+    trace_span_s span(ndb_ctx.trace, "preflight", "preflight",
+        TRACE_TRACK_PREFLIGHT);
+
+    if (get_ndb_api(ndb_ctx).connect(ndb_ctx)) {
+        preflight->result.problems.push_back("could not connect");
+    } else {
+        preflight_check_nodes(ndb_ctx, preflight->nodes, preflight->result);
+    }
+    get_ndb_api(ndb_ctx).disconnect(ndb_ctx);
+    preflight->result.checked = chrono::steady_clock::now();
+}
+
+int preflight_begin(ndb_preflight_s& preflight,
+    ndb_connection_context_s& ndb_ctx,
+    const vector<restart_node_status_s>& wave)
+{
+    assert(!preflight.running);
+    assert(ndb_ctx.cluster_state);
+
+    preflight.nodes.clear();
+    preflight.result = preflight_result_s();
+    for (const auto& node : wave) {
+        int version = 0;
+        for (int i = 0; i < ndb_ctx.cluster_state->no_of_nodes; ++i) {
+            auto node_state = ndb_ctx.cluster_state->node_states[i];
+            if (node_state.node_id == node.node_id) {
+                version = node_state.version;
+            }
+        }
+        preflight.nodes.push_back(
+            preflight_node_s{ node.node_id, node.node_group, version });
+        preflight.result.node_ids.push_back(node.node_id);
+    }
+
+    /* the copy gets its own connection, events and metrics stay with the
+       orchestrator, problems are reported through the result */
+    preflight.ndb_ctx = ndb_ctx;
+    preflight.ndb_ctx.connection = nullptr;
+    preflight.ndb_ctx.ndb_mgm_handle = nullptr;
+    preflight.ndb_ctx.cluster_state = nullptr;
+    preflight.ndb_ctx.metrics = nullptr;
+    preflight.ndb_ctx.on_event = nullptr;
+
+    try {
+        preflight.runner = thread(preflight_run, &preflight);
+    } catch (const system_error&) {
+        return 1;
+    }
+    preflight.running = true;
+    return 0;
+}
+
+ndb_preflight_s::~ndb_preflight_s()
+{
+    preflight_finish(*this);
+}
+
+const preflight_result_s* preflight_finish(ndb_preflight_s& preflight)
+{
+    if (!preflight.running) {
+        return nullptr;
+    }
+    preflight.runner.join();
+    preflight.running = false;
+    return &preflight.result;
+}
@@ -0,0 +1,67 @@
+/*
+ * ndb_rolling_restart_preflight.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_PREFLIGHT_HPP
+#define NDB_ROLLING_RESTART_PREFLIGHT_HPP 1
+
+#include "ndb_rolling_restart.hpp"
+#include <thread>
+
+/* an older result is not trusted, the wave is checked again */
+#define PREFLIGHT_MAX_AGE_SECONDS 60
+
+/* what a node looked like when the preflight was started */
+struct preflight_node_s {
+    int node_id;
+    int node_group;
+    int version;
+};
+
+struct preflight_result_s {
+    std::vector<int> node_ids;
+    /* empty if every node of the wave can be restarted right away */
+    std::vector<std::string> problems;
+    std::chrono::steady_clock::time_point checked;
+};
+
+/* Checks the next wave in the background while the current wave
+   recovers: node status, dump state, and that version and node group
+   still match the plan. The check uses a copy of the context with its
+   own connection, so the orchestrator's handle is never shared. */
+struct ndb_preflight_s {
+    ~ndb_preflight_s(); /* waits for a check still running */
+
+    ndb_connection_context_s ndb_ctx;
+    std::vector<preflight_node_s> nodes;
+    preflight_result_s result;
+    std::thread runner;
+    bool running = false;
+};
+
+/* checks the nodes on the connection of ndb_ctx, which must already be
+   connected, the problems found are appended to result */
+void preflight_check_nodes(ndb_connection_context_s& ndb_ctx,
+    const std::vector<preflight_node_s>& nodes, preflight_result_s& result);
+
+/* starts checking wave in the background, the expected versions are
+   taken from the cluster_state of ndb_ctx, returns 0 if started */
+int preflight_begin(ndb_preflight_s& preflight,
+    ndb_connection_context_s& ndb_ctx,
+    const std::vector<restart_node_status_s>& wave);
+
+/* waits for the background check, returns null if none was started */
+const preflight_result_s* preflight_finish(ndb_preflight_s& preflight);
+
+#endif /* NDB_ROLLING_RESTART_PREFLIGHT_HPP */
@@ -0,0 +1,541 @@
+/*
+ * ndb_rolling_restart_replay
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_replay.hpp"
+#include "ndb_rolling_restart_log.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <thread>
+
+using namespace std;
+
+#define API_CALL_LOG_MAGIC "NDBRRLOG"
+#define API_CALL_LOG_VERSION 1
+
+static void put_u8(string& buf, uint8_t val)
+{
+    buf += (char)val;
+}
+
+static void put_u16(string& buf, uint16_t val)
+{
+    put_u8(buf, val & 0xFF);
+    put_u8(buf, (val >> 8) & 0xFF);
+}
+
+static void put_u32(string& buf, uint32_t val)
+{
+    put_u16(buf, val & 0xFFFF);
+    put_u16(buf, (val >> 16) & 0xFFFF);
+}
+
+static void put_u64(string& buf, uint64_t val)
+{
+    put_u32(buf, val & 0xFFFFFFFF);
+    put_u32(buf, (val >> 32) & 0xFFFFFFFF);
+}
+
+static void put_str(string& buf, const string& str)
+{
+    uint16_t len = str.size() > 0xFFFF ? 0xFFFF : str.size();
+    put_u16(buf, len);
+    buf.append(str, 0, len);
+}
+
+static int get_u8(const string& buf, size_t& pos, uint8_t& val)
+{
+    if (pos + 1 > buf.size()) {
+        return 1;
+    }
+    val = (uint8_t)buf[pos++];
+    return 0;
+}
+
+static int get_u16(const string& buf, size_t& pos, uint16_t& val)
+{
+    uint8_t lo, hi;
+    if (get_u8(buf, pos, lo) || get_u8(buf, pos, hi)) {
+        return 1;
+    }
+    val = lo | (hi << 8);
+    return 0;
+}
+
+static int get_u32(const string& buf, size_t& pos, uint32_t& val)
+{
+    uint16_t lo, hi;
+    if (get_u16(buf, pos, lo) || get_u16(buf, pos, hi)) {
+        return 1;
+    }
+    val = lo | ((uint32_t)hi << 16);
+    return 0;
+}
+
+static int get_i32(const string& buf, size_t& pos, int32_t& val)
+{
+    uint32_t u;
+    if (get_u32(buf, pos, u)) {
+        return 1;
+    }
+    val = (int32_t)u;
+    return 0;
+}
+
+static int get_u64(const string& buf, size_t& pos, uint64_t& val)
+{
+    uint32_t lo, hi;
+    if (get_u32(buf, pos, lo) || get_u32(buf, pos, hi)) {
+        return 1;
+    }
+    val = lo | ((uint64_t)hi << 32);
+    return 0;
+}
+
+static int get_str(const string& buf, size_t& pos, string& str)
+{
+    uint16_t len;
+    if (get_u16(buf, pos, len) || pos + len > buf.size()) {
+        return 1;
+    }
+    str.assign(buf, pos, len);
+    pos += len;
+    return 0;
+}
+
+void encode_api_call(const api_call_record_s& record, string& buf)
+{
+    put_u8(buf, record.call);
+    put_u64(buf, record.begin_us);
+    put_u32(buf, record.duration_us);
+    put_u16(buf, record.args.size());
+    for (auto arg : record.args) {
+        put_u32(buf, arg);
+    }
+    put_u32(buf, record.result);
+    put_u32(buf, record.extra);
+    put_str(buf, record.text);
+    if (!record.has_cluster_state) {
+        put_u32(buf, (uint32_t)-1);
+        return;
+    }
+    put_u32(buf, record.node_states.size());
+    for (const auto& node : record.node_states) {
+        put_u32(buf, node.node_id);
+        put_u32(buf, node.node_type);
+        put_u32(buf, node.node_status);
+        put_u32(buf, node.start_phase);
+        put_u32(buf, node.dynamic_id);
+        put_u32(buf, node.node_group);
+        put_u32(buf, node.version);
+        put_u32(buf, node.connect_count);
+        put_u32(buf, node.mysql_version);
+        put_str(buf, string(node.connect_address,
+                         strnlen(node.connect_address,
+                             sizeof(node.connect_address))));
+    }
+}
+
+int decode_api_call(const string& buf, size_t& pos,
+    api_call_record_s& record)
+{
+    uint8_t call;
+    uint16_t arg_count;
+    int32_t node_count;
+    if (get_u8(buf, pos, call)
+        || get_u64(buf, pos, record.begin_us)
+        || get_u32(buf, pos, record.duration_us)
+        || get_u16(buf, pos, arg_count)) {
+        return 1;
+    }
+    record.call = (api_call_e)call;
+    record.args.resize(arg_count);
+    for (auto& arg : record.args) {
+        if (get_i32(buf, pos, arg)) {
+            return 1;
+        }
+    }
+    if (get_i32(buf, pos, record.result)
+        || get_i32(buf, pos, record.extra)
+        || get_str(buf, pos, record.text)
+        || get_i32(buf, pos, node_count)) {
+        return 1;
+    }
+    record.has_cluster_state = (node_count >= 0);
+    record.node_states.clear();
+    for (int32_t i = 0; i < node_count; ++i) {
+        ndb_mgm_node_state node;
+        memset(&node, 0, sizeof(node));
+        int32_t node_type, node_status;
+        string address;
+        if (get_i32(buf, pos, node.node_id)
+            || get_i32(buf, pos, node_type)
+            || get_i32(buf, pos, node_status)
+            || get_i32(buf, pos, node.start_phase)
+            || get_i32(buf, pos, node.dynamic_id)
+            || get_i32(buf, pos, node.node_group)
+            || get_i32(buf, pos, node.version)
+            || get_i32(buf, pos, node.connect_count)
+            || get_i32(buf, pos, node.mysql_version)
+            || get_str(buf, pos, address)) {
+            return 1;
+        }
+        node.node_type = (ndb_mgm_node_type)node_type;
+        node.node_status = (ndb_mgm_node_status)node_status;
+        strncpy(node.connect_address, address.c_str(),
+            sizeof(node.connect_address) - 1);
+        record.node_states.push_back(node);
+    }
+    return 0;
+}
+
+int read_api_call_log(const string& path, vector<api_call_record_s>& records)
+{
+    ifstream in(path.c_str(), ios::binary);
+    if (!in) {
+        return 1;
+    }
+    string buf((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    size_t pos = strlen(API_CALL_LOG_MAGIC);
+    if (buf.compare(0, pos, API_CALL_LOG_MAGIC) != 0) {
+        return 1;
+    }
+    uint8_t version;
+    if (get_u8(buf, pos, version) || version != API_CALL_LOG_VERSION) {
+        return 1;
+    }
+    while (pos < buf.size()) {
+        api_call_record_s record;
+        if (decode_api_call(buf, pos, record)) {
+            /* a truncated last record, e.g. the recording was killed */
+            break;
+        }
+        records.push_back(record);
+    }
+    return 0;
+}
+
+static vector<int32_t> node_type_args(const ndb_mgm_node_type node_types[])
+{
+    vector<int32_t> args;
+    for (size_t i = 0; node_types[i] != NDB_MGM_NODE_TYPE_UNKNOWN; ++i) {
+        args.push_back(node_types[i]);
+    }
+    return args;
+}
+
+static vector<int32_t> node_args(const int* nodes, int cnt)
+{
+    return vector<int32_t>(nodes, nodes + cnt);
+}
+
+ndb_record_api_s::ndb_record_api_s(ndb_api_s& target)
+    : target(target)
+    , epoch(chrono::steady_clock::now())
+{
+}
+
+int ndb_record_api_s::open(const string& path)
+{
+    log.open(path.c_str(), ios::binary | ios::trunc);
+    if (!log) {
+        return 1;
+    }
+    string header = API_CALL_LOG_MAGIC;
+    put_u8(header, API_CALL_LOG_VERSION);
+    log << header;
+    log.flush();
+    return log ? 0 : 1;
+}
+
+api_call_record_s ndb_record_api_s::begin_call(api_call_e call)
+{
+    api_call_record_s record;
+    record.call = call;
+    record.begin_us = chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - epoch)
+                          .count();
+    record.duration_us = 0;
+    record.result = 0;
+    record.extra = 0;
+    record.has_cluster_state = false;
+    return record;
+}
+
+void ndb_record_api_s::end_call(api_call_record_s& record)
+{
+    auto now_us = chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - epoch)
+                      .count();
+    record.duration_us = now_us - record.begin_us;
+
+    string buf;
+    encode_api_call(record, buf);
+
+    lock_guard<mutex> guard(lock);
+    log << buf;
+    /* flushed per call, so a killed run still leaves a usable log */
+    log.flush();
+    ++calls_recorded;
+}
+
+int ndb_record_api_s::connect(ndb_connection_context_s& ndb_ctx)
+{
+    auto record = begin_call(API_CALL_CONNECT);
+    record.result = target.connect(ndb_ctx);
+    end_call(record);
+    return record.result;
+}
+
+void ndb_record_api_s::disconnect(ndb_connection_context_s& ndb_ctx)
+{
+    target.disconnect(ndb_ctx);
+}
+
+string ndb_record_api_s::get_system_name(ndb_connection_context_s& ndb_ctx)
+{
+    auto record = begin_call(API_CALL_GET_SYSTEM_NAME);
+    record.text = target.get_system_name(ndb_ctx);
+    end_call(record);
+    return record.text;
+}
+
+ndb_mgm_cluster_state* ndb_record_api_s::get_status2(
+    ndb_connection_context_s& ndb_ctx, const ndb_mgm_node_type node_types[])
+{
+    auto record = begin_call(API_CALL_GET_STATUS2);
+    record.args = node_type_args(node_types);
+    ndb_mgm_cluster_state* cluster_state = target.get_status2(ndb_ctx,
+        node_types);
+    if (cluster_state) {
+        record.has_cluster_state = true;
+        record.node_states.assign(cluster_state->node_states,
+            cluster_state->node_states + cluster_state->no_of_nodes);
+    }
+    end_call(record);
+    return cluster_state;
+}
+
+int ndb_record_api_s::restart4(ndb_connection_context_s& ndb_ctx, int cnt,
+    const int* nodes, int initial, int nostart, int abort, int force,
+    int* disconnect)
+{
+    auto record = begin_call(API_CALL_RESTART4);
+    record.args = { initial, nostart, abort, force };
+    auto ids = node_args(nodes, cnt);
+    record.args.insert(record.args.end(), ids.begin(), ids.end());
+    record.result = target.restart4(ndb_ctx, cnt, nodes, initial, nostart,
+        abort, force, disconnect);
+    record.extra = *disconnect;
+    end_call(record);
+    return record.result;
+}
+
+int ndb_record_api_s::wait_until_ready(ndb_connection_context_s& ndb_ctx,
+    const int* nodes, int cnt, int timeout)
+{
+    auto record = begin_call(API_CALL_WAIT_UNTIL_READY);
+    record.args = node_args(nodes, cnt);
+    record.extra = timeout;
+    record.result = target.wait_until_ready(ndb_ctx, nodes, cnt, timeout);
+    end_call(record);
+    return record.result;
+}
+
+int ndb_record_api_s::dump_state(ndb_connection_context_s& ndb_ctx,
+    int node_id, const int* args, int num_args, ndb_mgm_reply* reply)
+{
+    auto record = begin_call(API_CALL_DUMP_STATE);
+    record.args = { node_id };
+    auto dump_args = node_args(args, num_args);
+    record.args.insert(record.args.end(), dump_args.begin(), dump_args.end());
+    record.result = target.dump_state(ndb_ctx, node_id, args, num_args,
+        reply);
+    record.extra = reply->return_code;
+    /* the message is only filled in on a failed reply */
+    if (record.result != -1 && reply->return_code != 0) {
+        record.text.assign(reply->message,
+            strnlen(reply->message, sizeof(reply->message)));
+    }
+    end_call(record);
+    return record.result;
+}
+
+void ndb_record_api_s::sleep(ndb_connection_context_s& ndb_ctx,
+    chrono::milliseconds duration)
+{
+    target.sleep(ndb_ctx, duration);
+}
+
+NdbLogEventHandle ndb_record_api_s::open_restart_events(
+    ndb_connection_context_s& ndb_ctx)
+{
+    return target.open_restart_events(ndb_ctx);
+}
+
+int ndb_record_api_s::next_restart_event(NdbLogEventHandle handle,
+    ndb_logevent* event, unsigned timeout_ms)
+{
+    return target.next_restart_event(handle, event, timeout_ms);
+}
+
+void ndb_record_api_s::close_restart_events(NdbLogEventHandle handle)
+{
+    target.close_restart_events(handle);
+}
+
+ndb_replay_api_s::ndb_replay_api_s(double speed)
+    : speed(speed)
+{
+}
+
+int ndb_replay_api_s::open(const string& path)
+{
+    records.clear();
+    if (read_api_call_log(path, records)) {
+        return 1;
+    }
+    used.assign(records.size(), false);
+    return 0;
+}
+
+const api_call_record_s* ndb_replay_api_s::next_call(
+    ndb_connection_context_s& ndb_ctx, api_call_e call,
+    const vector<int32_t>& args)
+{
+    const api_call_record_s* record = nullptr;
+    {
+        lock_guard<mutex> guard(lock);
+        for (size_t i = 0; i < records.size(); ++i) {
+            if (!used[i] && records[i].call == call
+                && records[i].args == args) {
+                used[i] = true;
+                ++calls_replayed;
+                record = &records[i];
+                break;
+            }
+        }
+        if (!record) {
+            ++divergences;
+        }
+    }
+    if (!record) {
+        Cerr(ndb_ctx) << "replay: no recorded call " << call
+                      << " left with matching arguments";
+        return nullptr;
+    }
+    if (speed > 0) {
+        this_thread::sleep_for(chrono::microseconds(
+            (long long)(record->duration_us / speed)));
+    }
+    return record;
+}
+
+bool ndb_replay_api_s::aborted()
+{
+    lock_guard<mutex> guard(lock);
+    return divergences > 0;
+}
+
+int ndb_replay_api_s::connect(ndb_connection_context_s& ndb_ctx)
+{
+    auto record = next_call(ndb_ctx, API_CALL_CONNECT, {});
+    return record ? record->result : 1;
+}
+
+void ndb_replay_api_s::disconnect(ndb_connection_context_s&)
+{
+}
+
+string ndb_replay_api_s::get_system_name(ndb_connection_context_s& ndb_ctx)
+{
+    auto record = next_call(ndb_ctx, API_CALL_GET_SYSTEM_NAME, {});
+    return record ? record->text : "";
+}
+
+ndb_mgm_cluster_state* ndb_replay_api_s::get_status2(
+    ndb_connection_context_s& ndb_ctx, const ndb_mgm_node_type node_types[])
+{
+    auto record = next_call(ndb_ctx, API_CALL_GET_STATUS2,
+        node_type_args(node_types));
+    if (!record || !record->has_cluster_state) {
+        return nullptr;
+    }
+
+    /* allocated the way the MGM API does, released with free() */
+    size_t nodes = record->node_states.size();
+    size_t size = sizeof(ndb_mgm_cluster_state)
+        + nodes * sizeof(ndb_mgm_node_state);
+    auto cluster_state = (ndb_mgm_cluster_state*)calloc(1, size);
+    if (!cluster_state) {
+        return nullptr;
+    }
+    cluster_state->no_of_nodes = nodes;
+    for (size_t i = 0; i < nodes; ++i) {
+        cluster_state->node_states[i] = record->node_states[i];
+    }
+    return cluster_state;
+}
+
+int ndb_replay_api_s::restart4(ndb_connection_context_s& ndb_ctx, int cnt,
+    const int* nodes, int initial, int nostart, int abort, int force,
+    int* disconnect)
+{
+    vector<int32_t> args = { initial, nostart, abort, force };
+    auto ids = node_args(nodes, cnt);
+    args.insert(args.end(), ids.begin(), ids.end());
+    auto record = next_call(ndb_ctx, API_CALL_RESTART4, args);
+    if (!record) {
+        return -1;
+    }
+    *disconnect = record->extra;
+    return record->result;
+}
+
+int ndb_replay_api_s::wait_until_ready(ndb_connection_context_s& ndb_ctx,
+    const int* nodes, int cnt, int timeout)
+{
+    /* the timeout is not matched, a replay may use other wait_seconds */
+    auto record = next_call(ndb_ctx, API_CALL_WAIT_UNTIL_READY,
+        node_args(nodes, cnt));
+    return record ? record->result : -1;
+}
+
+int ndb_replay_api_s::dump_state(ndb_connection_context_s& ndb_ctx,
+    int node_id, const int* args, int num_args, ndb_mgm_reply* reply)
+{
+    vector<int32_t> call_args = { node_id };
+    auto dump_args = node_args(args, num_args);
+    call_args.insert(call_args.end(), dump_args.begin(), dump_args.end());
+    auto record = next_call(ndb_ctx, API_CALL_DUMP_STATE, call_args);
+    if (!record) {
+        return -1;
+    }
+    reply->return_code = record->extra;
+    strncpy(reply->message, record->text.c_str(), sizeof(reply->message) - 1);
+    reply->message[sizeof(reply->message) - 1] = '\0';
+    return record->result;
+}
+
+void ndb_replay_api_s::sleep(ndb_connection_context_s&,
+    chrono::milliseconds duration)
+{
+    if (speed > 0) {
+        this_thread::sleep_for(chrono::microseconds(
+            (long long)(duration.count() * 1000 / speed)));
+    }
+}
@@ -0,0 +1,145 @@
+/*
+ * ndb_rolling_restart_replay.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_REPLAY_HPP
+#define NDB_ROLLING_RESTART_REPLAY_HPP 1
+
+#include "ndb_rolling_restart_api.hpp"
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum api_call_e {
+    API_CALL_CONNECT = 1,
+    API_CALL_GET_SYSTEM_NAME,
+    API_CALL_GET_STATUS2,
+    API_CALL_RESTART4,
+    API_CALL_WAIT_UNTIL_READY,
+    API_CALL_DUMP_STATE
+};
+
+/* One call in the log. The arguments of the call are in args, for
+   restart4: initial, nostart, abort, force, node ids...
+   for wait_until_ready: node ids...
+   for dump_state: node id, dump args...
+   for get_status2: node types...
+   extra is the disconnect flag of restart4, the timeout of
+   wait_until_ready or the reply return_code of dump_state,
+   text is the system name or the dump_state reply message */
+struct api_call_record_s {
+    api_call_e call;
+    uint64_t begin_us; /* since the start of the recording */
+    uint32_t duration_us;
+    std::vector<int32_t> args;
+    int32_t result;
+    int32_t extra;
+    std::string text;
+    bool has_cluster_state;
+    std::vector<ndb_mgm_node_state> node_states;
+};
+
+/* the log is "NDBRRLOG" followed by a version byte and the records,
+   all integers are little endian */
+void encode_api_call(const api_call_record_s& record, std::string& buf);
+
+/* returns 0 and advances pos on success */
+int decode_api_call(const std::string& buf, size_t& pos,
+    api_call_record_s& record);
+
+int read_api_call_log(const std::string& path,
+    std::vector<api_call_record_s>& records);
+
+/* forwards every call to target and appends it to the log */
+struct ndb_record_api_s : ndb_api_s {
+    ndb_record_api_s(ndb_api_s& target);
+
+    /* returns 0 if the log could be created */
+    int open(const std::string& path);
+
+    int connect(ndb_connection_context_s& ndb_ctx) override;
+    void disconnect(ndb_connection_context_s& ndb_ctx) override;
+    std::string get_system_name(ndb_connection_context_s& ndb_ctx) override;
+    ndb_mgm_cluster_state* get_status2(ndb_connection_context_s& ndb_ctx,
+        const ndb_mgm_node_type node_types[]) override;
+    int restart4(ndb_connection_context_s& ndb_ctx, int cnt,
+        const int* nodes, int initial, int nostart, int abort, int force,
+        int* disconnect) override;
+    int wait_until_ready(ndb_connection_context_s& ndb_ctx, const int* nodes,
+        int cnt, int timeout) override;
+    int dump_state(ndb_connection_context_s& ndb_ctx, int node_id,
+        const int* args, int num_args, ndb_mgm_reply* reply) override;
+    void sleep(ndb_connection_context_s& ndb_ctx,
+        std::chrono::milliseconds duration) override;
+    /* the log events are passed on, but not recorded */
+    NdbLogEventHandle open_restart_events(
+        ndb_connection_context_s& ndb_ctx) override;
+    int next_restart_event(NdbLogEventHandle handle, ndb_logevent* event,
+        unsigned timeout_ms) override;
+    void close_restart_events(NdbLogEventHandle handle) override;
+
+    ndb_api_s& target;
+    std::mutex lock;
+    std::ofstream log;
+    std::chrono::steady_clock::time_point epoch;
+    size_t calls_recorded = 0;
+
+private:
+    api_call_record_s begin_call(api_call_e call);
+    void end_call(api_call_record_s& record);
+};
+
+/* Answers calls from a log. A call is answered by the first unused
+   record of the same call with the same arguments, so that retries and
+   progress polls line up even if the timing differs. The recorded
+   duration of each call, and every sleep, is divided by speed, a speed
+   of 0 does not wait at all. A call without a matching record is
+   counted as a divergence and makes the backend abort. */
+struct ndb_replay_api_s : ndb_api_s {
+    ndb_replay_api_s(double speed);
+
+    /* returns 0 if the log could be read */
+    int open(const std::string& path);
+
+    int connect(ndb_connection_context_s& ndb_ctx) override;
+    void disconnect(ndb_connection_context_s& ndb_ctx) override;
+    std::string get_system_name(ndb_connection_context_s& ndb_ctx) override;
+    ndb_mgm_cluster_state* get_status2(ndb_connection_context_s& ndb_ctx,
+        const ndb_mgm_node_type node_types[]) override;
+    int restart4(ndb_connection_context_s& ndb_ctx, int cnt,
+        const int* nodes, int initial, int nostart, int abort, int force,
+        int* disconnect) override;
+    int wait_until_ready(ndb_connection_context_s& ndb_ctx, const int* nodes,
+        int cnt, int timeout) override;
+    int dump_state(ndb_connection_context_s& ndb_ctx, int node_id,
+        const int* args, int num_args, ndb_mgm_reply* reply) override;
+    void sleep(ndb_connection_context_s& ndb_ctx,
+        std::chrono::milliseconds duration) override;
+    bool aborted() override;
+
+    double speed;
+    std::mutex lock;
+    std::vector<api_call_record_s> records;
+    std::vector<bool> used;
+    size_t calls_replayed = 0;
+    size_t divergences = 0;
+
+private:
+    const api_call_record_s* next_call(ndb_connection_context_s& ndb_ctx,
+        api_call_e call, const std::vector<int32_t>& args);
+};
+
+#endif /* NDB_ROLLING_RESTART_REPLAY_HPP */
@@ -0,0 +1,306 @@
+/*
+ * ndb_rolling_restart_schedule
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_schedule.hpp"
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+using namespace std;
+
+typedef vector<vector<restart_node_status_s>> waves_t;
+
+static restart_node_status_s to_restart(const schedule_node_s& node)
+{
+    return restart_node_status_s{ node.node_id, node.node_group, false };
+}
+
+/* the pending nodes of each group, slowest first, then by node id */
+static map<int, vector<const schedule_node_s*>> pending_by_group(
+    const vector<schedule_node_s>& nodes, bool slowest_first)
+{
+    map<int, vector<const schedule_node_s*>> groups;
+    for (const auto& node : nodes) {
+        if (node.pending) {
+            groups[node.node_group].push_back(&node);
+        }
+    }
+    for (auto& group : groups) {
+        sort(group.second.begin(), group.second.end(),
+            [slowest_first](const schedule_node_s* n1,
+                const schedule_node_s* n2) {
+                if (slowest_first
+                    && n1->expected_seconds != n2->expected_seconds) {
+                    return n1->expected_seconds > n2->expected_seconds;
+                }
+                return n1->node_id > n2->node_id;
+            });
+    }
+    return groups;
+}
+
+/* the n-th chunk of per_wave nodes of each group goes into wave n */
+static waves_t chunked_waves(
+    const map<int, vector<const schedule_node_s*>>& groups,
+    const map<int, size_t>& per_wave)
+{
+    waves_t waves;
+    for (const auto& group : groups) {
+        size_t chunk = per_wave.at(group.first);
+        for (size_t i = 0; i < group.second.size(); ++i) {
+            size_t wave = i / chunk;
+            if (wave == waves.size()) {
+                waves.emplace_back();
+            }
+            waves[wave].push_back(to_restart(*group.second[i]));
+        }
+    }
+    return waves;
+}
+
+static map<int, size_t> one_per_group(
+    const map<int, vector<const schedule_node_s*>>& groups)
+{
+    map<int, size_t> per_wave;
+    for (const auto& group : groups) {
+        per_wave[group.first] = 1;
+    }
+    return per_wave;
+}
+
+struct round_robin_policy_s : ndb_schedule_policy_s {
+    const char* name() const override { return "round_robin"; }
+
+    waves_t plan(const vector<schedule_node_s>& nodes) const override
+    {
+        vector<restart_node_status_s> node_restarts;
+        for (const auto& node : nodes) {
+            if (node.pending) {
+                node_restarts.push_back(to_restart(node));
+            }
+        }
+        if (node_restarts.empty()) {
+            return waves_t();
+        }
+        sort_node_restarts(node_restarts);
+        return get_restart_waves(node_restarts);
+    }
+};
+
+struct longest_first_policy_s : ndb_schedule_policy_s {
+    const char* name() const override { return "longest_first"; }
+
+    waves_t plan(const vector<schedule_node_s>& nodes) const override
+    {
+        auto groups = pending_by_group(nodes, true);
+        return chunked_waves(groups, one_per_group(groups));
+    }
+};
+
+struct host_batched_policy_s : ndb_schedule_policy_s {
+    const char* name() const override { return "host_batched"; }
+
+    waves_t plan(const vector<schedule_node_s>& nodes) const override
+    {
+        vector<const schedule_node_s*> by_host;
+        for (const auto& node : nodes) {
+            if (node.pending) {
+                by_host.push_back(&node);
+            }
+        }
+        sort(by_host.begin(), by_host.end(),
+            [](const schedule_node_s* n1, const schedule_node_s* n2) {
+                if (n1->host != n2->host) {
+                    return n1->host < n2->host;
+                }
+                return n1->node_id > n2->node_id;
+            });
+
+        /* first fit, a host's nodes fill a wave as far as their node
+           groups allow */
+        waves_t waves;
+        vector<set<int>> wave_groups;
+        for (const auto* node : by_host) {
+            size_t wave = 0;
+            while (wave < waves.size()
+                && wave_groups[wave].count(node->node_group)) {
+                ++wave;
+            }
+            if (wave == waves.size()) {
+                waves.emplace_back();
+                wave_groups.emplace_back();
+            }
+            waves[wave].push_back(to_restart(*node));
+            wave_groups[wave].insert(node->node_group);
+        }
+        return waves;
+    }
+};
+
+struct max_parallel_policy_s : ndb_schedule_policy_s {
+    const char* name() const override { return "max_parallel"; }
+
+    waves_t plan(const vector<schedule_node_s>& nodes) const override
+    {
+        map<int, size_t> live;
+        for (const auto& node : nodes) {
+            if (node.started) {
+                ++live[node.node_group];
+            }
+        }
+        auto groups = pending_by_group(nodes, false);
+        map<int, size_t> per_wave;
+        for (const auto& group : groups) {
+            size_t replicas = live[group.first];
+            per_wave[group.first] = replicas > 1 ? replicas - 1 : 1;
+        }
+        return chunked_waves(groups, per_wave);
+    }
+};
+
+struct load_adaptive_policy_s : ndb_schedule_policy_s {
+    const char* name() const override { return "load_adaptive"; }
+
+    waves_t plan(const vector<schedule_node_s>& nodes) const override
+    {
+        auto groups = pending_by_group(nodes, true);
+        size_t remaining = 0;
+        for (const auto& group : groups) {
+            remaining += group.second.size();
+        }
+
+        /* the first group of a wave always finds a free host, so every
+           wave makes progress */
+        waves_t waves;
+        while (remaining) {
+            waves.emplace_back();
+            set<string> busy_hosts;
+            for (auto& group : groups) {
+                auto& pending = group.second;
+                for (auto it = pending.begin(); it != pending.end(); ++it) {
+                    if (!busy_hosts.count((*it)->host)) {
+                        busy_hosts.insert((*it)->host);
+                        waves.back().push_back(to_restart(**it));
+                        pending.erase(it);
+                        --remaining;
+                        break;
+                    }
+                }
+            }
+        }
+        return waves;
+    }
+};
+
+const vector<const ndb_schedule_policy_s*>& schedule_policies()
+{
+    static const round_robin_policy_s round_robin;
+    static const longest_first_policy_s longest_first;
+    static const host_batched_policy_s host_batched;
+    static const max_parallel_policy_s max_parallel;
+    static const load_adaptive_policy_s load_adaptive;
+    static const vector<const ndb_schedule_policy_s*> policies{
+        &round_robin, &longest_first, &host_batched, &max_parallel,
+        &load_adaptive
+    };
+    return policies;
+}
+
+const ndb_schedule_policy_s* find_schedule_policy(const string& name)
+{
+    for (const auto* policy : schedule_policies()) {
+        if (name == policy->name()) {
+            return policy;
+        }
+    }
+    return nullptr;
+}
+
+vector<schedule_node_s> get_schedule_nodes(
+    const ndb_mgm_cluster_state* cluster_state,
+    const vector<restart_node_status_s>& node_restarts)
+{
+    set<int> pending;
+    for (const auto& node : node_restarts) {
+        if (!node.was_restarted) {
+            pending.insert(node.node_id);
+        }
+    }
+
+    vector<schedule_node_s> nodes;
+    for (int i = 0; i < cluster_state->no_of_nodes; ++i) {
+        const ndb_mgm_node_state& node_state = cluster_state->node_states[i];
+        nodes.push_back(schedule_node_s{ node_state.node_id,
+            node_state.node_group, node_state.connect_address,
+            node_state.node_status == NDB_MGM_NODE_STATUS_STARTED,
+            pending.count(node_state.node_id) != 0, 0.0 });
+    }
+    return nodes;
+}
+
+schedule_estimate_s simulate_schedule(const vector<schedule_node_s>& nodes,
+    const waves_t& waves, bool parallel, double host_contention,
+    double default_seconds)
+{
+    map<int, const schedule_node_s*> by_id;
+    map<int, int> live;
+    for (const auto& node : nodes) {
+        by_id[node.node_id] = &node;
+        if (node.started) {
+            ++live[node.node_group];
+        }
+    }
+
+    schedule_estimate_s estimate{ 0.0, waves.size(), 0, {} };
+    estimate.min_live_replicas = live.empty() ? 0 : nodes.size();
+    for (const auto& group : live) {
+        estimate.min_live_replicas
+            = min(estimate.min_live_replicas, group.second);
+    }
+
+    for (const auto& wave : waves) {
+        map<string, int> host_nodes;
+        map<int, int> down;
+        for (const auto& restart : wave) {
+            const schedule_node_s* node = by_id[restart.node_id];
+            ++host_nodes[node->host];
+            if (node->started) {
+                ++down[node->node_group];
+            }
+        }
+        for (const auto& group : down) {
+            estimate.min_live_replicas = min(estimate.min_live_replicas,
+                live[group.first] - group.second);
+        }
+
+        double wave_seconds = 0.0;
+        for (const auto& restart : wave) {
+            const schedule_node_s* node = by_id[restart.node_id];
+            double seconds = node->expected_seconds > 0
+                ? node->expected_seconds
+                : default_seconds;
+            if (parallel) {
+                seconds *= 1.0 + host_contention * (host_nodes[node->host] - 1);
+                wave_seconds = max(wave_seconds, seconds);
+            } else {
+                wave_seconds += seconds;
+            }
+        }
+        estimate.makespan_seconds += wave_seconds;
+        estimate.wave_seconds.push_back(wave_seconds);
+    }
+    return estimate;
+}
@@ -0,0 +1,82 @@
+/*
+ * ndb_rolling_restart_schedule.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_SCHEDULE_HPP
+#define NDB_ROLLING_RESTART_SCHEDULE_HPP 1
+
+#include "ndb_rolling_restart.hpp"
+#include <string>
+#include <vector>
+
+/* what a policy knows of a data node, all nodes of the cluster are
+   given so that a policy can see how many replicas a node group has */
+struct schedule_node_s {
+    int node_id;
+    int node_group;
+    std::string host;
+    bool started; /* counts as a live replica */
+    bool pending; /* to be restarted */
+    double expected_seconds; /* the expected restart time, 0 if unknown */
+};
+
+/* Decides the order of the restarts. The nodes of a wave are restarted
+   together with --parallel, otherwise one after the other. */
+struct ndb_schedule_policy_s {
+    virtual ~ndb_schedule_policy_s() {}
+
+    virtual const char* name() const = 0;
+
+    /* every pending node is in exactly one wave */
+    virtual std::vector<std::vector<restart_node_status_s>> plan(
+        const std::vector<schedule_node_s>& nodes) const = 0;
+};
+
+/* the built in policies:
+   round_robin    one node per node group per wave, by descending node id
+   longest_first  as round_robin, the slowest nodes of each group first,
+                  so that the slow restarts share the waves
+   host_batched   the nodes of a host restart in as few waves as possible,
+                  for host maintenance
+   max_parallel   all but one replica of a node group per wave
+   load_adaptive  as longest_first, but at most one node per host per
+                  wave, the recoveries do not compete for a host's disk */
+const std::vector<const ndb_schedule_policy_s*>& schedule_policies();
+
+/* null if there is no policy of that name */
+const ndb_schedule_policy_s* find_schedule_policy(const std::string& name);
+
+/* the nodes of cluster_state, those of node_restarts which were not
+   restarted yet are pending */
+std::vector<schedule_node_s> get_schedule_nodes(
+    const ndb_mgm_cluster_state* cluster_state,
+    const std::vector<restart_node_status_s>& node_restarts);
+
+struct schedule_estimate_s {
+    double makespan_seconds;
+    size_t waves;
+    /* the fewest live replicas of any node group during the restart */
+    int min_live_replicas;
+    std::vector<double> wave_seconds; /* how long each wave takes */
+};
+
+/* A model of running the waves: in parallel a wave takes as long as its
+   slowest node, each other node of the same host in the wave slows a
+   node down by host_contention, serially the restarts add up. Nodes
+   without an expected time take default_seconds. */
+schedule_estimate_s simulate_schedule(const std::vector<schedule_node_s>& nodes,
+    const std::vector<std::vector<restart_node_status_s>>& waves,
+    bool parallel, double host_contention, double default_seconds);
+
+#endif /* NDB_ROLLING_RESTART_SCHEDULE_HPP */
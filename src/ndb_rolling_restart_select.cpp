@@ -0,0 +1,194 @@
+/*
+ * ndb_rolling_restart_select
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_select.hpp"
+
+#include <cstdlib>
+#include <fnmatch.h>
+#include <strings.h>
+
+using namespace std;
+
+struct status_name_s {
+    const char* name;
+    ndb_mgm_node_status status;
+};
+
+static const status_name_s status_names[] = {
+    { "unknown", NDB_MGM_NODE_STATUS_UNKNOWN },
+    { "no_contact", NDB_MGM_NODE_STATUS_NO_CONTACT },
+    { "not_started", NDB_MGM_NODE_STATUS_NOT_STARTED },
+    { "starting", NDB_MGM_NODE_STATUS_STARTING },
+    { "started", NDB_MGM_NODE_STATUS_STARTED },
+    { "shutting_down", NDB_MGM_NODE_STATUS_SHUTTING_DOWN },
+    { "restarting", NDB_MGM_NODE_STATUS_RESTARTING },
+    { "singleuser", NDB_MGM_NODE_STATUS_SINGLEUSER },
+    { "resume", NDB_MGM_NODE_STATUS_RESUME },
+    { "connected", NDB_MGM_NODE_STATUS_CONNECTED }
+};
+
+static vector<string> split(const string& str, const char* separators)
+{
+    vector<string> parts;
+    size_t begin = 0;
+    while (begin <= str.size()) {
+        size_t end = str.find_first_of(separators, begin);
+        if (end == string::npos) {
+            end = str.size();
+        }
+        if (end > begin) {
+            parts.push_back(str.substr(begin, end - begin));
+        }
+        begin = end + 1;
+    }
+    return parts;
+}
+
+/* returns 0 if all of str is a number within min and max */
+static int parse_int(const string& str, int min, int max, int* value)
+{
+    char* end;
+    long parsed = strtol(str.c_str(), &end, 10);
+    if (str.empty() || *end != '\0' || parsed < min || parsed > max) {
+        return 1;
+    }
+    *value = (int)parsed;
+    return 0;
+}
+
+static int parse_node_ids(const string& value, node_selection_s& selection)
+{
+    size_t dash = value.find('-');
+    int first;
+    int last;
+    if (dash == string::npos) {
+        if (parse_int(value, 1, SELECT_MAX_NODE_ID, &first)) {
+            return 1;
+        }
+        last = first;
+    } else if (parse_int(value.substr(0, dash), 1, SELECT_MAX_NODE_ID, &first)
+        || parse_int(value.substr(dash + 1), 1, SELECT_MAX_NODE_ID, &last)
+        || last < first) {
+        return 1;
+    }
+    for (int node_id = first; node_id <= last; ++node_id) {
+        selection.node_ids.set(node_id);
+    }
+    selection.by_node_id = true;
+    return 0;
+}
+
+static int parse_status(const string& value, node_selection_s& selection)
+{
+    for (const auto& status_name : status_names) {
+        if (strcasecmp(value.c_str(), status_name.name) == 0) {
+            selection.status_mask |= 1U << status_name.status;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int parse_node_selection(const string& spec, node_selection_s& selection,
+    string& error)
+{
+    for (const auto& term : split(spec, " \t;")) {
+        size_t colon = term.find(':');
+        if (colon == string::npos) {
+            error = "expected kind:values, got '" + term + "'";
+            return 1;
+        }
+        string kind = term.substr(0, colon);
+        vector<string> values = split(term.substr(colon + 1), ",");
+        if (values.empty()) {
+            error = "no values for '" + kind + "'";
+            return 1;
+        }
+        for (const auto& value : values) {
+            int err = 0;
+            if (kind == "id") {
+                err = parse_node_ids(value, selection);
+            } else if (kind == "group") {
+                int node_group;
+                err = parse_int(value, 0, 65536, &node_group);
+                if (!err) {
+                    selection.node_groups.insert(node_group);
+                }
+            } else if (kind == "host") {
+                selection.host_patterns.push_back(value);
+            } else if (kind == "status") {
+                err = parse_status(value, selection);
+            } else if (kind == "skip") {
+                err = parse_int(value, 1, SELECT_MAX_NODE_ID,
+                    &selection.skip_node_id);
+            } else {
+                error = "unknown kind '" + kind + "'";
+                return 1;
+            }
+            if (err) {
+                error = "bad " + kind + " '" + value + "'";
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+bool node_selected(const node_selection_s& selection,
+    const ndb_mgm_node_state& node_state)
+{
+    int node_id = node_state.node_id;
+    if (node_id <= selection.skip_node_id) {
+        return false;
+    }
+    if (selection.by_node_id
+        && (node_id < 0 || node_id > SELECT_MAX_NODE_ID
+               || !selection.node_ids.test(node_id))) {
+        return false;
+    }
+    if (!selection.node_groups.empty()
+        && !selection.node_groups.count(node_state.node_group)) {
+        return false;
+    }
+    if (selection.status_mask
+        && !(selection.status_mask & (1U << node_state.node_status))) {
+        return false;
+    }
+    if (!selection.host_patterns.empty()) {
+        bool matched = false;
+        for (const auto& pattern : selection.host_patterns) {
+            if (fnmatch(pattern.c_str(), node_state.connect_address, 0) == 0) {
+                matched = true;
+                break;
+            }
+        }
+        if (!matched) {
+            return false;
+        }
+    }
+    return true;
+}
+
+set<int> select_nodes(const node_selection_s& selection,
+    const ndb_mgm_cluster_state* cluster_state)
+{
+    set<int> node_ids;
+    for (int i = 0; i < cluster_state->no_of_nodes; ++i) {
+        if (node_selected(selection, cluster_state->node_states[i])) {
+            node_ids.insert(cluster_state->node_states[i].node_id);
+        }
+    }
+    return node_ids;
+}
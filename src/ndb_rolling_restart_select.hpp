@@ -0,0 +1,64 @@
+/*
+ * ndb_rolling_restart_select.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_SELECT_HPP
+#define NDB_ROLLING_RESTART_SELECT_HPP 1
+
+#include <mgmapi/mgmapi.h>
+#include <bitset>
+#include <set>
+#include <string>
+#include <vector>
+
+/* node ids are below 256 in every NDB version */
+#define SELECT_MAX_NODE_ID 255
+
+/* Which nodes to restart. A node is selected if it matches every kind
+   of criterion which is given, and within one kind any of the values,
+   an empty selection selects every node. */
+struct node_selection_s {
+    std::bitset<SELECT_MAX_NODE_ID + 1> node_ids;
+    bool by_node_id = false;
+    std::set<int> node_groups;
+    std::vector<std::string> host_patterns; /* fnmatch, connect_address */
+    unsigned status_mask = 0; /* 1 << ndb_mgm_node_status */
+    int skip_node_id = 0; /* skip the nodes up to this id */
+};
+
+/* shown when --select is not understood */
+#define NODE_SELECTION_USAGE \
+    "--select 'kind:values ...', a node must match every kind given:\n" \
+    "  id:2,4,10-12     these node ids\n" \
+    "  group:0,1        these node groups\n" \
+    "  host:10.0.1.*    a connect address matching the pattern\n" \
+    "  status:started   in this status\n" \
+    "  skip:7           skip the nodes up to id 7, e.g. those restarted\n" \
+    "                   by an earlier run\n"
+
+/* Parses terms separated by spaces or semicolons, values are separated
+   by commas, e.g.: "id:2,4,10-12 group:1 host:10.0.1.* status:started"
+   or "skip:7" to skip the nodes up to id 7, 7 included. Returns 0 on
+   success, otherwise error describes the first problem. */
+int parse_node_selection(const std::string& spec, node_selection_s& selection,
+    std::string& error);
+
+bool node_selected(const node_selection_s& selection,
+    const ndb_mgm_node_state& node_state);
+
+/* the node ids of cluster_state which are selected */
+std::set<int> select_nodes(const node_selection_s& selection,
+    const ndb_mgm_cluster_state* cluster_state);
+
+#endif /* NDB_ROLLING_RESTART_SELECT_HPP */
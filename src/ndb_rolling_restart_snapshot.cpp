@@ -0,0 +1,140 @@
+/*
+ * ndb_rolling_restart_snapshot
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_snapshot.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+using namespace std;
+
+void get_node_snapshots(const ndb_mgm_cluster_state* cluster_state,
+    vector<node_snapshot_s>& nodes)
+{
+    nodes.clear();
+    if (!cluster_state) {
+        return;
+    }
+    for (int i = 0; i < cluster_state->no_of_nodes; ++i) {
+        const ndb_mgm_node_state& node_state = cluster_state->node_states[i];
+        nodes.push_back(node_snapshot_s{ node_state.node_id,
+            node_state.node_group, node_state.node_status,
+            node_state.start_phase, node_state.connect_count,
+            node_state.version });
+    }
+    sort(nodes.begin(), nodes.end(),
+        [](const node_snapshot_s& n1, const node_snapshot_s& n2) {
+            return n1.node_id < n2.node_id;
+        });
+}
+
+static unsigned node_snapshot_changes(const node_snapshot_s& before,
+    const node_snapshot_s& after)
+{
+    unsigned changes = 0;
+    if (before.node_status != after.node_status) {
+        changes |= NODE_CHANGE_STATUS;
+    }
+    if (before.start_phase != after.start_phase) {
+        changes |= NODE_CHANGE_START_PHASE;
+    }
+    if (before.connect_count != after.connect_count) {
+        changes |= NODE_CHANGE_CONNECT_COUNT;
+    }
+    if (before.version != after.version) {
+        changes |= NODE_CHANGE_VERSION;
+    }
+    return changes;
+}
+
+void diff_node_snapshots(const vector<node_snapshot_s>& before,
+    const vector<node_snapshot_s>& after, vector<node_change_s>& changes)
+{
+    node_snapshot_s none;
+    memset(&none, 0, sizeof(none));
+
+    changes.clear();
+    size_t b = 0;
+    size_t a = 0;
+    while (b < before.size() || a < after.size()) {
+        if (a == after.size()
+            || (b < before.size() && before[b].node_id < after[a].node_id)) {
+            changes.push_back(
+                node_change_s{ NODE_CHANGE_REMOVED, before[b], none });
+            ++b;
+        } else if (b == before.size() || after[a].node_id < before[b].node_id) {
+            changes.push_back(
+                node_change_s{ NODE_CHANGE_ADDED, none, after[a] });
+            ++a;
+        } else {
+            unsigned bits = node_snapshot_changes(before[b], after[a]);
+            if (bits) {
+                changes.push_back(node_change_s{ bits, before[b], after[a] });
+            }
+            ++b;
+            ++a;
+        }
+    }
+}
+
+size_t update_cluster_snapshot(cluster_snapshot_s& snapshot,
+    const ndb_mgm_cluster_state* cluster_state)
+{
+    get_node_snapshots(cluster_state, snapshot.scratch);
+    diff_node_snapshots(snapshot.nodes, snapshot.scratch, snapshot.changes);
+    snapshot.nodes.swap(snapshot.scratch);
+    ++snapshot.samples;
+    return snapshot.changes.size();
+}
+
+string describe_node_change(const node_change_s& change)
+{
+    ostringstream out;
+    if (change.changes & NODE_CHANGE_ADDED) {
+        out << "node " << change.after.node_id << ": appeared, "
+            << ndb_mgm_get_node_status_string(change.after.node_status);
+        return out.str();
+    }
+    if (change.changes & NODE_CHANGE_REMOVED) {
+        out << "node " << change.before.node_id << ": disappeared";
+        return out.str();
+    }
+
+    out << "node " << change.after.node_id << ":";
+    const char* sep = " ";
+    if (change.changes & NODE_CHANGE_STATUS) {
+        out << sep << "status "
+            << ndb_mgm_get_node_status_string(change.before.node_status)
+            << " -> "
+            << ndb_mgm_get_node_status_string(change.after.node_status);
+        sep = ", ";
+    }
+    if (change.changes & NODE_CHANGE_START_PHASE) {
+        out << sep << "start_phase " << change.before.start_phase << " -> "
+            << change.after.start_phase;
+        sep = ", ";
+    }
+    if (change.changes & NODE_CHANGE_CONNECT_COUNT) {
+        out << sep << "connect_count " << change.before.connect_count
+            << " -> " << change.after.connect_count;
+        sep = ", ";
+    }
+    if (change.changes & NODE_CHANGE_VERSION) {
+        out << sep << "version " << change.before.version << " -> "
+            << change.after.version;
+    }
+    return out.str();
+}
@@ -0,0 +1,77 @@
+/*
+ * ndb_rolling_restart_snapshot.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_SNAPSHOT_HPP
+#define NDB_ROLLING_RESTART_SNAPSHOT_HPP 1
+
+#include <mgmapi/mgmapi.h>
+#include <string>
+#include <vector>
+
+/* the part of ndb_mgm_node_state which is compared between samples */
+struct node_snapshot_s {
+    int node_id;
+    int node_group;
+    ndb_mgm_node_status node_status;
+    int start_phase;
+    int connect_count;
+    int version;
+};
+
+enum node_change_e {
+    NODE_CHANGE_STATUS = 1 << 0,
+    NODE_CHANGE_START_PHASE = 1 << 1,
+    NODE_CHANGE_CONNECT_COUNT = 1 << 2,
+    NODE_CHANGE_VERSION = 1 << 3,
+    NODE_CHANGE_ADDED = 1 << 4,
+    NODE_CHANGE_REMOVED = 1 << 5
+};
+
+struct node_change_s {
+    unsigned changes; /* node_change_e bits */
+    node_snapshot_s before; /* zero if added */
+    node_snapshot_s after; /* zero if removed */
+};
+
+/* Node states of the latest sample, sorted by node id. The vectors are
+   reused between samples, so once they have grown to the size of the
+   cluster taking a sample does not allocate. */
+struct cluster_snapshot_s {
+    std::vector<node_snapshot_s> nodes;
+    /* the nodes as of the last report, see report_cluster_state */
+    std::vector<node_snapshot_s> reported;
+    /* the changes between the last two samples */
+    std::vector<node_change_s> changes;
+    std::vector<node_snapshot_s> scratch;
+    unsigned long samples = 0;
+};
+
+/* fills nodes, sorted by node id, from cluster_state */
+void get_node_snapshots(const ndb_mgm_cluster_state* cluster_state,
+    std::vector<node_snapshot_s>& nodes);
+
+/* compares two sorted snapshots, changes is cleared first */
+void diff_node_snapshots(const std::vector<node_snapshot_s>& before,
+    const std::vector<node_snapshot_s>& after,
+    std::vector<node_change_s>& changes);
+
+/* takes a sample, returns the number of changed nodes */
+size_t update_cluster_snapshot(cluster_snapshot_s& snapshot,
+    const ndb_mgm_cluster_state* cluster_state);
+
+/* e.g.: "node 3: status STARTED -> STARTING, start_phase 0 -> 1" */
+std::string describe_node_change(const node_change_s& change);
+
+#endif /* NDB_ROLLING_RESTART_SNAPSHOT_HPP */
@@ -0,0 +1,259 @@
+/*
+ * ndb_rolling_restart_stats
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_stats.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+void stats_nodes_begin(ndb_stats_s* stats, unsigned nodes, stats_time_t now)
+{
+    if (!stats) {
+        return;
+    }
+    if (!stats->begun) {
+        stats->first_begin = now;
+        stats->begun = true;
+    } else if (!stats->in_flight) {
+        stats->idle += chrono::duration_cast<chrono::milliseconds>(
+            now - stats->idle_begin);
+    }
+    stats->in_flight += nodes;
+}
+
+void stats_phase_done(ndb_stats_s* stats, const string& phase,
+    chrono::milliseconds duration)
+{
+    if (!stats) {
+        return;
+    }
+    stats->phases[phase].push_back(duration.count());
+}
+
+void stats_node_done(ndb_stats_s* stats, int node_id, int node_group,
+    uint64_t restart_ms, stats_time_t now)
+{
+    if (!stats) {
+        return;
+    }
+    stats->nodes.push_back(stats_node_s{ node_id, node_group, restart_ms });
+    stats->last_done = now;
+    if (stats->in_flight && --stats->in_flight == 0) {
+        stats->idle_begin = now;
+    }
+}
+
+uint64_t stats_percentile(vector<uint64_t> values, unsigned percent)
+{
+    if (values.empty()) {
+        return 0;
+    }
+    sort(values.begin(), values.end());
+    size_t rank = (percent * values.size() + 99) / 100;
+    return values[rank ? rank - 1 : 0];
+}
+
+static stats_distribution_s distribution(const vector<uint64_t>& values)
+{
+    uint64_t max_ms = values.empty()
+        ? 0
+        : *max_element(values.begin(), values.end());
+    return stats_distribution_s{ values.size(), stats_percentile(values, 50),
+        stats_percentile(values, 95), max_ms };
+}
+
+stats_summary_s summarize_stats(const ndb_stats_s& stats)
+{
+    stats_summary_s summary;
+
+    vector<uint64_t> restart_ms;
+    map<int, uint64_t> group_ms;
+    uint64_t busy_ms = 0;
+    for (const auto& node : stats.nodes) {
+        restart_ms.push_back(node.restart_ms);
+        group_ms[node.node_group] += node.restart_ms;
+        busy_ms += node.restart_ms;
+        summary.node_ms[node.node_id] = node.restart_ms;
+    }
+    summary.node = distribution(restart_ms);
+
+    for (const auto& phase : stats.phases) {
+        summary.phases[phase.first] = distribution(phase.second);
+    }
+
+    summary.slowest_groups.assign(group_ms.begin(), group_ms.end());
+    stable_sort(summary.slowest_groups.begin(), summary.slowest_groups.end(),
+        [](const pair<int, uint64_t>& g1, const pair<int, uint64_t>& g2) {
+            return g1.second > g2.second;
+        });
+
+    summary.wall_ms = 0;
+    if (stats.begun && stats.nodes.size()) {
+        summary.wall_ms = chrono::duration_cast<chrono::milliseconds>(
+            stats.last_done - stats.first_begin)
+                              .count();
+    }
+    summary.idle_ms = stats.idle.count();
+    summary.parallelism = summary.wall_ms
+        ? (double)busy_ms / summary.wall_ms
+        : 0.0;
+    return summary;
+}
+
+static string distribution_line(const string& name,
+    const stats_distribution_s& dist)
+{
+    char buf[160];
+    snprintf(buf, sizeof(buf),
+        "%s: n=%lu p50=%.1fs p95=%.1fs max=%.1fs", name.c_str(),
+        (unsigned long)dist.count, dist.p50_ms / 1000.0,
+        dist.p95_ms / 1000.0, dist.max_ms / 1000.0);
+    return buf;
+}
+
+vector<string> format_stats_summary(const stats_summary_s& summary,
+    size_t max_groups)
+{
+    vector<string> lines;
+    lines.push_back(distribution_line("node restart", summary.node));
+    for (const auto& phase : summary.phases) {
+        lines.push_back(distribution_line(phase.first, phase.second));
+    }
+
+    string groups = "slowest node groups:";
+    for (size_t i = 0; i < summary.slowest_groups.size() && i < max_groups;
+         ++i) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), " %d (%.1fs)",
+            summary.slowest_groups[i].first,
+            summary.slowest_groups[i].second / 1000.0);
+        groups += buf;
+    }
+    lines.push_back(groups);
+
+    char buf[160];
+    snprintf(buf, sizeof(buf), "wall %.1fs, idle %.1fs, parallelism %.2f",
+        summary.wall_ms / 1000.0, summary.idle_ms / 1000.0,
+        summary.parallelism);
+    lines.push_back(buf);
+    return lines;
+}
+
+map<string, uint64_t> stats_baseline_values(const stats_summary_s& summary)
+{
+    map<string, uint64_t> values;
+    if (!summary.node.count) {
+        return values;
+    }
+    values["node_p50_ms"] = summary.node.p50_ms;
+    values["node_p95_ms"] = summary.node.p95_ms;
+    values["node_max_ms"] = summary.node.max_ms;
+    values["wall_ms"] = summary.wall_ms;
+    for (const auto& phase : summary.phases) {
+        string name = phase.first;
+        replace(name.begin(), name.end(), ' ', '_');
+        values["phase_" + name + "_p95_ms"] = phase.second.p95_ms;
+    }
+    for (const auto& node : summary.node_ms) {
+        values["restart_node_" + to_string(node.first) + "_ms"] = node.second;
+    }
+    return values;
+}
+
+uint64_t stats_baseline_node_ms(const map<string, uint64_t>& baseline,
+    int node_id)
+{
+    auto found = baseline.find("restart_node_" + to_string(node_id) + "_ms");
+    if (found == baseline.end()) {
+        found = baseline.find("node_p50_ms");
+    }
+    return found == baseline.end() ? 0 : found->second;
+}
+
+int read_stats_baselines(const string& path,
+    map<string, map<string, uint64_t>>& baselines)
+{
+    ifstream in(path.c_str());
+    if (!in) {
+        return 0;
+    }
+
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        istringstream fields(line);
+        string cluster;
+        string name;
+        unsigned long long value;
+        if (!(fields >> cluster >> name >> value)) {
+            return 1;
+        }
+        baselines[cluster][name] = value;
+    }
+    return in.bad() ? 1 : 0;
+}
+
+int write_stats_baselines(const string& path,
+    const map<string, map<string, uint64_t>>& baselines)
+{
+    string tmp_path = path + ".tmp";
+    {
+        ofstream out(tmp_path.c_str());
+        if (!out) {
+            return 1;
+        }
+        out << "# cluster name value\n";
+        for (const auto& cluster : baselines) {
+            for (const auto& value : cluster.second) {
+                out << cluster.first << " " << value.first << " "
+                    << (unsigned long long)value.second << "\n";
+            }
+        }
+        if (!out) {
+            return 1;
+        }
+    }
+    return rename(tmp_path.c_str(), path.c_str()) ? 1 : 0;
+}
+
+vector<string> compare_stats_baseline(const map<string, uint64_t>& baseline,
+    const map<string, uint64_t>& current, double threshold, uint64_t min_ms)
+{
+    vector<string> warnings;
+    for (const auto& value : current) {
+        auto found = baseline.find(value.first);
+        if (found == baseline.end()) {
+            continue;
+        }
+        uint64_t before = found->second;
+        uint64_t now = value.second;
+        if (now <= before || now - before < min_ms
+            || now <= before * (1.0 + threshold)) {
+            continue;
+        }
+        char buf[160];
+        snprintf(buf, sizeof(buf), "%s regressed: %.1fs, baseline %.1fs (+%.0f%%)",
+            value.first.c_str(), now / 1000.0, before / 1000.0,
+            before ? 100.0 * (now - before) / before : 100.0);
+        warnings.push_back(buf);
+    }
+    return warnings;
+}
@@ -0,0 +1,113 @@
+/*
+ * ndb_rolling_restart_stats.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_STATS_HPP
+#define NDB_ROLLING_RESTART_STATS_HPP 1
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock::time_point stats_time_t;
+
+struct stats_node_s {
+    int node_id;
+    int node_group;
+    uint64_t restart_ms;
+};
+
+/* Collects the timings of one run, only the orchestrator thread calls
+   the stats_ functions, the summary is taken after the run. */
+struct ndb_stats_s {
+    std::vector<stats_node_s> nodes;
+    /* the durations of each phase, e.g. "start_phase 4" */
+    std::map<std::string, std::vector<uint64_t>> phases;
+    stats_time_t first_begin;
+    stats_time_t last_done;
+    stats_time_t idle_begin;
+    std::chrono::milliseconds idle{ 0 };
+    unsigned in_flight = 0;
+    bool begun = false;
+
+    /* where the baselines of every cluster are kept, none if empty */
+    std::string baseline_path;
+    /* a value more than this fraction above its baseline regressed */
+    double regression_threshold = 0.2;
+    /* differences below this are noise */
+    uint64_t regression_min_ms = 2000;
+};
+
+/* all of the following accept a null stats and then do nothing */
+void stats_nodes_begin(ndb_stats_s* stats, unsigned nodes, stats_time_t now);
+
+void stats_phase_done(ndb_stats_s* stats, const std::string& phase,
+    std::chrono::milliseconds duration);
+
+void stats_node_done(ndb_stats_s* stats, int node_id, int node_group,
+    uint64_t restart_ms, stats_time_t now);
+
+struct stats_distribution_s {
+    size_t count;
+    uint64_t p50_ms;
+    uint64_t p95_ms;
+    uint64_t max_ms;
+};
+
+struct stats_summary_s {
+    stats_distribution_s node;
+    std::map<std::string, stats_distribution_s> phases;
+    /* node group and the sum of its restart times, slowest first */
+    std::vector<std::pair<int, uint64_t>> slowest_groups;
+    uint64_t wall_ms; /* first restart to last node done */
+    uint64_t idle_ms; /* no node restarting in between */
+    double parallelism; /* restart time of all nodes / wall time */
+    std::map<int, uint64_t> node_ms; /* the last restart of each node */
+};
+
+/* nearest rank, 0 if there are no values */
+uint64_t stats_percentile(std::vector<uint64_t> values, unsigned percent);
+
+stats_summary_s summarize_stats(const ndb_stats_s& stats);
+
+/* a few lines of text, slowest at most max_groups node groups */
+std::vector<std::string> format_stats_summary(const stats_summary_s& summary,
+    size_t max_groups);
+
+/* the values a baseline keeps, by name, e.g. "node_p95_ms", and the
+   restart time of each node, e.g. "restart_node_3_ms" */
+std::map<std::string, uint64_t> stats_baseline_values(
+    const stats_summary_s& summary);
+
+/* the restart time of node_id in a baseline, if not known the median
+   of the nodes, 0 if neither is known */
+uint64_t stats_baseline_node_ms(const std::map<std::string, uint64_t>& baseline,
+    int node_id);
+
+/* the baselines of all clusters, a missing file is no error */
+int read_stats_baselines(const std::string& path,
+    std::map<std::string, std::map<std::string, uint64_t>>& baselines);
+
+int write_stats_baselines(const std::string& path,
+    const std::map<std::string, std::map<std::string, uint64_t>>& baselines);
+
+/* a warning for each value which regressed against its baseline */
+std::vector<std::string> compare_stats_baseline(
+    const std::map<std::string, uint64_t>& baseline,
+    const std::map<std::string, uint64_t>& current, double threshold,
+    uint64_t min_ms);
+
+#endif /* NDB_ROLLING_RESTART_STATS_HPP */
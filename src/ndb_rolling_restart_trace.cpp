@@ -0,0 +1,123 @@
+/*
+ * ndb_rolling_restart_trace
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_trace.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <set>
+
+using namespace std;
+
+void trace_add_span(ndb_trace_s* trace, const string& name,
+    const char* category, int track, chrono::steady_clock::time_point begin,
+    chrono::steady_clock::time_point end)
+{
+    if (!trace) {
+        return;
+    }
+
+    auto begin_us = chrono::duration_cast<chrono::microseconds>(
+        begin - trace->epoch);
+    auto duration_us = chrono::duration_cast<chrono::microseconds>(
+        end - begin);
+
+    lock_guard<mutex> guard(trace->lock);
+    trace->events.emplace_back(trace_event_s{ name, category, track,
+        (int64_t)begin_us.count(), (int64_t)duration_us.count() });
+}
+
+trace_span_s::trace_span_s(ndb_trace_s* trace, const string& name,
+    const char* category, int track)
+    : trace(trace)
+    , name(name)
+    , category(category)
+    , track(track)
+    , begin(chrono::steady_clock::now())
+{
+}
+
+trace_span_s::~trace_span_s()
+{
+    trace_add_span(trace, name, category, track, begin,
+        chrono::steady_clock::now());
+}
+
+string json_escape(const string& str)
+{
+    string escaped;
+    for (auto c : str) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else if (c == '\t') {
+            escaped += "\\t";
+        } else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)c);
+            escaped += buf;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+int write_chrome_trace(ndb_trace_s& trace, const string& path)
+{
+    ofstream out(path.c_str());
+    if (!out) {
+        return 1;
+    }
+
+    lock_guard<mutex> guard(trace.lock);
+
+    set<int> tracks;
+    for (const auto& event : trace.events) {
+        tracks.insert(event.track);
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    const char* sep = "\n";
+    for (auto track : tracks) {
+        out << sep << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+            << "\"tid\":" << track << ",\"args\":{\"name\":\"";
+        if (track == TRACE_TRACK_ORCHESTRATOR) {
+            out << "orchestrator";
+        } else if (track == TRACE_TRACK_PREFLIGHT) {
+            out << "preflight";
+        } else {
+            out << "node " << track;
+        }
+        out << "\"}}";
+        sep = ",\n";
+    }
+    for (const auto& event : trace.events) {
+        out << sep << "{\"name\":\"" << json_escape(event.name)
+            << "\",\"cat\":\"" << json_escape(event.category)
+            << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.track
+            << ",\"ts\":" << event.begin_us
+            << ",\"dur\":" << event.duration_us << "}";
+        sep = ",\n";
+    }
+    out << "\n]}\n";
+
+    if (!out) {
+        return 1;
+    }
+    return 0;
+}
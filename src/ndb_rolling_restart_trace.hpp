@@ -0,0 +1,70 @@
+/*
+ * ndb_rolling_restart_trace.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_TRACE_HPP
+#define NDB_ROLLING_RESTART_TRACE_HPP 1
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* spans which are not about a specific node go on this track */
+#define TRACE_TRACK_ORCHESTRATOR 0
+/* background checks of the next wave go on this track */
+#define TRACE_TRACK_PREFLIGHT -1
+
+struct trace_event_s {
+    std::string name;
+    std::string category;
+    int track; /* node_id or one of the TRACE_TRACK_ values */
+    int64_t begin_us;
+    int64_t duration_us;
+};
+
+struct ndb_trace_s {
+    std::mutex lock;
+    std::chrono::steady_clock::time_point epoch
+        = std::chrono::steady_clock::now();
+    std::vector<trace_event_s> events;
+};
+
+/* trace may be null, in which case nothing is recorded */
+void trace_add_span(ndb_trace_s* trace, const std::string& name,
+    const char* category, int track,
+    std::chrono::steady_clock::time_point begin,
+    std::chrono::steady_clock::time_point end);
+
+/* records a span from construction until destruction */
+struct trace_span_s {
+    trace_span_s(ndb_trace_s* trace, const std::string& name,
+        const char* category, int track);
+    ~trace_span_s();
+
+    ndb_trace_s* trace;
+    std::string name;
+    const char* category;
+    int track;
+    std::chrono::steady_clock::time_point begin;
+};
+
+/* escapes str for use inside a JSON string */
+std::string json_escape(const std::string& str);
+
+/* writes Chrome trace-event JSON, loadable in chrome://tracing or Perfetto */
+int write_chrome_trace(ndb_trace_s& trace, const std::string& path);
+
+#endif /* NDB_ROLLING_RESTART_TRACE_HPP */
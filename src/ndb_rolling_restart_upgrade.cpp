@@ -0,0 +1,643 @@
+/*
+ * ndb_rolling_restart_upgrade
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_upgrade.hpp"
+#include "ndb_rolling_restart_api.hpp"
+#include "ndb_rolling_restart_control.hpp"
+#include "ndb_rolling_restart_hooks.hpp"
+#include "ndb_rolling_restart_log.hpp"
+#include "ndb_rolling_restart_select.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <set>
+
+using namespace std;
+
+/* the longest pause between two reconnects, they start at a second */
+#define UPGRADE_MAX_RECONNECT_SECONDS 30
+
+static unsigned version_major(unsigned version)
+{
+    return (version >> 16) & 0xFF;
+}
+
+static unsigned version_minor(unsigned version)
+{
+    return (version >> 8) & 0xFF;
+}
+
+static string format_series(unsigned version)
+{
+    return to_string(version_major(version)) + "."
+        + to_string(version_minor(version));
+}
+
+string format_ndb_version(unsigned version)
+{
+    if (!version) {
+        return "unknown";
+    }
+    return format_series(version) + "." + to_string(version & 0xFF);
+}
+
+int parse_ndb_version(const string& text, unsigned& version)
+{
+    unsigned major;
+    unsigned minor;
+    unsigned build;
+    char end;
+    if (sscanf(text.c_str(), "%u.%u.%u%c", &major, &minor, &build, &end)
+            != 3
+        || major > 0xFF || minor > 0xFF || build > 0xFF || !major) {
+        return 1;
+    }
+    version = UPGRADE_MAKE_VERSION(major, minor, build);
+    return 0;
+}
+
+/* the release series which may follow each other */
+static bool next_series(unsigned from, unsigned to)
+{
+    unsigned from_major = version_major(from);
+    unsigned to_major = version_major(to);
+    unsigned from_minor = version_minor(from);
+    unsigned to_minor = version_minor(to);
+    if (from_major == to_major && to_minor == from_minor + 1) {
+        return true;
+    }
+    if (from_major == 7 && from_minor == 6) {
+        return to_major == 8 && to_minor == 0;
+    }
+    return from_major == 8 && from_minor == 0 && to_major == 8
+        && to_minor == 4;
+}
+
+int check_upgrade_path(unsigned from, unsigned to, string& reason)
+{
+    if (!from || !to) {
+        reason = "the version is unknown";
+        return 1;
+    }
+    if (format_series(from) == format_series(to)) {
+        return 0;
+    }
+    if (to < from) {
+        reason = "a downgrade from " + format_series(from) + " to "
+            + format_series(to) + " is not supported, only within a release"
+            + " series";
+        return 1;
+    }
+    if (!next_series(from, to)) {
+        reason = format_series(from) + " to " + format_series(to)
+            + " skips a release series";
+        return 1;
+    }
+    return 0;
+}
+
+upgrade_plan_s plan_upgrade(const ndb_mgm_cluster_state* cluster_state,
+    unsigned target, bool initial_restart)
+{
+    upgrade_plan_s plan{ 0, target, {}, {}, {}, {}, {} };
+    if (!cluster_state) {
+        plan.problems.push_back("no cluster state");
+        return plan;
+    }
+
+    /* node ids by version, sorted */
+    map<unsigned, set<int>> versions;
+    unsigned oldest_mgm = 0;
+    for (int i = 0; i < cluster_state->no_of_nodes; ++i) {
+        const ndb_mgm_node_state& node = cluster_state->node_states[i];
+        if (node.version <= 0) {
+            continue;
+        }
+        unsigned version = node.version;
+        versions[version].insert(node.node_id);
+        if (node.node_type == NDB_MGM_NODE_TYPE_MGM
+            && (!oldest_mgm || version < oldest_mgm)) {
+            oldest_mgm = version;
+        }
+    }
+    if (versions.empty()) {
+        plan.problems.push_back("no node reports a version");
+        return plan;
+    }
+    plan.from = versions.begin()->first;
+    if (!plan.target) {
+        plan.target = versions.rbegin()->first;
+    }
+
+    for (const auto& version : versions) {
+        string reason;
+        if (check_upgrade_path(version.first, plan.target, reason)) {
+            string nodes;
+            for (auto node_id : version.second) {
+                nodes += " " + to_string(node_id);
+            }
+            plan.problems.push_back("node" + nodes + " can not go from "
+                + format_ndb_version(version.first) + " to "
+                + format_ndb_version(plan.target) + ": " + reason);
+        }
+    }
+
+    for (int i = 0; i < cluster_state->no_of_nodes; ++i) {
+        const ndb_mgm_node_state& node = cluster_state->node_states[i];
+        if (node.version <= 0 || (unsigned)node.version == plan.target) {
+            continue;
+        }
+        switch (node.node_type) {
+        case NDB_MGM_NODE_TYPE_MGM:
+            plan.mgm_nodes.push_back(node.node_id);
+            break;
+        case NDB_MGM_NODE_TYPE_NDB:
+            plan.data_nodes.push_back(node.node_id);
+            break;
+        case NDB_MGM_NODE_TYPE_API:
+            plan.api_nodes.push_back(node.node_id);
+            break;
+        default:
+            break;
+        }
+    }
+    sort(plan.mgm_nodes.begin(), plan.mgm_nodes.end());
+    sort(plan.data_nodes.begin(), plan.data_nodes.end());
+    sort(plan.api_nodes.begin(), plan.api_nodes.end());
+
+    for (int i = 0; i < cluster_state->no_of_nodes; ++i) {
+        const ndb_mgm_node_state& node = cluster_state->node_states[i];
+        if (node.node_type != NDB_MGM_NODE_TYPE_MGM && oldest_mgm
+            && node.version > 0 && (unsigned)node.version > oldest_mgm) {
+            plan.warnings.push_back("node " + to_string(node.node_id)
+                + " runs " + format_ndb_version(node.version)
+                + " before the management nodes, which run "
+                + format_ndb_version(oldest_mgm));
+        }
+    }
+    if (!initial_restart && !plan.data_nodes.empty()
+        && format_series(plan.from) == "7.5"
+        && format_series(plan.target) == "7.6") {
+        plan.warnings.push_back("7.5 to 7.6 may need --initial, the data"
+                                " node file system format changed");
+    }
+    return plan;
+}
+
+bool versions_mixed(const ndb_mgm_cluster_state* cluster_state)
+{
+    if (!cluster_state) {
+        return false;
+    }
+    int seen = 0;
+    for (int i = 0; i < cluster_state->no_of_nodes; ++i) {
+        int version = cluster_state->node_states[i].version;
+        if (version <= 0) {
+            continue;
+        }
+        if (seen && version != seen) {
+            return true;
+        }
+        seen = version;
+    }
+    return false;
+}
+
+static string node_list(const vector<int>& node_ids)
+{
+    string list;
+    for (auto node_id : node_ids) {
+        list += " " + to_string(node_id);
+    }
+    return list;
+}
+
+/* of every node type, released with free() */
+static ndb_mgm_cluster_state* get_all_nodes(
+    ndb_connection_context_s& ndb_ctx)
+{
+    ndb_mgm_node_type node_types[4] = {
+        NDB_MGM_NODE_TYPE_MGM,
+        NDB_MGM_NODE_TYPE_NDB,
+        NDB_MGM_NODE_TYPE_API,
+        NDB_MGM_NODE_TYPE_UNKNOWN
+    };
+    return get_ndb_api(ndb_ctx).get_status2(ndb_ctx, node_types);
+}
+
+/* the nodes which do not run target, nodes which are not connected
+   count as not upgraded, and so do data nodes which are not STARTED */
+static vector<int> not_upgraded(const ndb_mgm_cluster_state* cluster_state,
+    const vector<int>& node_ids, unsigned target)
+{
+    vector<int> remaining;
+    for (auto node_id : node_ids) {
+        bool upgraded = false;
+        for (int i = 0; i < cluster_state->no_of_nodes; ++i) {
+            const ndb_mgm_node_state& node = cluster_state->node_states[i];
+            if (node.node_id == node_id) {
+                upgraded = (unsigned)node.version == target
+                    && (node.node_type != NDB_MGM_NODE_TYPE_NDB
+                        || node.node_status == NDB_MGM_NODE_STATUS_STARTED);
+            }
+        }
+        if (!upgraded) {
+            remaining.push_back(node_id);
+        }
+    }
+    return remaining;
+}
+
+/* the time the cluster spent with mixed versions, as far as seen */
+struct mixed_clock_s {
+    bool mixed = false;
+    chrono::steady_clock::time_point begin;
+    chrono::seconds total{ 0 };
+};
+
+static void sample_mixed(mixed_clock_s& clock,
+    const ndb_mgm_cluster_state* cluster_state)
+{
+    bool mixed = versions_mixed(cluster_state);
+    auto now = chrono::steady_clock::now();
+    if (mixed && !clock.mixed) {
+        clock.begin = now;
+    } else if (!mixed && clock.mixed) {
+        clock.total += chrono::duration_cast<chrono::seconds>(
+            now - clock.begin);
+    }
+    clock.mixed = mixed;
+}
+
+static chrono::seconds mixed_seconds(const mixed_clock_s& clock)
+{
+    if (!clock.mixed) {
+        return clock.total;
+    }
+    return clock.total + chrono::duration_cast<chrono::seconds>(
+        chrono::steady_clock::now() - clock.begin);
+}
+
+static bool upgrade_cancelled(ndb_connection_context_s& ndb_ctx)
+{
+    if (get_ndb_api(ndb_ctx).aborted()) {
+        return true;
+    }
+    return get_restart_control(ndb_ctx.cancel, nullptr, ndb_ctx.control_file)
+        == RESTART_CONTROL_CANCEL;
+}
+
+/* The management server may be the one the operator just restarted,
+   and the MGM API does not reconnect by itself. Retries, the pause
+   doubling each time, until connected, returns 1 if not by end or if
+   cancelled meanwhile. */
+static int upgrade_reconnect(ndb_connection_context_s& ndb_ctx,
+    chrono::steady_clock::time_point end)
+{
+    ndb_api_s& api = get_ndb_api(ndb_ctx);
+    close_ndb_connection(ndb_ctx);
+    chrono::seconds pause{ 1 };
+    for (unsigned tries = 1;; ++tries) {
+        if (api.connect(ndb_ctx) == 0) {
+            if (tries > 1) {
+                Cout(ndb_ctx) << "reconnected to ndb after " << tries
+                              << " tries";
+            }
+            return 0;
+        }
+        if (tries == 1) {
+            Cerr(ndb_ctx) << "could not reconnect to ndb, retrying";
+        }
+        if (chrono::steady_clock::now() >= end || upgrade_cancelled(ndb_ctx)) {
+            return 1;
+        }
+        api.sleep(ndb_ctx, pause);
+        pause = min(pause * 2, chrono::seconds(UPGRADE_MAX_RECONNECT_SECONDS));
+    }
+}
+
+/* Waits for nodes (re)started by the operator to come back with the
+   target version, returns the nodes which did not. */
+static vector<int> wait_for_upgrade(ndb_connection_context_s& ndb_ctx,
+    const string& action, const string& what, const vector<int>& node_ids,
+    const ndb_upgrade_s& upgrade, unsigned target, mixed_clock_s& clock)
+{
+    ndb_api_s& api = get_ndb_api(ndb_ctx);
+    auto end = chrono::steady_clock::now() + upgrade.node_wait;
+    vector<int> remaining = node_ids;
+    Cout(ndb_ctx) << action << " " << what << node_list(remaining)
+                  << " with " << format_ndb_version(target)
+                  << ", waiting up to " << upgrade.node_wait.count() << "s";
+    while (!remaining.empty() && chrono::steady_clock::now() < end
+        && !upgrade_cancelled(ndb_ctx)) {
+        api.sleep(ndb_ctx, chrono::seconds(1));
+        ndb_mgm_cluster_state* cluster_state = get_all_nodes(ndb_ctx);
+        if (!cluster_state) {
+            if (upgrade_reconnect(ndb_ctx, end)) {
+                break;
+            }
+            continue;
+        }
+        sample_mixed(clock, cluster_state);
+        vector<int> now_remaining = not_upgraded(cluster_state, remaining,
+            target);
+        free((void*)cluster_state);
+        for (auto node_id : remaining) {
+            if (find(now_remaining.begin(), now_remaining.end(), node_id)
+                == now_remaining.end()) {
+                Cnode(ndb_ctx, node_id) << what << " " << node_id
+                                        << " runs "
+                                        << format_ndb_version(target);
+            }
+        }
+        remaining.swap(now_remaining);
+    }
+    return remaining;
+}
+
+/* returns 1 if the hook is set and failed */
+static int run_upgrade_hook(ndb_connection_context_s& ndb_ctx,
+    const string& hook, const string& point, const vector<int>& node_ids,
+    chrono::seconds timeout)
+{
+    if (hook.empty()) {
+        return 0;
+    }
+    string error;
+    if (run_wave_hook(hook, point, ndb_ctx.current_wave, node_ids, timeout,
+            error)) {
+        Cerr(ndb_ctx) << point << " hook node" << node_list(node_ids)
+                      << " failed: " << error;
+        return 1;
+    }
+    Cout(ndb_ctx) << point << " hook node" << node_list(node_ids) << " ok";
+    return 0;
+}
+
+/* the outdated data nodes within the selection of ndb_ctx, if there is
+   one, in waves with at most one node per node group */
+static vector<vector<restart_node_status_s>> plan_data_node_waves(
+    ndb_connection_context_s& ndb_ctx, const vector<int>& data_nodes)
+{
+    const ndb_mgm_cluster_state* cluster_state = ndb_ctx.cluster_state;
+    set<int> selected;
+    if (ndb_ctx.selection) {
+        selected = select_nodes(*ndb_ctx.selection, cluster_state);
+    }
+    vector<restart_node_status_s> nodes;
+    for (int i = 0; i < cluster_state->no_of_nodes; ++i) {
+        const ndb_mgm_node_state& node = cluster_state->node_states[i];
+        if (find(data_nodes.begin(), data_nodes.end(), node.node_id)
+                == data_nodes.end()
+            || (ndb_ctx.selection && !selected.count(node.node_id))) {
+            continue;
+        }
+        nodes.push_back(
+            restart_node_status_s{ node.node_id, node.node_group, false });
+    }
+    if (nodes.empty()) {
+        return {};
+    }
+    sort_node_restarts(nodes);
+    return get_restart_waves(nodes);
+}
+
+/* with nostart, a restart would have the angel process start the
+   binary it was started with again */
+static int stop_data_nodes(ndb_connection_context_s& ndb_ctx,
+    const vector<int>& node_ids)
+{
+    int cnt = (int)node_ids.size();
+    int initial = ndb_ctx.initial_restart ? 1 : 0;
+    int nostart = 1;
+    int abort = 0;
+    int force = 0;
+    int disconnect = 0;
+
+    Cout(ndb_ctx) << "ndb_mgm_restart4 nostart" << (initial ? " initial" : "")
+                  << " node" << node_list(node_ids);
+    for (auto node_id : node_ids) {
+        emit_restart_event(ndb_ctx, RESTART_EVENT_NODE_BEGIN, node_id,
+            initial, "");
+    }
+    int ret = get_ndb_api(ndb_ctx).restart4(ndb_ctx, cnt, node_ids.data(),
+        initial, nostart, abort, force, &disconnect);
+    if (ret != cnt) {
+        Cerr(ndb_ctx) << "ndb_mgm_restart4 nostart node" << node_list(node_ids)
+                      << " returned " << ret;
+        return 1;
+    }
+    if (initial) {
+        Cout(ndb_ctx) << "start data node" << node_list(node_ids)
+                      << " with --initial";
+    }
+    if (disconnect) {
+        close_ndb_connection(ndb_ctx);
+        if (init_ndb_connection(ndb_ctx)) {
+            Cerr(ndb_ctx) << "could not reconnect to ndb";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Stops the outdated data nodes a wave at a time, within the selection
+   of ndb_ctx if there is one. The next wave is only stopped once the
+   nodes of this one run the target version and are STARTED again. */
+static int upgrade_data_nodes(ndb_connection_context_s& ndb_ctx,
+    const vector<int>& data_nodes, const ndb_upgrade_s& upgrade,
+    unsigned target, mixed_clock_s& clock)
+{
+    if (refresh_cluster_state(ndb_ctx)) {
+        Cerr(ndb_ctx) << "ndb_mgm_get_status2 returned null?";
+        return 1;
+    }
+    auto waves = plan_data_node_waves(ndb_ctx, data_nodes);
+    for (size_t w = 0; w < waves.size(); ++w) {
+        if (upgrade_cancelled(ndb_ctx)) {
+            Cerr(ndb_ctx) << "upgrade cancelled before wave " << (w + 1);
+            return 1;
+        }
+        vector<int> node_ids;
+        for (const auto& node : waves[w]) {
+            node_ids.push_back(node.node_id);
+        }
+        ndb_ctx.current_wave = w + 1;
+        Cout(ndb_ctx) << "wave " << (w + 1) << " of " << waves.size();
+        emit_restart_event(ndb_ctx, RESTART_EVENT_WAVE_BEGIN, 0,
+            node_ids.size(), "");
+        /* a partner which is down has no version, so it is in no
+           wave, this node may be the last live replica of its group */
+        if (wait_live_replicas(ndb_ctx, node_ids)) {
+            return 1;
+        }
+        if (ndb_ctx.hooks
+            && run_upgrade_hook(ndb_ctx, ndb_ctx.hooks->pre_wave,
+                "pre_wave", node_ids, ndb_ctx.hooks->timeout)) {
+            return 1;
+        }
+
+        auto begin = chrono::steady_clock::now();
+        if (stop_data_nodes(ndb_ctx, node_ids)
+            || run_upgrade_hook(ndb_ctx, upgrade.start_hook, "start",
+                node_ids, upgrade.hook_timeout)) {
+            return 1;
+        }
+        vector<int> remaining = wait_for_upgrade(ndb_ctx, "start",
+            "data node", node_ids, upgrade, target, clock);
+        if (!remaining.empty()) {
+            Cerr(ndb_ctx) << "data node" << node_list(remaining)
+                          << " does not run " << format_ndb_version(target);
+            return 1;
+        }
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(
+            chrono::steady_clock::now() - begin);
+        for (auto node_id : node_ids) {
+            emit_restart_event(ndb_ctx, RESTART_EVENT_NODE_DONE, node_id,
+                elapsed.count(), "");
+        }
+        if (ndb_ctx.hooks) {
+            /* the nodes are up, a failure is reported but changes
+               nothing */
+            run_upgrade_hook(ndb_ctx, ndb_ctx.hooks->post_wave, "post_wave",
+                node_ids, ndb_ctx.hooks->timeout);
+        }
+    }
+    return 0;
+}
+
+static void report_plan(ndb_connection_context_s& ndb_ctx,
+    const upgrade_plan_s& plan)
+{
+    Cout(ndb_ctx) << "upgrade from " << format_ndb_version(plan.from)
+                  << " to " << format_ndb_version(plan.target);
+    Cout(ndb_ctx) << "management nodes:"
+                  << (plan.mgm_nodes.empty() ? " none"
+                                             : node_list(plan.mgm_nodes));
+    Cout(ndb_ctx) << "data nodes:"
+                  << (plan.data_nodes.empty() ? " none"
+                                              : node_list(plan.data_nodes));
+    Cout(ndb_ctx) << "API nodes:"
+                  << (plan.api_nodes.empty() ? " none"
+                                             : node_list(plan.api_nodes));
+    for (const auto& warning : plan.warnings) {
+        Cout(ndb_ctx) << "warning: " << warning;
+    }
+}
+
+static int upgrade_cluster(ndb_connection_context_s& ndb_ctx,
+    const ndb_upgrade_s& upgrade)
+{
+    if (init_ndb_connection(ndb_ctx)) {
+        Cerr(ndb_ctx) << "error connecting to ndb '" << ndb_ctx.connect_string
+                      << "'";
+        return 1;
+    }
+    ndb_mgm_cluster_state* cluster_state = get_all_nodes(ndb_ctx);
+    if (!cluster_state) {
+        Cerr(ndb_ctx) << "ndb_mgm_get_status2 returned null?";
+        close_ndb_connection(ndb_ctx);
+        return 1;
+    }
+    upgrade_plan_s plan = plan_upgrade(cluster_state, upgrade.target,
+        ndb_ctx.initial_restart);
+    mixed_clock_s clock;
+    sample_mixed(clock, cluster_state);
+    free((void*)cluster_state);
+
+    report_plan(ndb_ctx, plan);
+    if (!plan.problems.empty()) {
+        for (const auto& problem : plan.problems) {
+            Cerr(ndb_ctx) << problem;
+        }
+        close_ndb_connection(ndb_ctx);
+        return 1;
+    }
+    if (plan.mgm_nodes.empty() && plan.data_nodes.empty()
+        && plan.api_nodes.empty()) {
+        Cout(ndb_ctx) << "every node runs " << format_ndb_version(plan.target);
+        close_ndb_connection(ndb_ctx);
+        return 0;
+    }
+
+    int rv = 0;
+    vector<int> remaining;
+    /* data and API nodes need a management node which knows the target
+       version, it goes first */
+    if (!plan.mgm_nodes.empty()) {
+        auto begin = chrono::steady_clock::now();
+        remaining = wait_for_upgrade(ndb_ctx, "restart", "management node",
+            plan.mgm_nodes, upgrade, plan.target, clock);
+        Cout(ndb_ctx) << "management nodes took "
+                      << chrono::duration_cast<chrono::seconds>(
+                             chrono::steady_clock::now() - begin)
+                             .count()
+                      << "s";
+        if (!remaining.empty()) {
+            Cerr(ndb_ctx) << "management node" << node_list(remaining)
+                          << " does not run "
+                          << format_ndb_version(plan.target);
+            rv = 1;
+        }
+    }
+
+    if (!rv && !plan.data_nodes.empty()) {
+        auto begin = chrono::steady_clock::now();
+        rv = upgrade_data_nodes(ndb_ctx, plan.data_nodes, upgrade,
+            plan.target, clock);
+        Cout(ndb_ctx) << "data nodes took "
+                      << chrono::duration_cast<chrono::seconds>(
+                             chrono::steady_clock::now() - begin)
+                             .count()
+                      << "s";
+    }
+
+    if (!rv && !plan.api_nodes.empty()) {
+        auto begin = chrono::steady_clock::now();
+        remaining = wait_for_upgrade(ndb_ctx, "restart", "API node",
+            plan.api_nodes, upgrade, plan.target, clock);
+        Cout(ndb_ctx) << "API nodes took "
+                      << chrono::duration_cast<chrono::seconds>(
+                             chrono::steady_clock::now() - begin)
+                             .count()
+                      << "s";
+        if (!remaining.empty()) {
+            Cerr(ndb_ctx) << "API node" << node_list(remaining)
+                          << " does not run "
+                          << format_ndb_version(plan.target);
+            rv = 1;
+        }
+    }
+
+    cluster_state = get_all_nodes(ndb_ctx);
+    if (cluster_state) {
+        sample_mixed(clock, cluster_state);
+        free((void*)cluster_state);
+    }
+    Cout(ndb_ctx) << "mixed versions for " << mixed_seconds(clock).count()
+                  << "s" << (clock.mixed ? ", still mixed" : "");
+    close_ndb_connection(ndb_ctx);
+    return rv;
+}
+
+int ndb_rolling_restart_upgrade(ndb_connection_context_s& ndb_ctx,
+    const ndb_upgrade_s& upgrade)
+{
+    int rv = upgrade_cluster(ndb_ctx, upgrade);
+    emit_restart_event(ndb_ctx, RESTART_EVENT_FINISHED, 0, rv, "");
+    return rv;
+}
@@ -0,0 +1,86 @@
+/*
+ * ndb_rolling_restart_upgrade.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_UPGRADE_HPP
+#define NDB_ROLLING_RESTART_UPGRADE_HPP 1
+
+#include "ndb_rolling_restart.hpp"
+#include <chrono>
+#include <string>
+#include <vector>
+
+/* as NDB_MAKE_VERSION of ndb_version.h */
+#define UPGRADE_MAKE_VERSION(major, minor, build) \
+    (((major) << 16) | ((minor) << 8) | (build))
+
+/* e.g. "7.6.10", "unknown" for 0 */
+std::string format_ndb_version(unsigned version);
+
+/* "8.0.30", returns 0 on success */
+int parse_ndb_version(const std::string& text, unsigned& version);
+
+/* Returns 0 if nodes may go from one version to the other in a rolling
+   restart: within a release series, or to the next one, e.g. 7.5 to
+   7.6, 7.6 to 8.0 or 8.0 to 8.4. A downgrade has to stay within its
+   series. Otherwise reason says why not. */
+int check_upgrade_path(unsigned from, unsigned to, std::string& reason);
+
+/* the nodes of each type which do not run the target version yet, in
+   the order they are upgraded */
+struct upgrade_plan_s {
+    unsigned from; /* the oldest version in the cluster */
+    unsigned target;
+    std::vector<int> mgm_nodes;
+    std::vector<int> data_nodes;
+    std::vector<int> api_nodes;
+    /* any of these stops the upgrade */
+    std::vector<std::string> problems;
+    std::vector<std::string> warnings;
+};
+
+/* Plans the upgrade of the nodes of every type in cluster_state to the
+   target version, the newest version in the cluster if 0. Nodes which
+   are not connected have no version and are left out. */
+upgrade_plan_s plan_upgrade(const ndb_mgm_cluster_state* cluster_state,
+    unsigned target, bool initial_restart);
+
+/* true if the connected nodes run more than one version */
+bool versions_mixed(const ndb_mgm_cluster_state* cluster_state);
+
+struct ndb_upgrade_s {
+    unsigned target = 0; /* the newest version in the cluster if 0 */
+    /* how long to wait for a node to come back with the target version,
+       they are started with the new binary by the operator */
+    std::chrono::seconds node_wait{ 600 };
+    /* run as a wave hook at the point "start" once a wave of data
+       nodes is stopped, e.g. to start them with the new binary, none if
+       empty, see ndb_rolling_restart_hooks.hpp */
+    std::string start_hook;
+    std::chrono::seconds hook_timeout{ 60 };
+};
+
+/* Upgrades the cluster with the shortest mixed-version window: the
+   management nodes first, then the data nodes in waves as a rolling
+   restart would, then the API nodes. A restart would only bring back
+   the binary the node was started with, so the management server
+   stops each wave of data nodes with nostart, and the management and
+   API nodes are not stopped at all. The operator, or the start hook,
+   starts the nodes with the new binary, and the upgrade waits for them
+   to run the target version before it goes on. Reports the time the
+   cluster spent with mixed versions. */
+int ndb_rolling_restart_upgrade(ndb_connection_context_s& ndb_ctx,
+    const ndb_upgrade_s& upgrade);
+
+#endif /* NDB_ROLLING_RESTART_UPGRADE_HPP */
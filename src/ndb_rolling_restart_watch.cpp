@@ -0,0 +1,293 @@
+/*
+ * ndb_rolling_restart_watch
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ndb_rolling_restart_watch.hpp"
+#include "ndb_rolling_restart_api.hpp"
+#include "ndb_rolling_restart_control.hpp"
+#include "ndb_rolling_restart_log.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+#define WATCH_COLOR_CHANGED "\033[1;33m"
+#define WATCH_COLOR_DEGRADED "\033[1;31m"
+#define WATCH_COLOR_RESET "\033[0m"
+
+/* the longest a wait for an event blocks, so a cancel is seen soon */
+#define WATCH_MAX_BLOCK_MS 1000
+
+/* the longest pause between two reconnects, they start at interval */
+#define WATCH_MAX_RECONNECT_MS 30000
+
+static string highlight(const string& field, bool changed, bool color)
+{
+    if (!changed || !color) {
+        return field;
+    }
+    return WATCH_COLOR_CHANGED + field + WATCH_COLOR_RESET;
+}
+
+string format_watch_header()
+{
+    return "  node group status        phase connects";
+}
+
+string format_watch_row(const node_snapshot_s& node, unsigned changes,
+    bool color)
+{
+    bool added = changes & NODE_CHANGE_ADDED;
+    char node_id[16];
+    snprintf(node_id, sizeof(node_id), "%4d", node.node_id);
+    char group[16];
+    if (node.node_group >= 0 && node.node_group < NODE_TABLE_MAX_GROUPS) {
+        snprintf(group, sizeof(group), "%5d", node.node_group);
+    } else {
+        snprintf(group, sizeof(group), "%5s", "-");
+    }
+    char status[32];
+    snprintf(status, sizeof(status), "%-13s",
+        ndb_mgm_get_node_status_string(node.node_status));
+    char phase[16];
+    if (node.node_status == NDB_MGM_NODE_STATUS_STARTING) {
+        snprintf(phase, sizeof(phase), "%5d", node.start_phase);
+    } else {
+        snprintf(phase, sizeof(phase), "%5s", "-");
+    }
+    char connects[16];
+    snprintf(connects, sizeof(connects), "%8d", node.connect_count);
+
+    string row = changes ? "* " : "  ";
+    row += highlight(node_id, added, color) + " ";
+    row += highlight(group, added, color) + " ";
+    row += highlight(status, added || (changes & NODE_CHANGE_STATUS), color);
+    row += " ";
+    row += highlight(phase, added || (changes & NODE_CHANGE_START_PHASE),
+        color);
+    row += " ";
+    row += highlight(connects,
+        added || (changes & NODE_CHANGE_CONNECT_COUNT), color);
+    return row;
+}
+
+string format_watch_replicas(const node_table_s& table, bool color)
+{
+    string line = "replicas:";
+    const char* sep = " ";
+    for (size_t group = 0; group < table.group_nodes.size(); ++group) {
+        size_t nodes = table.group_nodes[group].count();
+        if (!nodes) {
+            continue;
+        }
+        int live = table.group_live[group];
+        string replicas = to_string(group) + " " + to_string(live) + "/"
+            + to_string(nodes);
+        if ((size_t)live < nodes && color) {
+            replicas = WATCH_COLOR_DEGRADED + replicas + WATCH_COLOR_RESET;
+        } else if ((size_t)live < nodes) {
+            replicas += " (degraded)";
+        }
+        line += sep + replicas;
+        sep = ", ";
+    }
+    if (line == "replicas:") {
+        line += " none";
+    }
+    return line;
+}
+
+static void report_watch_table(ndb_connection_context_s& ndb_ctx,
+    const ndb_watch_s& watch)
+{
+    Cout(ndb_ctx) << format_watch_header();
+    for (const auto& node : ndb_ctx.snapshot.nodes) {
+        Cnode(ndb_ctx, node.node_id) << format_watch_row(node, 0,
+            watch.color);
+    }
+}
+
+/* takes a status sample and reports what changed, returns 1 if the
+   management server did not answer */
+static int watch_poll(ndb_connection_context_s& ndb_ctx,
+    const ndb_watch_s& watch, string& replicas)
+{
+    ndb_mgm_node_type node_types[2] = {
+        NDB_MGM_NODE_TYPE_NDB,
+        NDB_MGM_NODE_TYPE_UNKNOWN
+    };
+    ndb_mgm_cluster_state* cluster_state = get_ndb_api(ndb_ctx).get_status2(
+        ndb_ctx, node_types);
+    if (!cluster_state) {
+        return 1;
+    }
+    update_cluster_snapshot(ndb_ctx.snapshot, cluster_state);
+    update_node_table(ndb_ctx.node_table, cluster_state);
+    free((void*)cluster_state);
+
+    for (const auto& change : ndb_ctx.snapshot.changes) {
+        if (change.changes & NODE_CHANGE_REMOVED) {
+            Cnode(ndb_ctx, change.before.node_id)
+                << describe_node_change(change);
+            continue;
+        }
+        Cnode(ndb_ctx, change.after.node_id)
+            << format_watch_row(change.after, change.changes, watch.color);
+    }
+    string now_replicas = format_watch_replicas(ndb_ctx.node_table,
+        watch.color);
+    if (now_replicas != replicas) {
+        replicas = now_replicas;
+        Cout(ndb_ctx) << replicas;
+    }
+    return 0;
+}
+
+/* returns true if node restart events came, all that came are taken */
+static bool wait_for_events(ndb_connection_context_s& ndb_ctx,
+    NdbLogEventHandle& events, chrono::milliseconds wait)
+{
+    ndb_api_s& api = get_ndb_api(ndb_ctx);
+    if (!events) {
+        api.sleep(ndb_ctx, wait);
+        return false;
+    }
+    ndb_logevent event;
+    int ret = api.next_restart_event(events, &event, wait.count());
+    if (ret < 0) {
+        /* subscribed again at the next idle poll */
+        api.close_restart_events(events);
+        events = nullptr;
+        api.sleep(ndb_ctx, wait);
+        return false;
+    }
+    if (ret == 0) {
+        return false;
+    }
+    while (api.next_restart_event(events, &event, 0) > 0) {
+    }
+    return true;
+}
+
+static bool watch_cancelled(ndb_connection_context_s& ndb_ctx)
+{
+    return get_restart_control(ndb_ctx.cancel, nullptr, ndb_ctx.control_file)
+        == RESTART_CONTROL_CANCEL
+        || get_ndb_api(ndb_ctx).aborted();
+}
+
+/* retries, the pause doubling each time, until connected, returns 1 if
+   cancelled meanwhile */
+static int watch_reconnect(ndb_connection_context_s& ndb_ctx,
+    const ndb_watch_s& watch)
+{
+    ndb_api_s& api = get_ndb_api(ndb_ctx);
+    auto pause = watch.interval;
+    for (unsigned tries = 1;; ++tries) {
+        api.sleep(ndb_ctx, pause);
+        if (watch_cancelled(ndb_ctx)) {
+            return 1;
+        }
+        if (api.connect(ndb_ctx) == 0) {
+            if (tries > 1) {
+                Cout(ndb_ctx) << "reconnected to ndb after " << tries
+                              << " tries";
+            }
+            return 0;
+        }
+        if (tries == 1) {
+            Cerr(ndb_ctx) << "could not reconnect to ndb, retrying";
+        }
+        pause = min(pause * 2, chrono::milliseconds(WATCH_MAX_RECONNECT_MS));
+    }
+}
+
+static int watch_cluster(ndb_connection_context_s& ndb_ctx,
+    const ndb_watch_s& watch)
+{
+    if (init_ndb_connection(ndb_ctx)) {
+        Cerr(ndb_ctx) << "error connecting to ndb '" << ndb_ctx.connect_string
+                      << "'";
+        return 1;
+    }
+    ndb_api_s& api = get_ndb_api(ndb_ctx);
+
+    report_watch_table(ndb_ctx, watch);
+    string replicas = format_watch_replicas(ndb_ctx.node_table, watch.color);
+    Cout(ndb_ctx) << replicas;
+
+    NdbLogEventHandle events = api.open_restart_events(ndb_ctx);
+    if (!events) {
+        Cout(ndb_ctx) << "no node restart events, polling only";
+    }
+
+    auto now = chrono::steady_clock::now();
+    auto last_poll = now;
+    auto last_event = now - watch.busy_after_event;
+    unsigned long polls = 0;
+    while (!watch.max_polls || polls < watch.max_polls) {
+        if (watch_cancelled(ndb_ctx)) {
+            break;
+        }
+
+        now = chrono::steady_clock::now();
+        const node_table_s& table = ndb_ctx.node_table;
+        bool busy = table.started != table.present
+            || now - last_event < watch.busy_after_event;
+        auto due = last_poll + (busy ? watch.interval : watch.idle_interval);
+        if (now < due) {
+            auto wait = chrono::duration_cast<chrono::milliseconds>(
+                due - now);
+            wait = min(wait, chrono::milliseconds(WATCH_MAX_BLOCK_MS));
+            if (wait_for_events(ndb_ctx, events, wait)) {
+                last_event = chrono::steady_clock::now();
+            } else {
+                continue;
+            }
+        }
+
+        last_poll = chrono::steady_clock::now();
+        ++polls;
+        if (watch_poll(ndb_ctx, watch, replicas) == 0) {
+            if (!events && !busy) {
+                events = api.open_restart_events(ndb_ctx);
+            }
+            continue;
+        }
+        Cerr(ndb_ctx) << "ndb_mgm_get_status2 returned null?";
+        if (events) {
+            api.close_restart_events(events);
+            events = nullptr;
+        }
+        close_ndb_connection(ndb_ctx);
+        if (watch_reconnect(ndb_ctx, watch)) {
+            break;
+        }
+    }
+
+    if (events) {
+        api.close_restart_events(events);
+    }
+    close_ndb_connection(ndb_ctx);
+    return 0;
+}
+
+int ndb_rolling_restart_watch(ndb_connection_context_s& ndb_ctx,
+    const ndb_watch_s& watch)
+{
+    int rv = watch_cluster(ndb_ctx, watch);
+    emit_restart_event(ndb_ctx, RESTART_EVENT_FINISHED, 0, rv, "");
+    return rv;
+}
@@ -0,0 +1,57 @@
+/*
+ * ndb_rolling_restart_watch.hpp
+ * Copyright (C) 2018 Eric Herman <eric@freesa.org>
+ *
+ * This work is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef NDB_ROLLING_RESTART_WATCH_HPP
+#define NDB_ROLLING_RESTART_WATCH_HPP 1
+
+#include "ndb_rolling_restart.hpp"
+#include <chrono>
+#include <string>
+
+struct ndb_watch_s {
+    /* between polls while a node is not STARTED, or soon after a node
+       restart event */
+    std::chrono::milliseconds interval{ 500 };
+    /* between polls while the cluster is quiet, an event wakes it */
+    std::chrono::milliseconds idle_interval{ 5000 };
+    /* how long after an event the polls stay at interval */
+    std::chrono::milliseconds busy_after_event{ 10000 };
+    /* highlights changes with ANSI escapes, else they are marked '*' */
+    bool color = false;
+    /* stops after this many polls, 0 is until cancelled */
+    unsigned long max_polls = 0;
+};
+
+/* "node group status        phase connects" */
+std::string format_watch_header();
+
+/* a row of the table, changes are node_change_e bits, e.g.:
+   "*   3     1 STARTING          4        2" */
+std::string format_watch_row(const node_snapshot_s& node, unsigned changes,
+    bool color);
+
+/* the STARTED nodes of each node group, a group missing one is marked,
+   e.g.: "replicas: 0 2/2, 1 1/2 (degraded)" */
+std::string format_watch_replicas(const node_table_s& table, bool color);
+
+/* Shows the data nodes as a table, then only the rows which changed and
+   the replicas when they changed, until ndb_ctx.cancel or the control
+   file says cancel. One management connection is polled, one node
+   restart event subscription wakes the poll. A lost connection is
+   retried until cancelled, only the first connect must succeed. */
+int ndb_rolling_restart_watch(ndb_connection_context_s& ndb_ctx,
+    const ndb_watch_s& watch);
+
+#endif /* NDB_ROLLING_RESTART_WATCH_HPP */
@@ -0,0 +1,198 @@
+#include "cluster_fixture.hpp"
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+ndb_mgm_node_state make_node_state(int node_id, int node_group)
+{
+    ndb_mgm_node_state node;
+    memset(&node, 0, sizeof(node));
+    node.node_id = node_id;
+    node.node_type = NDB_MGM_NODE_TYPE_NDB;
+    node.node_status = NDB_MGM_NODE_STATUS_STARTED;
+    node.node_group = node_group;
+    node.version = 0x00070610;
+    node.connect_count = 1;
+    return node;
+}
+
+ndb_mgm_cluster_state* make_cluster_state(
+    const std::vector<ndb_mgm_node_state>& nodes)
+{
+    size_t size = sizeof(ndb_mgm_cluster_state)
+        + nodes.size() * sizeof(ndb_mgm_node_state);
+    ndb_mgm_cluster_state* cluster_state
+        = (ndb_mgm_cluster_state*)malloc(size);
+    memset(cluster_state, 0, size);
+    cluster_state->no_of_nodes = (int)nodes.size();
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        cluster_state->node_states[i] = nodes[i];
+    }
+    return cluster_state;
+}
+
+ndb_mgm_cluster_state* make_cluster_state(int no_of_nodes)
+{
+    std::vector<ndb_mgm_node_state> nodes;
+    for (int i = 0; i < no_of_nodes; ++i) {
+        int node_id = no_of_nodes + 1 - i;
+        nodes.push_back(make_node_state(node_id, (node_id - 2) / 2));
+    }
+    return make_cluster_state(nodes);
+}
+
+scripted_api_s::scripted_api_s(int no_of_nodes)
+{
+    for (int i = 0; i < no_of_nodes; ++i) {
+        nodes.push_back(make_node_state(i + 2, i / 2));
+    }
+}
+
+ndb_mgm_node_state* scripted_api_s::node(int node_id)
+{
+    for (auto& node : nodes) {
+        if (node.node_id == node_id) {
+            return &node;
+        }
+    }
+    return nullptr;
+}
+
+std::string scripted_api_s::down_nodes()
+{
+    std::string down;
+    for (const auto& node : nodes) {
+        if (node.node_status == NDB_MGM_NODE_STATUS_STARTED) {
+            continue;
+        }
+        down += down.empty() ? " (" : ", ";
+        down += std::to_string(node.node_id) + " "
+            + ndb_mgm_get_node_status_string(node.node_status);
+        if (node.node_status == NDB_MGM_NODE_STATUS_STARTING) {
+            down += " " + std::to_string(node.start_phase);
+        }
+    }
+    return down.empty() ? down : down + ")";
+}
+
+int scripted_api_s::connect(ndb_connection_context_s& ndb_ctx)
+{
+    if (failed_connects > 0) {
+        --failed_connects;
+        return 1;
+    }
+    ++connects;
+    ndb_ctx.ndb_mgm_handle = (NdbMgmHandle)1;
+    return 0;
+}
+
+void scripted_api_s::disconnect(ndb_connection_context_s& ndb_ctx)
+{
+    ndb_ctx.ndb_mgm_handle = nullptr;
+}
+
+std::string scripted_api_s::get_system_name(ndb_connection_context_s&)
+{
+    return "scripted";
+}
+
+ndb_mgm_cluster_state* scripted_api_s::get_status2(
+    ndb_connection_context_s& ndb_ctx, const ndb_mgm_node_type node_types[])
+{
+    if (failed_polls > 0) {
+        --failed_polls;
+        return nullptr;
+    }
+    if (!statuses.empty()) {
+        const auto& poll = statuses[std::min(polls, statuses.size() - 1)];
+        for (size_t i = 0; i < poll.size() && i < nodes.size(); ++i) {
+            nodes[i].node_status = poll[i];
+            nodes[i].start_phase
+                = poll[i] == NDB_MGM_NODE_STATUS_STARTING ? 4 : 0;
+        }
+    }
+    ++polls;
+    for (auto it = recovering.begin(); it != recovering.end();) {
+        ndb_mgm_node_state* state = node(it->first);
+        if (it->second == 0) {
+            ++state->connect_count;
+        }
+        state->node_status = recovery[it->second].first;
+        state->start_phase = recovery[it->second].second;
+        if (++it->second == recovery.size()) {
+            it = recovering.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return make_cluster_state(nodes);
+}
+
+int scripted_api_s::restart4(ndb_connection_context_s& ndb_ctx, int cnt,
+    const int* node_ids, int initial, int nostart, int abort, int force,
+    int* disconnect)
+{
+    if (failed_restarts > 0) {
+        --failed_restarts;
+        return -1;
+    }
+    std::string call = nostart ? "restart4 nostart" : "restart4";
+    for (int i = 0; i < cnt; ++i) {
+        call += " " + std::to_string(node_ids[i]);
+    }
+    calls.push_back(call + down_nodes());
+    for (int i = 0; i < cnt; ++i) {
+        if (nostart) {
+            node(node_ids[i])->node_status = NDB_MGM_NODE_STATUS_NOT_STARTED;
+            node(node_ids[i])->start_phase = 0;
+        } else {
+            recovering[node_ids[i]] = 0;
+        }
+    }
+    *disconnect = 0;
+    if (on_restart) {
+        on_restart(*this);
+    }
+    return cnt;
+}
+
+int scripted_api_s::wait_until_ready(ndb_connection_context_s& ndb_ctx,
+    const int* node_ids, int cnt, int timeout)
+{
+    ++waits;
+    for (int i = 0; i < cnt; ++i) {
+        auto it = recovering.find(node_ids[i]);
+        if (it == recovering.end()) {
+            continue;
+        }
+        ndb_mgm_node_state* state = node(node_ids[i]);
+        if (it->second == 0) {
+            ++state->connect_count;
+        }
+        state->node_status = NDB_MGM_NODE_STATUS_STARTED;
+        state->start_phase = 0;
+        recovering.erase(it);
+    }
+    return 0;
+}
+
+int scripted_api_s::dump_state(ndb_connection_context_s& ndb_ctx,
+    int node_id, const int* args, int num_args, ndb_mgm_reply* reply)
+{
+    reply->return_code = 0;
+    return 0;
+}
+
+void scripted_api_s::sleep(ndb_connection_context_s& ndb_ctx,
+    std::chrono::milliseconds duration)
+{
+    ++sleeps;
+    if (on_sleep) {
+        on_sleep(*this);
+    }
+}
+
+bool scripted_api_s::aborted()
+{
+    return abort;
+}
@@ -0,0 +1,78 @@
+#ifndef CLUSTER_FIXTURE_HPP
+#define CLUSTER_FIXTURE_HPP 1
+
+#include "ndb_rolling_restart.hpp"
+#include "ndb_rolling_restart_api.hpp"
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* a STARTED data node, connect_count 1, version 7.6.16 */
+ndb_mgm_node_state make_node_state(int node_id, int node_group);
+
+/* holds a copy of nodes, released with free() */
+ndb_mgm_cluster_state* make_cluster_state(
+    const std::vector<ndb_mgm_node_state>& nodes);
+
+/* data nodes 2 to no_of_nodes + 1, two per node group, in reverse order
+   to check that the order of get_status2 does not matter */
+ndb_mgm_cluster_state* make_cluster_state(int no_of_nodes);
+
+/* A cluster of data nodes 2 to no_of_nodes + 1, two per node group.
+   A node told to restart goes through recovery, one step each time
+   get_status2 is called, wait_until_ready finishes it at once. One
+   told nostart stays NOT_STARTED until the test starts it. If
+   statuses is set, poll n reports the statuses of statuses[n] instead,
+   the last one once they run out. Sleeps take no time. */
+struct scripted_api_s : ndb_api_s {
+    std::vector<ndb_mgm_node_state> nodes;
+    std::vector<std::pair<ndb_mgm_node_status, int>> recovery{
+        { NDB_MGM_NODE_STATUS_NOT_STARTED, 0 },
+        { NDB_MGM_NODE_STATUS_STARTING, 1 },
+        { NDB_MGM_NODE_STATUS_STARTING, 4 },
+        { NDB_MGM_NODE_STATUS_STARTING, 5 },
+        { NDB_MGM_NODE_STATUS_STARTED, 0 }
+    };
+    std::map<int, size_t> recovering; /* node id, next recovery step */
+    std::vector<std::vector<ndb_mgm_node_status>> statuses;
+    size_t polls = 0;
+    int failed_polls = 0; /* the next get_status2 calls return null */
+    int failed_connects = 0; /* the next connect calls fail */
+    int failed_restarts = 0; /* the next restart4 calls fail */
+    bool abort = false;
+    unsigned connects = 0;
+    unsigned sleeps = 0;
+    unsigned waits = 0; /* wait_until_ready, the call which needs the
+                           data node connection */
+    /* "restart4 3 (5 STARTING 4)" names the nodes which were not
+       STARTED at the last poll, "restart4 nostart 3" */
+    std::vector<std::string> calls;
+    std::function<void(scripted_api_s&)> on_sleep;
+    std::function<void(scripted_api_s&)> on_restart;
+
+    explicit scripted_api_s(int no_of_nodes = 4);
+
+    ndb_mgm_node_state* node(int node_id);
+    /* the nodes which are not STARTED, e.g. " (5 STARTING 4)" */
+    std::string down_nodes();
+
+    int connect(ndb_connection_context_s& ndb_ctx) override;
+    void disconnect(ndb_connection_context_s& ndb_ctx) override;
+    std::string get_system_name(ndb_connection_context_s& ndb_ctx) override;
+    ndb_mgm_cluster_state* get_status2(ndb_connection_context_s& ndb_ctx,
+        const ndb_mgm_node_type node_types[]) override;
+    int restart4(ndb_connection_context_s& ndb_ctx, int cnt,
+        const int* nodes, int initial, int nostart, int abort, int force,
+        int* disconnect) override;
+    int wait_until_ready(ndb_connection_context_s& ndb_ctx, const int* nodes,
+        int cnt, int timeout) override;
+    int dump_state(ndb_connection_context_s& ndb_ctx, int node_id,
+        const int* args, int num_args, ndb_mgm_reply* reply) override;
+    void sleep(ndb_connection_context_s& ndb_ctx,
+        std::chrono::milliseconds duration) override;
+    bool aborted() override;
+};
+
+#endif /* CLUSTER_FIXTURE_HPP */
@@ -0,0 +1,181 @@
+#include <stdlib.h>
+
+#include "cluster_fixture.hpp"
+#include "echeck.h"
+#include "ndb_rolling_restart_replay.hpp"
+#include <string.h>
+#include <unistd.h>
+
+/* with every field set, so the round trip covers them */
+static ndb_mgm_node_state make_starting_node(int node_id, int node_group)
+{
+    ndb_mgm_node_state node = make_node_state(node_id, node_group);
+    node.node_status = NDB_MGM_NODE_STATUS_STARTING;
+    node.start_phase = 5;
+    node.dynamic_id = node_id + 100;
+    node.connect_count = 3;
+    node.mysql_version = 0x00050729;
+    strcpy(node.connect_address, "192.168.100.201");
+    return node;
+}
+
+int test_api_call_round_trip(int verbose)
+{
+    api_call_record_s restart;
+    restart.call = API_CALL_RESTART4;
+    restart.begin_us = 0x123456789ULL;
+    restart.duration_us = 4321;
+    restart.args = { 1, 0, 0, 0, 48, 46, 44 };
+    restart.result = 3;
+    restart.extra = 0;
+    restart.text = "";
+    restart.has_cluster_state = false;
+
+    api_call_record_s status;
+    status.call = API_CALL_GET_STATUS2;
+    status.begin_us = 99;
+    status.duration_us = 17;
+    status.args = { NDB_MGM_NODE_TYPE_NDB };
+    status.result = -1;
+    status.extra = -2;
+    status.text = "ok";
+    status.has_cluster_state = true;
+    status.node_states.push_back(make_starting_node(2, 0));
+    status.node_states.push_back(make_starting_node(3, 1));
+
+    std::string buf;
+    encode_api_call(restart, buf);
+    encode_api_call(status, buf);
+
+    if (verbose) {
+        printf("encoded 2 calls in %lu bytes\n", (unsigned long)buf.size());
+    }
+
+    int failures = 0;
+    size_t pos = 0;
+    api_call_record_s decoded;
+
+    failures += check_int(decode_api_call(buf, pos, decoded), 0);
+    failures += check_int(decoded.call, API_CALL_RESTART4);
+    failures += check_unsigned_long(decoded.begin_us, 0x123456789ULL);
+    failures += check_unsigned_long(decoded.duration_us, 4321);
+    failures += check_size_t(decoded.args.size(), 7);
+    failures += check_int(decoded.args[0], 1);
+    failures += check_int(decoded.args[6], 44);
+    failures += check_int(decoded.result, 3);
+    failures += check_int(decoded.has_cluster_state, 0);
+
+    failures += check_int(decode_api_call(buf, pos, decoded), 0);
+    failures += check_int(decoded.call, API_CALL_GET_STATUS2);
+    failures += check_int(decoded.result, -1);
+    failures += check_int(decoded.extra, -2);
+    failures += check_str(decoded.text.c_str(), "ok");
+    failures += check_int(decoded.has_cluster_state, 1);
+    failures += check_size_t(decoded.node_states.size(), 2);
+    if (failures) {
+        return failures;
+    }
+    const ndb_mgm_node_state& node = decoded.node_states[1];
+    failures += check_int(node.node_id, 3);
+    failures += check_int(node.node_type, NDB_MGM_NODE_TYPE_NDB);
+    failures += check_int(node.node_status, NDB_MGM_NODE_STATUS_STARTING);
+    failures += check_int(node.start_phase, 5);
+    failures += check_int(node.dynamic_id, 103);
+    failures += check_int(node.node_group, 1);
+    failures += check_int(node.version, 0x00070610);
+    failures += check_int(node.connect_count, 3);
+    failures += check_int(node.mysql_version, 0x00050729);
+    failures += check_str(node.connect_address, "192.168.100.201");
+
+    failures += check_size_t(pos, buf.size());
+    return failures;
+}
+
+int test_api_call_truncated(int verbose)
+{
+    api_call_record_s wait;
+    wait.call = API_CALL_WAIT_UNTIL_READY;
+    wait.begin_us = 1;
+    wait.duration_us = 2;
+    wait.args = { 4 };
+    wait.result = 0;
+    wait.extra = 30;
+    wait.has_cluster_state = false;
+
+    std::string buf;
+    encode_api_call(wait, buf);
+
+    int failures = 0;
+    for (size_t len = 0; len < buf.size(); ++len) {
+        std::string truncated = buf.substr(0, len);
+        size_t pos = 0;
+        api_call_record_s decoded;
+        failures += check_int_m(decode_api_call(truncated, pos, decoded), 1,
+            "truncated record should not decode");
+    }
+    if (verbose) {
+        printf("checked %lu truncations\n", (unsigned long)buf.size());
+    }
+    return failures;
+}
+
+/* leaves the reply message unterminated, like a reply which was never
+   filled in */
+struct dump_api_s : scripted_api_s {
+    int dump_state(ndb_connection_context_s& ndb_ctx, int node_id,
+        const int* args, int num_args, ndb_mgm_reply* reply) override
+    {
+        reply->return_code = return_code;
+        memset(reply->message, 'x', sizeof(reply->message));
+        return 0;
+    }
+    int return_code = 0;
+};
+
+int test_api_call_dump_state(int verbose)
+{
+    char path[] = "/tmp/test-api-call-log-XXXXXX";
+    close(mkstemp(path));
+
+    dump_api_s target;
+    ndb_connection_context_s ndb_ctx;
+    int failures = 0;
+    {
+        ndb_record_api_s record(target);
+        failures += check_int(record.open(path), 0);
+        int args[] = { 1000 };
+        ndb_mgm_reply reply;
+        record.dump_state(ndb_ctx, 2, args, 1, &reply);
+        target.return_code = 1;
+        record.dump_state(ndb_ctx, 3, args, 1, &reply);
+    }
+
+    ndb_replay_api_s replay(0);
+    failures += check_int(replay.open(path), 0);
+    unlink(path);
+    failures += check_size_t(replay.records.size(), 2);
+    if (replay.records.size() == 2) {
+        /* only a failed reply carries its message, bounded by the field */
+        failures += check_size_t(replay.records[0].text.size(), 0);
+        failures += check_size_t(replay.records[1].text.size(),
+            sizeof(ndb_mgm_reply().message));
+    }
+    if (verbose) {
+        printf("recorded %lu dump_state calls\n",
+            (unsigned long)replay.records.size());
+    }
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_api_call_round_trip(verbose);
+    failures += test_api_call_truncated(verbose);
+    failures += test_api_call_dump_state(verbose);
+
+    return check_status(failures);
+}
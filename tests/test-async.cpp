@@ -0,0 +1,171 @@
+#include <stdlib.h>
+
+#include "cluster_fixture.hpp"
+#include "echeck.h"
+#include "ndb_rolling_restart_async.hpp"
+#include <atomic>
+#include <future>
+#include <stdio.h>
+
+static int count_events(const std::vector<restart_event_s>& events,
+    restart_event_type_e type)
+{
+    int count = 0;
+    for (const auto& event : events) {
+        if (event.type == type) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+int test_async_poll(int verbose)
+{
+    int failures = 0;
+
+    scripted_api_s api;
+    ndb_connection_context_s plan;
+    plan.api = &api;
+    ndb_rr_handle handle = ndb_rr_submit(plan);
+    failures += check_int(handle != nullptr, 1);
+    if (!handle) {
+        return failures;
+    }
+    failures += check_int(ndb_rr_wait(handle), 0);
+
+    std::vector<restart_event_s> events;
+    failures += check_int(ndb_rr_poll(handle, events), 1);
+    if (verbose) {
+        for (const auto& event : events) {
+            printf("%d %d %s\n", (int)event.type, event.node_id,
+                event.message.c_str());
+        }
+    }
+    failures += check_int(count_events(events, RESTART_EVENT_NODE_BEGIN), 4);
+    failures += check_int(count_events(events, RESTART_EVENT_NODE_DONE), 4);
+    failures += check_int(events.size() > 0
+            && events.back().type == RESTART_EVENT_FINISHED,
+        1);
+
+    /* every event was delivered once */
+    std::vector<restart_event_s> more;
+    failures += check_int(ndb_rr_poll(handle, more), 1);
+    failures += check_size_t(more.size(), 0);
+    ndb_rr_release(handle);
+    return failures;
+}
+
+int test_async_callback(int verbose)
+{
+    int failures = 0;
+
+    scripted_api_s api;
+    ndb_connection_context_s plan;
+    plan.api = &api;
+    std::atomic<int> node_done{ 0 };
+    std::atomic<int> finished{ 0 };
+    ndb_rr_handle handle = ndb_rr_submit(plan,
+        [&node_done, &finished](const restart_event_s& event) {
+            if (event.type == RESTART_EVENT_NODE_DONE) {
+                ++node_done;
+            }
+            if (event.type == RESTART_EVENT_FINISHED) {
+                ++finished;
+            }
+        });
+    failures += check_int(handle != nullptr, 1);
+    if (!handle) {
+        return failures;
+    }
+    failures += check_int(ndb_rr_wait(handle), 0);
+    failures += check_int(node_done.load(), 4);
+    failures += check_int(finished.load(), 1);
+
+    /* the callback got the events, none are queued */
+    std::vector<restart_event_s> events;
+    failures += check_int(ndb_rr_poll(handle, events), 1);
+    failures += check_size_t(events.size(), 0);
+    ndb_rr_release(handle);
+    if (verbose) {
+        printf("%d nodes done\n", node_done.load());
+    }
+    return failures;
+}
+
+int test_async_control(int verbose)
+{
+    int failures = 0;
+
+    /* paused after the first restart, resumed after three sleeps */
+    scripted_api_s paused;
+    std::promise<ndb_rr_handle> paused_promise;
+    std::shared_future<ndb_rr_handle> paused_handle
+        = paused_promise.get_future().share();
+    size_t calls_while_paused = 0;
+    paused.on_restart = [&paused_handle](scripted_api_s& api) {
+        if (api.calls.size() == 1) {
+            ndb_rr_pause(paused_handle.get());
+            api.sleeps = 0;
+        }
+    };
+    paused.on_sleep = [&paused_handle, &calls_while_paused](
+                          scripted_api_s& api) {
+        if (api.sleeps == 3 && api.calls.size() == 1) {
+            calls_while_paused = api.calls.size();
+            ndb_rr_resume(paused_handle.get());
+        }
+    };
+    ndb_connection_context_s paused_plan;
+    paused_plan.api = &paused;
+    ndb_rr_handle handle = ndb_rr_submit(paused_plan);
+    paused_promise.set_value(handle);
+    failures += check_int(handle != nullptr, 1);
+    if (handle) {
+        failures += check_int(ndb_rr_wait(handle), 0);
+        ndb_rr_release(handle);
+    }
+    failures += check_size_t(calls_while_paused, 1);
+    failures += check_size_t(paused.calls.size(), 4);
+
+    /* cancelled after the second restart */
+    scripted_api_s cancelled;
+    std::promise<ndb_rr_handle> cancelled_promise;
+    std::shared_future<ndb_rr_handle> cancelled_handle
+        = cancelled_promise.get_future().share();
+    cancelled.on_restart = [&cancelled_handle](scripted_api_s& api) {
+        if (api.calls.size() == 2) {
+            ndb_rr_cancel(cancelled_handle.get());
+        }
+    };
+    ndb_connection_context_s cancelled_plan;
+    cancelled_plan.api = &cancelled;
+    handle = ndb_rr_submit(cancelled_plan);
+    cancelled_promise.set_value(handle);
+    failures += check_int(handle != nullptr, 1);
+    if (handle) {
+        failures += check_int(ndb_rr_wait(handle), 1);
+        ndb_rr_release(handle);
+    }
+    failures += check_size_t(cancelled.calls.size(), 2);
+    if (verbose) {
+        printf("%lu of 4 restarted before the cancel\n",
+            (unsigned long)cancelled.calls.size());
+    }
+
+    /* a null handle is released without harm */
+    ndb_rr_release(nullptr);
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_async_poll(verbose);
+    failures += test_async_callback(verbose);
+    failures += test_async_control(verbose);
+
+    return check_status(failures);
+}
@@ -0,0 +1,76 @@
+#include <stdlib.h>
+
+#include "cluster_fixture.hpp"
+#include "echeck.h"
+#include "ndb_rolling_restart_snapshot.hpp"
+#include <string.h>
+
+int test_snapshot_changes(int verbose)
+{
+    int failures = 0;
+    cluster_snapshot_s snapshot;
+
+    ndb_mgm_cluster_state* cluster_state = make_cluster_state(4);
+    failures += check_size_t(update_cluster_snapshot(snapshot, cluster_state),
+        4);
+    failures += check_int(snapshot.changes[0].changes, NODE_CHANGE_ADDED);
+    failures += check_int(snapshot.nodes[0].node_id, 2);
+    failures += check_int(snapshot.nodes[3].node_id, 5);
+
+    failures += check_size_t(update_cluster_snapshot(snapshot, cluster_state),
+        0);
+
+    /* node 3 */
+    cluster_state->node_states[2].node_status = NDB_MGM_NODE_STATUS_STARTING;
+    cluster_state->node_states[2].start_phase = 4;
+    failures += check_size_t(update_cluster_snapshot(snapshot, cluster_state),
+        1);
+    const node_change_s& change = snapshot.changes[0];
+    failures += check_int(change.changes,
+        NODE_CHANGE_STATUS | NODE_CHANGE_START_PHASE);
+    failures += check_int(change.before.node_id, 3);
+    failures += check_int(change.after.start_phase, 4);
+    if (verbose) {
+        printf("%s\n", describe_node_change(change).c_str());
+    }
+
+    cluster_state->node_states[2].node_status = NDB_MGM_NODE_STATUS_STARTED;
+    cluster_state->node_states[2].start_phase = 0;
+    cluster_state->node_states[2].connect_count = 2;
+    cluster_state->node_states[2].version = 0x00070611;
+    failures += check_size_t(update_cluster_snapshot(snapshot, cluster_state),
+        1);
+    failures += check_int(snapshot.changes[0].changes,
+        NODE_CHANGE_STATUS | NODE_CHANGE_START_PHASE
+            | NODE_CHANGE_CONNECT_COUNT | NODE_CHANGE_VERSION);
+    if (verbose) {
+        printf("%s\n", describe_node_change(snapshot.changes[0]).c_str());
+    }
+
+    /* node 5 goes away */
+    ndb_mgm_cluster_state* smaller = make_cluster_state(3);
+    memcpy(smaller->node_states, cluster_state->node_states + 1,
+        3 * sizeof(ndb_mgm_node_state));
+    failures += check_size_t(update_cluster_snapshot(snapshot, smaller), 1);
+    failures += check_int(snapshot.changes[0].changes, NODE_CHANGE_REMOVED);
+    failures += check_int(snapshot.changes[0].before.node_id, 5);
+    failures += check_str(describe_node_change(snapshot.changes[0]).c_str(),
+        "node 5: disappeared");
+
+    failures += check_unsigned_long(snapshot.samples, 5);
+
+    free(smaller);
+    free(cluster_state);
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_snapshot_changes(verbose);
+
+    return check_status(failures);
+}
@@ -0,0 +1,144 @@
+#include <stdlib.h>
+
+#include "echeck.h"
+#include "ndb_rolling_restart_copy_progress.hpp"
+#include <stdio.h>
+#include <string.h>
+
+static copy_time_t at_ms(copy_time_t zero, long ms)
+{
+    return zero + std::chrono::milliseconds(ms);
+}
+
+static ndb_logevent copy_event(Ndb_logevent_type type, unsigned node_id)
+{
+    ndb_logevent event;
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    switch (type) {
+    case NDB_LE_NR_CopyFragsStarted:
+        event.NR_CopyFragsStarted.dest_node = node_id;
+        break;
+    case NDB_LE_NR_CopyFragDone:
+        event.NR_CopyFragDone.dest_node = node_id;
+        break;
+    case NDB_LE_NR_CopyFragsCompleted:
+        event.NR_CopyFragsCompleted.dest_node = node_id;
+        break;
+    default:
+        break;
+    }
+    return event;
+}
+
+/* node_id copies fragments at one per ms_per_fragment from begin_ms */
+static void copy_fragments(ndb_copy_monitor_s& monitor, unsigned node_id,
+    copy_time_t zero, long begin_ms, unsigned fragments,
+    long ms_per_fragment, bool complete)
+{
+    copy_monitor_event(monitor,
+        copy_event(NDB_LE_NR_CopyFragsStarted, node_id),
+        at_ms(zero, begin_ms));
+    for (unsigned i = 1; i <= fragments; ++i) {
+        copy_monitor_event(monitor,
+            copy_event(NDB_LE_NR_CopyFragDone, node_id),
+            at_ms(zero, begin_ms + i * ms_per_fragment));
+    }
+    if (complete) {
+        copy_monitor_event(monitor,
+            copy_event(NDB_LE_NR_CopyFragsCompleted, node_id),
+            at_ms(zero, begin_ms + fragments * ms_per_fragment));
+    }
+}
+
+int test_first_copy(int verbose)
+{
+    int failures = 0;
+
+    ndb_copy_monitor_s monitor;
+    copy_time_t zero = std::chrono::steady_clock::now();
+
+    copy_estimate_s none = copy_monitor_estimate(monitor, 3, zero);
+    failures += check_int(none.started, 0);
+    failures += check_str(format_copy_estimate(none).c_str(), "");
+
+    /* with nothing to compare to there is no estimate */
+    copy_fragments(monitor, 3, zero, 0, 10, 500, false);
+    copy_estimate_s estimate = copy_monitor_estimate(monitor, 3,
+        at_ms(zero, 5000));
+    failures += check_int(estimate.started, 1);
+    failures += check_int(estimate.completed, 0);
+    failures += check_unsigned_long(estimate.fragments, 10);
+    failures += check_int((int)(estimate.fragments_per_second * 10), 20);
+    failures += check_int(estimate.eta_seconds < 0, 1);
+    failures += check_int(estimate.slow, 0);
+    failures += check_str(format_copy_estimate(estimate).c_str(),
+        "copied 10 fragments in 5.0s (2.0/s)");
+
+    /* not a copy event */
+    ndb_logevent other = copy_event(NDB_LE_NR_CopyDict, 3);
+    copy_monitor_event(monitor, other, at_ms(zero, 5000));
+    failures += check_size_t(monitor.nodes.size(), 1);
+    return failures;
+}
+
+int test_estimate(int verbose)
+{
+    int failures = 0;
+
+    ndb_copy_monitor_s monitor;
+    copy_time_t zero = std::chrono::steady_clock::now();
+
+    /* two earlier nodes copied 20 fragments at 4 per second */
+    copy_fragments(monitor, 2, zero, 0, 20, 250, true);
+    copy_fragments(monitor, 4, zero, 0, 20, 250, true);
+    failures += check_size_t(monitor.completed.size(), 2);
+
+    copy_estimate_s done = copy_monitor_estimate(monitor, 2,
+        at_ms(zero, 60000));
+    failures += check_int(done.completed, 1);
+    failures += check_int((int)(done.seconds * 10), 50);
+    failures += check_str(format_copy_estimate(done).c_str(),
+        "copied 20 fragments in 5.0s (4.0/s)");
+
+    /* at the usual rate, 15 fragments left */
+    copy_fragments(monitor, 3, zero, 10000, 5, 250, false);
+    copy_estimate_s estimate = copy_monitor_estimate(monitor, 3,
+        at_ms(zero, 11250));
+    failures += check_int(estimate.slow, 0);
+    failures += check_int((int)(estimate.eta_seconds * 100), 375);
+    failures += check_str(format_copy_estimate(estimate).c_str(),
+        "copied 5 fragments in 1.2s (4.0/s), about 3.8s left");
+
+    /* a quarter of the usual rate */
+    copy_fragments(monitor, 5, zero, 10000, 5, 1000, false);
+    estimate = copy_monitor_estimate(monitor, 5, at_ms(zero, 15000));
+    if (verbose) {
+        printf("%s\n", format_copy_estimate(estimate).c_str());
+    }
+    failures += check_int(estimate.slow, 1);
+    failures += check_int((int)estimate.eta_seconds, 15);
+    failures += check_str(format_copy_estimate(estimate).c_str(),
+        "copied 5 fragments in 5.0s (1.0/s), about 15.0s left,"
+        " slow: usually 4.0/s");
+
+    /* restarted again, the copy starts over */
+    copy_monitor_event(monitor,
+        copy_event(NDB_LE_NR_CopyFragsStarted, 5), at_ms(zero, 20000));
+    estimate = copy_monitor_estimate(monitor, 5, at_ms(zero, 20000));
+    failures += check_unsigned_long(estimate.fragments, 0);
+    failures += check_int(estimate.slow, 0);
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_first_copy(verbose);
+    failures += test_estimate(verbose);
+
+    return check_status(failures);
+}
@@ -0,0 +1,111 @@
+#include <stdlib.h>
+
+#include "cluster_fixture.hpp"
+#include "echeck.h"
+#include "ndb_rolling_restart_dry_run.hpp"
+#include "ndb_rolling_restart_epochs.hpp"
+#include <stdio.h>
+#include <unistd.h>
+
+static schedule_node_s make_node(int node_id, int node_group,
+    const char* host)
+{
+    return schedule_node_s{ node_id, node_group, host, true, true, 0.0 };
+}
+
+int test_expected_seconds(int verbose)
+{
+    int failures = 0;
+
+    std::vector<schedule_node_s> nodes{ make_node(2, 0, "a"),
+        make_node(3, 0, "b"), make_node(4, 1, "a"), make_node(5, 1, "b") };
+
+    failures += check_size_t(set_expected_seconds(nodes,
+                                 std::map<std::string, uint64_t>()),
+        0);
+    failures += check_int(nodes[0].expected_seconds == 0.0, 1);
+
+    std::map<std::string, uint64_t> baseline{ { "node_p50_ms", 40000 },
+        { "restart_node_3_ms", 90000 }, { "restart_node_5_ms", 30000 } };
+    failures += check_size_t(set_expected_seconds(nodes, baseline), 4);
+    failures += check_int((int)nodes[0].expected_seconds, 40);
+    failures += check_int((int)nodes[1].expected_seconds, 90);
+    failures += check_int((int)nodes[3].expected_seconds, 30);
+    return failures;
+}
+
+int test_timeline(int verbose)
+{
+    int failures = 0;
+
+    std::vector<schedule_node_s> nodes{ make_node(2, 0, "a"),
+        make_node(3, 0, "b"), make_node(4, 1, "a"), make_node(5, 1, "b") };
+    nodes[1].expected_seconds = 90;
+    nodes[3].expected_seconds = 30;
+
+    auto waves = find_schedule_policy("round_robin")->plan(nodes);
+    auto estimate = simulate_schedule(nodes, waves, true,
+        DRY_RUN_HOST_CONTENTION, DRY_RUN_DEFAULT_SECONDS);
+    auto timeline = dry_run_timeline(waves, estimate);
+    if (verbose) {
+        for (size_t w = 0; w < timeline.size(); ++w) {
+            printf("%s\n", format_dry_run_wave(w + 1, timeline[w]).c_str());
+        }
+    }
+    failures += check_size_t(timeline.size(), 2);
+    /* the nodes of each wave share a host, which slows them down */
+    failures += check_str(format_dry_run_wave(1, timeline[0]).c_str(),
+        "wave 1 +0.0s to +135.0s: node 3 5");
+    failures += check_str(format_dry_run_wave(2, timeline[1]).c_str(),
+        "wave 2 +135.0s to +225.0s: node 2 4");
+    failures += check_int((int)timeline.back().end_seconds,
+        (int)estimate.makespan_seconds);
+
+    estimate = simulate_schedule(nodes, waves, false,
+        DRY_RUN_HOST_CONTENTION, DRY_RUN_DEFAULT_SECONDS);
+    timeline = dry_run_timeline(waves, estimate);
+    failures += check_str(format_dry_run_wave(2, timeline[1]).c_str(),
+        "wave 2 +120.0s to +240.0s: node 2 4");
+    return failures;
+}
+
+int test_dry_run_writes_nothing(int verbose)
+{
+    int failures = 0;
+
+    char path[] = "/tmp/test-dry-run-XXXXXX";
+    close(mkstemp(path));
+    unlink(path);
+
+    scripted_api_s api;
+    restart_epochs_s epochs;
+    epochs.path = path;
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    ndb_ctx.epochs = &epochs;
+    if (verbose) {
+        ndb_ctx.on_event = [](const restart_event_s& event) {
+            printf("%s\n", event.message.c_str());
+        };
+    }
+    failures += check_int(ndb_rolling_restart_dry_run(ndb_ctx, ""), 0);
+    failures += check_size_t(api.calls.size(), 0);
+    failures += check_int(access(path, F_OK), -1);
+    failures += check_int(ndb_ctx.epochs == &epochs, 1);
+    failures += check_size_t(epochs.nodes.size(), 0);
+    unlink(path);
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_expected_seconds(verbose);
+    failures += test_timeline(verbose);
+    failures += test_dry_run_writes_nothing(verbose);
+
+    return check_status(failures);
+}
@@ -0,0 +1,160 @@
+#include <stdlib.h>
+
+#include "cluster_fixture.hpp"
+#include "echeck.h"
+#include "ndb_rolling_restart_api.hpp"
+#include "ndb_rolling_restart_executor.hpp"
+#include <atomic>
+#include <set>
+#include <stdio.h>
+#include <string.h>
+
+/* answers dump_state after a delay, counts the connections */
+struct counting_api_s : ndb_api_s {
+    std::atomic<int> connects{ 0 };
+    std::atomic<int> open{ 0 };
+    std::atomic<int> max_open{ 0 };
+    std::atomic<int> dumps{ 0 };
+    std::mutex lock;
+    std::set<NdbMgmHandle> handles;
+    long handle_count = 0;
+
+    int connect(ndb_connection_context_s& ndb_ctx) override
+    {
+        ++connects;
+        int now_open = ++open;
+        int seen = max_open;
+        while (now_open > seen && !max_open.compare_exchange_weak(seen,
+                                      now_open)) {
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        ndb_ctx.ndb_mgm_handle = (NdbMgmHandle)(++handle_count);
+        return 0;
+    }
+    void disconnect(ndb_connection_context_s& ndb_ctx) override
+    {
+        --open;
+        ndb_ctx.ndb_mgm_handle = nullptr;
+    }
+    std::string get_system_name(ndb_connection_context_s& ndb_ctx) override
+    {
+        return "counting";
+    }
+    ndb_mgm_cluster_state* get_status2(ndb_connection_context_s& ndb_ctx,
+        const ndb_mgm_node_type node_types[]) override
+    {
+        return nullptr;
+    }
+    int restart4(ndb_connection_context_s& ndb_ctx, int cnt,
+        const int* nodes, int initial, int nostart, int abort, int force,
+        int* disconnect) override
+    {
+        return -1;
+    }
+    int wait_until_ready(ndb_connection_context_s& ndb_ctx, const int* nodes,
+        int cnt, int timeout) override
+    {
+        return -1;
+    }
+    int dump_state(ndb_connection_context_s& ndb_ctx, int node_id,
+        const int* args, int num_args, ndb_mgm_reply* reply) override
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ++dumps;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            handles.insert(ndb_ctx.ndb_mgm_handle);
+        }
+        reply->return_code = 0;
+        return 0;
+    }
+    void sleep(ndb_connection_context_s& ndb_ctx,
+        std::chrono::milliseconds duration) override
+    {
+    }
+};
+
+static std::chrono::milliseconds dump_all(ndb_executor_s* executor,
+    ndb_connection_context_s& ndb_ctx, const std::vector<int>& node_ids,
+    int* oks)
+{
+    std::mutex lock;
+    auto begin = std::chrono::steady_clock::now();
+    executor_for_each_node(executor, ndb_ctx, node_ids,
+        [&](ndb_connection_context_s& node_ctx, int node_id,
+            int connect_err) {
+            std::string dump_state = connect_err
+                ? "could not connect"
+                : get_ndb_mgm_dump_state(node_ctx, make_node_state(node_id, 0));
+            std::lock_guard<std::mutex> guard(lock);
+            *oks += dump_state == "ok";
+        });
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - begin);
+}
+
+int test_executor(int verbose)
+{
+    int failures = 0;
+
+    counting_api_s api;
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    api.connect(ndb_ctx);
+
+    /* all node ids map to worker 0, the others have to steal */
+    std::vector<int> node_ids{ 4, 8, 12, 16, 20, 24, 28, 32 };
+
+    int oks = 0;
+    auto serial = dump_all(nullptr, ndb_ctx, node_ids, &oks);
+    failures += check_int(oks, 8);
+    failures += check_int(api.connects, 1);
+
+    ndb_executor_s executor;
+    failures += check_int(executor_start(executor, ndb_ctx, 4), 0);
+    failures += check_size_t(executor.workers.size(), 4);
+    /* the workers connect with their first job */
+    failures += check_int(api.connects, 1);
+
+    oks = 0;
+    auto pooled = dump_all(&executor, ndb_ctx, node_ids, &oks);
+    failures += check_int(oks, 8);
+    failures += check_int(api.dumps, 16);
+    failures += check_int(api.connects <= 1 + 4, 1);
+    failures += check_int(api.max_open <= 1 + 4, 1);
+    failures += check_int(executor.steals > 0, 1);
+    /* the orchestrator's handle was not used by the workers */
+    failures += check_int(api.handles.size() > 1, 1);
+    failures += check_int(pooled < serial, 1);
+
+    if (verbose) {
+        printf("serial %ld ms, 4 workers %ld ms, %d connections, %lu steals\n",
+            (long)serial.count(), (long)pooled.count(), (int)api.connects,
+            executor.steals);
+    }
+
+    executor_stop(executor);
+    failures += check_int(api.open, 1);
+    failures += check_size_t(executor.workers.size(), 0);
+
+    ndb_executor_s capped;
+    failures += check_int(executor_start(capped, ndb_ctx, 1000), 0);
+    failures += check_size_t(capped.workers.size(), EXECUTOR_MAX_WORKERS);
+    executor_stop(capped);
+
+    failures += check_int(executor_start(capped, ndb_ctx, 0), 1);
+
+    api.disconnect(ndb_ctx);
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_executor(verbose);
+
+    return check_status(failures);
+}
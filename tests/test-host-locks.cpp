@@ -0,0 +1,134 @@
+#include <stdlib.h>
+
+#include "echeck.h"
+#include "ndb_rolling_restart_host_locks.hpp"
+#include <stdio.h>
+#include <unistd.h>
+
+static void remove_locks(const ndb_host_locks_s& locks, const char* host)
+{
+    for (unsigned slot = 0; slot < locks.slots_per_host; ++slot) {
+        unlink(host_lock_path(locks, host, slot).c_str());
+    }
+}
+
+int test_lock_path(int verbose)
+{
+    int failures = 0;
+
+    ndb_host_locks_s locks;
+    locks.dir = "/var/lock/ndb";
+    failures += check_str(host_lock_path(locks, "10.0.0.1", 0).c_str(),
+        "/var/lock/ndb/10.0.0.1.0.lock");
+    failures += check_str(host_lock_path(locks, "fe80::1/x", 2).c_str(),
+        "/var/lock/ndb/fe80__1_x.2.lock");
+    return failures;
+}
+
+int test_two_clusters(int verbose)
+{
+    int failures = 0;
+
+    char dir[] = "/tmp/test-host-locks-XXXXXX";
+    if (!mkdtemp(dir)) {
+        return 1;
+    }
+
+    /* two orchestrators, the flock of one open file blocks the other */
+    ndb_host_locks_s cluster_a;
+    cluster_a.dir = dir;
+    cluster_a.slots_per_host = 2;
+    ndb_host_locks_s cluster_b;
+    cluster_b.dir = dir;
+    cluster_b.slots_per_host = 2;
+
+    std::string busy;
+    failures += check_int(host_locks_acquire(cluster_a, { { 2, "h1" } }, "a",
+                              busy),
+        0);
+    failures += check_int(host_locks_acquire(cluster_b, { { 12, "h1" } }, "b",
+                              busy),
+        0);
+
+    /* h1 is full, so nothing is taken, h2 stays free */
+    busy = "";
+    failures += check_int(host_locks_acquire(cluster_b,
+                              { { 13, "h2" }, { 14, "h1" } }, "b", busy),
+        1);
+    failures += check_str(busy.c_str(), "h1");
+    failures += check_size_t(cluster_b.held.size(), 1);
+    failures += check_int(host_locks_acquire(cluster_a, { { 3, "h2" } }, "a",
+                              busy),
+        0);
+
+    host_locks_release(cluster_a, 2);
+    failures += check_int(host_locks_acquire(cluster_b,
+                              { { 13, "h2" }, { 14, "h1" } }, "b", busy),
+        0);
+    failures += check_size_t(cluster_b.held.size(), 3);
+
+    /* the slots of its own orchestrator count as well */
+    busy = "";
+    failures += check_int(host_locks_acquire(cluster_b, { { 15, "h1" } }, "b",
+                              busy),
+        1);
+    failures += check_str(busy.c_str(), "h1");
+    failures += check_size_t(cluster_b.held.count(15), 0);
+    failures += check_int(host_locks_acquire(cluster_a, { { 4, "h1" } }, "a",
+                              busy),
+        1);
+
+    host_locks_release(cluster_b, 14);
+    failures += check_int(host_locks_acquire(cluster_a, { { 4, "h1" } }, "a",
+                              busy),
+        0);
+
+    remove_locks(cluster_a, "h1");
+    remove_locks(cluster_a, "h2");
+    rmdir(dir);
+    return failures;
+}
+
+int test_released_on_destruction(int verbose)
+{
+    int failures = 0;
+
+    char dir[] = "/tmp/test-host-locks-XXXXXX";
+    if (!mkdtemp(dir)) {
+        return 1;
+    }
+
+    ndb_host_locks_s cluster_b;
+    cluster_b.dir = dir;
+    std::string busy;
+    {
+        ndb_host_locks_s cluster_a;
+        cluster_a.dir = dir;
+        failures += check_int(host_locks_acquire(cluster_a, { { 2, "h1" } },
+                                  "a", busy),
+            0);
+        failures += check_int(host_locks_acquire(cluster_b, { { 12, "h1" } },
+                                  "b", busy),
+            1);
+    }
+    failures += check_int(host_locks_acquire(cluster_b, { { 12, "h1" } }, "b",
+                              busy),
+        0);
+
+    remove_locks(cluster_b, "h1");
+    rmdir(dir);
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_lock_path(verbose);
+    failures += test_two_clusters(verbose);
+    failures += test_released_on_destruction(verbose);
+
+    return check_status(failures);
+}
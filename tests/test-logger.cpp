@@ -0,0 +1,140 @@
+#include <stdlib.h>
+
+#include "echeck.h"
+#include "ndb_rolling_restart_logger.hpp"
+#include <sstream>
+#include <string.h>
+
+int test_format_log_record(int verbose)
+{
+    int failures = 0;
+
+    log_record_s record;
+    record.timestamp_us = 1500000;
+    record.event = restart_event_s{ RESTART_EVENT_LOG, 3, 2, 0,
+        "node 3: \"STARTING\"\n\tstart_phase 4" };
+
+    std::ostringstream text;
+    format_log_record(record, LOG_FORMAT_TEXT, text);
+    failures += check_str(text.str().c_str(),
+        "[   1.500000] [wave 2] node 3: \"STARTING\"\n\tstart_phase 4\n");
+
+    std::ostringstream json;
+    format_log_record(record, LOG_FORMAT_JSON, json);
+    failures += check_str(json.str().c_str(),
+        "{\"ts_us\":1500000,\"type\":\"log\",\"wave\":2,\"node\":3,"
+        "\"value\":0,\"message\":"
+        "\"node 3: \\\"STARTING\\\"\\n\\tstart_phase 4\"}\n");
+
+    record.event.type = RESTART_EVENT_NODE_PHASE;
+    std::ostringstream quiet;
+    format_log_record(record, LOG_FORMAT_TEXT, quiet);
+    failures += check_str(quiet.str().c_str(), "");
+
+    if (verbose) {
+        printf("%s%s", text.str().c_str(), json.str().c_str());
+    }
+    return failures;
+}
+
+static void log_many(ndb_logger_s* logger, int thread_id, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        log_restart_event(*logger,
+            restart_event_s{ RESTART_EVENT_NODE_PHASE, thread_id, 0, i, "" });
+    }
+}
+
+int test_logger_threads(int verbose)
+{
+    const int threads = 4;
+    const int count = 1000;
+    int failures = 0;
+
+    std::ostringstream out;
+    ndb_logger_s logger;
+    failures += check_int(start_logger(logger, LOG_FORMAT_JSON, out, out), 0);
+
+    std::vector<std::thread> producers;
+    for (int t = 1; t <= threads; ++t) {
+        producers.emplace_back(log_many, &logger, t, count);
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    stop_logger(logger);
+
+    /* every record arrives once, in order for each thread */
+    std::vector<long long> next(threads + 1, 0);
+    std::istringstream in(out.str());
+    std::string line;
+    int lines = 0;
+    while (std::getline(in, line)) {
+        int node = 0;
+        long long value = 0;
+        const char* node_pos = strstr(line.c_str(), "\"node\":");
+        const char* value_pos = strstr(line.c_str(), "\"value\":");
+        if (!node_pos || !value_pos) {
+            failures += check_str(line.c_str(), "a node_phase record");
+            continue;
+        }
+        node = atoi(node_pos + strlen("\"node\":"));
+        value = atoll(value_pos + strlen("\"value\":"));
+        failures += check_long(value, next[node]);
+        next[node] = value + 1;
+        ++lines;
+    }
+    failures += check_int(lines, threads * count);
+    failures += check_unsigned_long(logger.dropped.load(), 0);
+
+    if (verbose) {
+        printf("%d records from %d threads\n", lines, threads);
+    }
+    return failures;
+}
+
+int test_logger_full_ring(int verbose)
+{
+    int failures = 0;
+
+    std::ostringstream out;
+    ndb_logger_s logger;
+    logger.ring_capacity = 8;
+    logger.flush_interval_ms = 1000;
+    failures += check_int(start_logger(logger, LOG_FORMAT_JSON, out, out), 0);
+    log_many(&logger, 1, 100);
+    stop_logger(logger);
+
+    int records = 0;
+    int dropped_reports = 0;
+    std::istringstream in(out.str());
+    std::string line;
+    while (std::getline(in, line)) {
+        if (strstr(line.c_str(), "\"type\":\"error\"")) {
+            ++dropped_reports;
+        } else {
+            ++records;
+        }
+    }
+    failures += check_int(dropped_reports, 1);
+    failures += check_unsigned_long(records + logger.dropped.load(), 100);
+
+    if (verbose) {
+        printf("%d records written, %lu dropped\n", records,
+            logger.dropped.load());
+    }
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_format_log_record(verbose);
+    failures += test_logger_threads(verbose);
+    failures += test_logger_full_ring(verbose);
+
+    return check_status(failures);
+}
@@ -0,0 +1,137 @@
+#include <stdlib.h>
+
+#include "cluster_fixture.hpp"
+#include "echeck.h"
+#include "ndb_rolling_restart_metrics.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <unistd.h>
+
+#define P "ndb_rolling_restart_"
+
+int test_format_metrics(int verbose)
+{
+    int failures = 0;
+
+    ndb_metrics_s metrics;
+    metrics_plan(&metrics, 4, 2);
+    metrics_wave_begin(&metrics, 1);
+    metrics_nodes_begin(&metrics, 2);
+    metrics_node_done(&metrics, 45000);
+    metrics_node_done(&metrics, 20000);
+    metrics_nodes_begin(&metrics, 1);
+    metrics_count(&metrics, METRICS_RECONNECTS);
+    metrics_count(&metrics, METRICS_RECONNECTS);
+
+    std::vector<ndb_mgm_node_state> nodes{ make_node_state(2, 0),
+        make_node_state(3, 0), make_node_state(4, 1), make_node_state(5, 1) };
+    nodes[3].node_status = NDB_MGM_NODE_STATUS_STARTING;
+    ndb_mgm_cluster_state* cluster_state = make_cluster_state(nodes);
+    metrics_update_live_replicas(&metrics, cluster_state);
+    free(cluster_state);
+
+    /* a null metrics is ignored */
+    metrics_nodes_begin(nullptr, 1);
+    metrics_count(nullptr, METRICS_RECONNECTS);
+
+    std::ostringstream out;
+    format_metrics(metrics, out);
+    if (verbose) {
+        printf("%s", out.str().c_str());
+    }
+    failures += check_str(out.str().c_str(),
+        "# HELP " P "nodes_pending Nodes not yet restarted.\n"
+        "# TYPE " P "nodes_pending gauge\n" P "nodes_pending 1\n"
+        "# HELP " P "nodes_in_flight Nodes currently restarting.\n"
+        "# TYPE " P "nodes_in_flight gauge\n" P "nodes_in_flight 1\n"
+        "# HELP " P "nodes_done Nodes restarted.\n"
+        "# TYPE " P "nodes_done gauge\n" P "nodes_done 2\n"
+        "# HELP " P "current_wave Restart wave in progress.\n"
+        "# TYPE " P "current_wave gauge\n" P "current_wave 1\n"
+        "# HELP " P "waves_total Restart waves planned.\n"
+        "# TYPE " P "waves_total gauge\n" P "waves_total 2\n"
+        "# HELP " P "node_group_live_replicas"
+        " Started data nodes per node group.\n"
+        "# TYPE " P "node_group_live_replicas gauge\n"
+        P "node_group_live_replicas{node_group=\"0\"} 2\n"
+        P "node_group_live_replicas{node_group=\"1\"} 1\n"
+        "# HELP " P "node_restart_duration_seconds"
+        " Time from ndb_mgm_restart4 until the node is started.\n"
+        "# TYPE " P "node_restart_duration_seconds histogram\n"
+        P "node_restart_duration_seconds_bucket{le=\"30\"} 1\n"
+        P "node_restart_duration_seconds_bucket{le=\"60\"} 2\n"
+        P "node_restart_duration_seconds_bucket{le=\"120\"} 2\n"
+        P "node_restart_duration_seconds_bucket{le=\"300\"} 2\n"
+        P "node_restart_duration_seconds_bucket{le=\"600\"} 2\n"
+        P "node_restart_duration_seconds_bucket{le=\"1200\"} 2\n"
+        P "node_restart_duration_seconds_bucket{le=\"1800\"} 2\n"
+        P "node_restart_duration_seconds_bucket{le=\"3600\"} 2\n"
+        P "node_restart_duration_seconds_bucket{le=\"7200\"} 2\n"
+        P "node_restart_duration_seconds_bucket{le=\"14400\"} 2\n"
+        P "node_restart_duration_seconds_bucket{le=\"+Inf\"} 2\n"
+        P "node_restart_duration_seconds_sum 65\n"
+        P "node_restart_duration_seconds_count 2\n"
+        "# TYPE " P "restart_retries_total counter\n"
+        P "restart_retries_total 0\n"
+        "# TYPE " P "wait_retries_total counter\n"
+        P "wait_retries_total 0\n"
+        "# TYPE " P "reconnects_total counter\n"
+        P "reconnects_total 2\n");
+    return failures;
+}
+
+int test_metrics_file(int verbose)
+{
+    int failures = 0;
+
+    char path[] = "/tmp/test-metrics-XXXXXX";
+    close(mkstemp(path));
+
+    /* a whole restart leaves nothing pending or in flight */
+    scripted_api_s api;
+    ndb_metrics_s metrics;
+    metrics.path = path;
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    ndb_ctx.metrics = &metrics;
+    failures += check_int(ndb_rolling_restart(ndb_ctx), 0);
+    failures += check_unsigned_int_m(metrics.nodes_pending.load(), 0,
+        "nodes_pending");
+    failures += check_unsigned_int_m(metrics.nodes_in_flight.load(), 0,
+        "nodes_in_flight");
+    failures += check_unsigned_int_m(metrics.nodes_done.load(), 4,
+        "nodes_done");
+    failures += check_unsigned_int_m(metrics.waves_total.load(), 2,
+        "waves_total");
+
+    failures += check_int(write_metrics_file(metrics), 0);
+    std::ifstream in(path);
+    std::stringstream written;
+    written << in.rdbuf();
+    std::ostringstream formatted;
+    format_metrics(metrics, formatted);
+    failures += check_str(written.str().c_str(), formatted.str().c_str());
+    failures += check_int(access((std::string(path) + ".tmp").c_str(), F_OK),
+        -1);
+    if (verbose) {
+        printf("%s", written.str().c_str());
+    }
+    unlink(path);
+
+    metrics.path = "/nonexistent/metrics";
+    failures += check_int(write_metrics_file(metrics), 1);
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_format_metrics(verbose);
+    failures += test_metrics_file(verbose);
+
+    return check_status(failures);
+}
@@ -0,0 +1,89 @@
+#include <stdlib.h>
+
+#include "cluster_fixture.hpp"
+#include "echeck.h"
+#include "ndb_rolling_restart_select.hpp"
+#include <stdio.h>
+#include <string.h>
+
+static ndb_mgm_node_state make_host_node(int node_id, int node_group,
+    const char* address, ndb_mgm_node_status node_status)
+{
+    ndb_mgm_node_state node = make_node_state(node_id, node_group);
+    node.node_status = node_status;
+    strcpy(node.connect_address, address);
+    return node;
+}
+
+static std::string selected_ids(const char* spec)
+{
+    node_selection_s selection;
+    std::string error;
+    if (parse_node_selection(spec, selection, error)) {
+        return "error: " + error;
+    }
+
+    ndb_mgm_node_state nodes[] = {
+        make_host_node(2, 0, "10.0.0.1", NDB_MGM_NODE_STATUS_STARTED),
+        make_host_node(3, 0, "10.0.1.1", NDB_MGM_NODE_STATUS_STARTED),
+        make_host_node(4, 1, "10.0.0.2", NDB_MGM_NODE_STATUS_STARTED),
+        make_host_node(5, 1, "10.0.1.2", NDB_MGM_NODE_STATUS_NOT_STARTED),
+        make_host_node(10, 2, "10.0.0.3", NDB_MGM_NODE_STATUS_STARTED),
+        make_host_node(11, 2, "10.0.1.3", NDB_MGM_NODE_STATUS_STARTING)
+    };
+
+    std::string ids;
+    for (const auto& node : nodes) {
+        if (node_selected(selection, node)) {
+            ids += (ids.empty() ? "" : " ") + std::to_string(node.node_id);
+        }
+    }
+    return ids;
+}
+
+int test_node_selection(int verbose)
+{
+    int failures = 0;
+
+    const char* cases[][2] = {
+        { "", "2 3 4 5 10 11" },
+        { "id:2,4", "2 4" },
+        { "id:3-10", "3 4 5 10" },
+        { "id:2;id:11", "2 11" },
+        { "group:1,2", "4 5 10 11" },
+        { "host:10.0.1.*", "3 5 11" },
+        { "host:10.0.0.? group:0", "2" },
+        { "status:not_started,STARTING", "5 11" },
+        { "skip:4", "5 10 11" },
+        { "skip:4 host:*.1", "" },
+        { "skip:3 host:10.0.1.*", "5 11" },
+        { "from:4", "error: unknown kind 'from'" },
+        { "id:10-3", "error: bad id '10-3'" },
+        { "id:0", "error: bad id '0'" },
+        { "group:x", "error: bad group 'x'" },
+        { "status:sleepy", "error: bad status 'sleepy'" },
+        { "rack:7", "error: unknown kind 'rack'" },
+        { "id", "error: expected kind:values, got 'id'" },
+        { "id:", "error: no values for 'id'" }
+    };
+
+    for (const auto& test_case : cases) {
+        std::string ids = selected_ids(test_case[0]);
+        if (verbose) {
+            printf("'%s': %s\n", test_case[0], ids.c_str());
+        }
+        failures += check_str_m(ids.c_str(), test_case[1], test_case[0]);
+    }
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_node_selection(verbose);
+
+    return check_status(failures);
+}
@@ -0,0 +1,113 @@
+#include <stdlib.h>
+
+#include "cluster_fixture.hpp"
+#include "echeck.h"
+#include "ndb_rolling_restart_node_table.hpp"
+#include <string.h>
+
+static ndb_mgm_node_state& node_state(ndb_mgm_cluster_state* cluster_state,
+    int node_id)
+{
+    return cluster_state->node_states[cluster_state->no_of_nodes + 1
+        - node_id];
+}
+
+int test_update(int verbose)
+{
+    int failures = 0;
+    node_table_s table;
+
+    ndb_mgm_cluster_state* cluster_state = make_cluster_state(6);
+    node_state(cluster_state, 4).node_status = NDB_MGM_NODE_STATUS_STARTING;
+    node_state(cluster_state, 4).start_phase = 3;
+    node_state(cluster_state, 7).node_group = 65536;
+    update_node_table(table, cluster_state);
+
+    failures += check_size_t(table.node_ids.size(), 6);
+    failures += check_int(table.node_ids[0], 2);
+    failures += check_int(node_table_row(table, 4), 2);
+    failures += check_int(table.start_phases[2], 3);
+    failures += check_int(node_table_row(table, 8), -1);
+    failures += check_int(node_table_row(table, 1000), -1);
+    failures += check_int(node_table_group(table, 5), 1);
+    failures += check_int(node_table_group(table, 8), -1);
+    failures += check_size_t(table.started.count(), 5);
+    failures += check_int(node_table_live_replicas(table, 0), 2);
+    failures += check_int(node_table_live_replicas(table, 1), 1);
+    failures += check_int(node_table_live_replicas(table, 2), 1);
+    failures += check_int(node_table_live_replicas(table, 3), -1);
+    failures += check_int(node_table_live_replicas(table, 65536), -1);
+
+    /* node 7 leaves, rows and counters of the old poll are gone */
+    cluster_state->no_of_nodes = 5;
+    memmove(cluster_state->node_states, cluster_state->node_states + 1,
+        5 * sizeof(ndb_mgm_node_state));
+    node_state(cluster_state, 4).node_status = NDB_MGM_NODE_STATUS_STARTED;
+    update_node_table(table, cluster_state);
+    failures += check_int(node_table_row(table, 7), -1);
+    failures += check_int(node_table_row(table, 6), 4);
+    failures += check_int(node_table_live_replicas(table, 1), 2);
+    failures += check_size_t(table.started.count(), 5);
+
+    update_node_table(table, nullptr);
+    failures += check_size_t(table.node_ids.size(), 0);
+    failures += check_int(node_table_row(table, 2), -1);
+
+    free(cluster_state);
+    return failures;
+}
+
+int test_masks(int verbose)
+{
+    int failures = 0;
+    node_table_s table;
+
+    ndb_mgm_cluster_state* cluster_state = make_cluster_state(6);
+    update_node_table(table, cluster_state);
+
+    /* one node per node group may go down, not both */
+    node_mask_t first = node_mask({ 2, 4, 6 });
+    failures += check_int(node_table_eligible(table, first) == first, 1);
+    failures += check_int(node_table_eligible(table, node_mask({ 2, 3 }))
+            .none(),
+        1);
+
+    /* node 2 is restarting, so node 3 has to wait */
+    table.in_flight = node_mask({ 2 });
+    failures += check_int(node_table_eligible(table, node_mask({ 3, 4 }))
+            == node_mask({ 4 }),
+        1);
+    failures += check_int(node_table_eligible(table, node_mask({ 2 }))
+            .none(),
+        1);
+
+    node_state(cluster_state, 5).node_status = NDB_MGM_NODE_STATUS_NOT_STARTED;
+    update_node_table(table, cluster_state);
+    failures += check_int(node_table_eligible(table, node_mask({ 4, 5, 6 }))
+            == node_mask({ 6 }),
+        1);
+
+    failures += check_int(node_table_group_nodes(table, node_mask({ 3, 6 }))
+            == node_mask({ 2, 3, 6, 7 }),
+        1);
+    failures += check_size_t(node_table_group_nodes(table, node_mask({ 9 }))
+                                 .count(),
+        7);
+    failures += check_int(node_mask_test(node_mask({ 2, 300 }), 2), 1);
+    failures += check_int(node_mask_test(node_mask({ 2, 300 }), 300), 0);
+
+    free(cluster_state);
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_update(verbose);
+    failures += test_masks(verbose);
+
+    return check_status(failures);
+}
@@ -0,0 +1,165 @@
+#include <stdlib.h>
+
+#include "cluster_fixture.hpp"
+#include "echeck.h"
+#include "ndb_rolling_restart_plan_cache.hpp"
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* nodes 2 to 5, two per node group, each on a host of its own */
+static ndb_mgm_cluster_state* make_topology()
+{
+    std::vector<ndb_mgm_node_state> nodes;
+    for (int i = 0; i < 4; ++i) {
+        ndb_mgm_node_state node = make_node_state(i + 2, i / 2);
+        node.version = 0x080020;
+        sprintf(node.connect_address, "10.0.0.%d", i + 1);
+        nodes.push_back(node);
+    }
+    return make_cluster_state(nodes);
+}
+
+int test_fnv1a(int verbose)
+{
+    int failures = 0;
+
+    failures += check_str(fingerprint_hex(fnv1a_64("", 0,
+                              FNV1A_64_OFFSET_BASIS))
+                              .c_str(),
+        "cbf29ce484222325");
+    failures += check_str(fingerprint_hex(fnv1a_64("a", 1,
+                              FNV1A_64_OFFSET_BASIS))
+                              .c_str(),
+        "af63dc4c8601ec8c");
+    failures += check_str(fingerprint_hex(fnv1a_64("foobar", 6,
+                              FNV1A_64_OFFSET_BASIS))
+                              .c_str(),
+        "85944171f73967e8");
+    return failures;
+}
+
+int test_topology_fingerprint(int verbose)
+{
+    int failures = 0;
+
+    ndb_mgm_cluster_state* cluster_state = make_topology();
+    std::vector<restart_node_status_s> node_restarts{
+        { 2, 0, false }, { 3, 0, false }, { 4, 1, false }, { 5, 1, false }
+    };
+    uint64_t fingerprint = topology_fingerprint(cluster_state, node_restarts,
+        "");
+    if (verbose) {
+        printf("fingerprint: %s\n", fingerprint_hex(fingerprint).c_str());
+    }
+
+    /* the order get_status2 lists the nodes in does not matter */
+    std::swap(cluster_state->node_states[0], cluster_state->node_states[3]);
+    failures += check_int(topology_fingerprint(cluster_state, node_restarts,
+                              "")
+            == fingerprint,
+        1);
+
+    failures += check_int(topology_fingerprint(cluster_state, node_restarts,
+                              "round_robin")
+            == fingerprint,
+        0);
+
+    node_restarts[1].was_restarted = true;
+    failures += check_int(topology_fingerprint(cluster_state, node_restarts,
+                              "")
+            == fingerprint,
+        0);
+    node_restarts[1].was_restarted = false;
+
+    /* status and connect_count are not part of the topology */
+    cluster_state->node_states[1].node_status = NDB_MGM_NODE_STATUS_STARTING;
+    cluster_state->node_states[1].connect_count = 7;
+    failures += check_int(topology_fingerprint(cluster_state, node_restarts,
+                              "")
+            == fingerprint,
+        1);
+
+    cluster_state->node_states[1].node_group = 1;
+    failures += check_int(topology_fingerprint(cluster_state, node_restarts,
+                              "")
+            == fingerprint,
+        0);
+    cluster_state->node_states[1].node_group = 0;
+
+    strcpy(cluster_state->node_states[2].connect_address, "10.0.1.3");
+    failures += check_int(topology_fingerprint(cluster_state, node_restarts,
+                              "")
+            == fingerprint,
+        0);
+    free(cluster_state);
+
+    cluster_state = make_topology();
+    cluster_state->node_states[3].version = 0x080021;
+    failures += check_int(topology_fingerprint(cluster_state, node_restarts,
+                              "")
+            == fingerprint,
+        0);
+    free(cluster_state);
+
+    return failures;
+}
+
+int test_plan_cache_file(int verbose)
+{
+    int failures = 0;
+
+    char path[] = "/tmp/test-plan-cache-XXXXXX";
+    int fd = mkstemp(path);
+    close(fd);
+    unlink(path);
+
+    restart_waves_t waves;
+    failures += check_int(read_plan_cache(path, 17, waves), 1);
+
+    restart_waves_t plan{ { { 3, 0, false }, { 5, 1, false } },
+        { { 2, 0, false }, { 4, 1, false } } };
+    failures += check_int(write_plan_cache(path, 0xfedcba9876543210ULL, plan),
+        0);
+
+    failures += check_int(read_plan_cache(path, 17, waves), 1);
+    failures += check_size_t(waves.size(), 0);
+
+    failures += check_int(read_plan_cache(path, 0xfedcba9876543210ULL, waves),
+        0);
+    failures += check_size_t(waves.size(), 2);
+    std::string ids;
+    for (const auto& wave : waves) {
+        for (const auto& node : wave) {
+            ids += std::to_string(node.node_id) + ":"
+                + std::to_string(node.node_group) + " ";
+        }
+    }
+    failures += check_str(ids.c_str(), "3:0 5:1 2:0 4:1 ");
+
+    {
+        std::ofstream out(path, std::ios::app);
+        out << "wave 6:x\n";
+    }
+    waves.clear();
+    failures += check_int(read_plan_cache(path, 0xfedcba9876543210ULL, waves),
+        1);
+    failures += check_size_t(waves.size(), 0);
+
+    unlink(path);
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_fnv1a(verbose);
+    failures += test_topology_fingerprint(verbose);
+    failures += test_plan_cache_file(verbose);
+
+    return check_status(failures);
+}
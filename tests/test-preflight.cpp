@@ -0,0 +1,129 @@
+#include <stdlib.h>
+
+#include "cluster_fixture.hpp"
+#include "echeck.h"
+#include "ndb_rolling_restart_preflight.hpp"
+#include <stdio.h>
+#include <string.h>
+
+/* answers dump state of failing_node with a failed reply */
+struct dump_failure_api_s : scripted_api_s {
+    int dump_state(ndb_connection_context_s& ndb_ctx, int node_id,
+        const int* args, int num_args, ndb_mgm_reply* reply) override
+    {
+        reply->return_code = node_id == failing_node ? 1 : 0;
+        strcpy(reply->message, "node is busy");
+        return 0;
+    }
+    int failing_node = 0;
+};
+
+static void print_problems(const preflight_result_s& result, int verbose)
+{
+    if (!verbose) {
+        return;
+    }
+    for (const auto& problem : result.problems) {
+        printf("%s\n", problem.c_str());
+    }
+}
+
+int test_preflight_pass(int verbose)
+{
+    int failures = 0;
+
+    scripted_api_s api;
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    preflight_result_s result;
+    preflight_check_nodes(ndb_ctx,
+        { { 2, 0, 0x00070610 }, { 4, 1, 0x00070610 } }, result);
+    print_problems(result, verbose);
+    failures += check_size_t(result.problems.size(), 0);
+    return failures;
+}
+
+int test_preflight_fail(int verbose)
+{
+    int failures = 0;
+
+    dump_failure_api_s api;
+    api.node(3)->node_status = NDB_MGM_NODE_STATUS_STARTING;
+    api.failing_node = 5;
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    preflight_result_s result;
+    preflight_check_nodes(ndb_ctx,
+        { { 2, 1, 0x00070610 }, { 3, 0, 0x00070610 }, { 4, 1, 0x00070600 },
+            { 5, 1, 0x00070610 }, { 9, 0, 0x00070610 } },
+        result);
+    print_problems(result, verbose);
+    failures += check_size_t(result.problems.size(), 5);
+    if (result.problems.size() == 5) {
+        failures += check_str(result.problems[0].c_str(),
+            "node 2: node group 0, planned 1");
+        failures += check_str(result.problems[1].c_str(), "node 3: STARTING");
+        failures += check_str(result.problems[2].c_str(),
+            "node 4: version 460304, planned 460288");
+        failures += check_str(result.problems[3].c_str(),
+            "node 9: not in cluster state");
+        failures += check_str(result.problems[4].c_str(),
+            "node 5: dump state node is busy");
+    }
+
+    /* without a status nothing can be checked */
+    scripted_api_s gone;
+    gone.failed_polls = 1;
+    ndb_connection_context_s gone_ctx;
+    gone_ctx.api = &gone;
+    preflight_result_s gone_result;
+    preflight_check_nodes(gone_ctx, { { 2, 0, 0x00070610 } }, gone_result);
+    print_problems(gone_result, verbose);
+    failures += check_size_t(gone_result.problems.size(), 1);
+    return failures;
+}
+
+int test_preflight_background(int verbose)
+{
+    int failures = 0;
+
+    scripted_api_s api;
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    ndb_ctx.cluster_state = make_cluster_state(4);
+    ndb_preflight_s preflight;
+    failures += check_int(preflight_finish(preflight) == nullptr, 1);
+
+    /* the planned versions come from the cluster state of the context */
+    std::vector<restart_node_status_s> wave(2);
+    wave[0].node_id = 3;
+    wave[0].node_group = 0;
+    wave[1].node_id = 5;
+    wave[1].node_group = 1;
+    failures += check_int(preflight_begin(preflight, ndb_ctx, wave), 0);
+    const preflight_result_s* result = preflight_finish(preflight);
+    failures += check_int(result != nullptr, 1);
+    if (result) {
+        print_problems(*result, verbose);
+        failures += check_size_t(result->node_ids.size(), 2);
+        failures += check_size_t(result->problems.size(), 0);
+    }
+    failures += check_int(api.connects, 1);
+
+    free((void*)ndb_ctx.cluster_state);
+    ndb_ctx.cluster_state = nullptr;
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_preflight_pass(verbose);
+    failures += test_preflight_fail(verbose);
+    failures += test_preflight_background(verbose);
+
+    return check_status(failures);
+}
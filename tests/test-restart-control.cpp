@@ -0,0 +1,84 @@
+#include <stdlib.h>
+
+#include "echeck.h"
+#include "ndb_rolling_restart_control.hpp"
+#include <fstream>
+#include <stdio.h>
+#include <unistd.h>
+
+int test_parse(int verbose)
+{
+    int failures = 0;
+
+    failures += check_int(parse_restart_control(""), RESTART_CONTROL_RUN);
+    failures += check_int(parse_restart_control("resume\n"),
+        RESTART_CONTROL_RUN);
+    failures += check_int(parse_restart_control("pause"),
+        RESTART_CONTROL_PAUSE);
+    failures += check_int(parse_restart_control("  pause until 22:00\n"),
+        RESTART_CONTROL_PAUSE);
+    failures += check_int(parse_restart_control("cancel"),
+        RESTART_CONTROL_CANCEL);
+    failures += check_int(parse_restart_control("Cancel"),
+        RESTART_CONTROL_RUN);
+    return failures;
+}
+
+static void write_file(const char* path, const char* text)
+{
+    std::ofstream out(path);
+    out << text;
+}
+
+int test_control(int verbose)
+{
+    int failures = 0;
+
+    char path[] = "/tmp/test-restart-control-XXXXXX";
+    close(mkstemp(path));
+    unlink(path);
+
+    std::atomic<bool> cancel{ false };
+    std::atomic<bool> pause{ false };
+
+    failures += check_int(read_restart_control(path), RESTART_CONTROL_RUN);
+    failures += check_int(get_restart_control(nullptr, nullptr, ""),
+        RESTART_CONTROL_RUN);
+    failures += check_int(get_restart_control(&cancel, &pause, path),
+        RESTART_CONTROL_RUN);
+
+    pause = true;
+    failures += check_int(get_restart_control(&cancel, &pause, path),
+        RESTART_CONTROL_PAUSE);
+
+    /* the file may cancel a paused rollout */
+    write_file(path, "cancel\n");
+    failures += check_int(get_restart_control(&cancel, &pause, path),
+        RESTART_CONTROL_CANCEL);
+
+    write_file(path, "pause\n");
+    pause = false;
+    failures += check_int(get_restart_control(&cancel, &pause, path),
+        RESTART_CONTROL_PAUSE);
+
+    cancel = true;
+    failures += check_int(get_restart_control(&cancel, &pause, path),
+        RESTART_CONTROL_CANCEL);
+    failures += check_int(get_restart_control(&cancel, nullptr, ""),
+        RESTART_CONTROL_CANCEL);
+
+    unlink(path);
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_parse(verbose);
+    failures += test_control(verbose);
+
+    return check_status(failures);
+}
@@ -0,0 +1,97 @@
+#include <stdlib.h>
+
+#include "cluster_fixture.hpp"
+#include "echeck.h"
+#include "ndb_rolling_restart_epochs.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static std::string skip_reason(const restart_epochs_s& epochs, int node_id,
+    int connect_count)
+{
+    std::string reason;
+    if (!epochs_skip_node(&epochs, node_id, connect_count, &reason)) {
+        return "";
+    }
+    return reason;
+}
+
+int test_restart_epochs(int verbose)
+{
+    int failures = 0;
+
+    char path[] = "/tmp/test-restart-epochs-XXXXXX";
+    int fd = mkstemp(path);
+    close(fd);
+    unlink(path);
+
+    restart_epochs_s epochs;
+    failures += check_int(read_restart_epochs(epochs, path), 0);
+    failures += check_size_t(epochs.nodes.size(), 0);
+
+    std::vector<ndb_mgm_node_state> nodes{ make_node_state(2, 0),
+        make_node_state(3, 0), make_node_state(4, 0) };
+    nodes[2].connect_count = 2;
+    ndb_mgm_cluster_state* cluster_state = make_cluster_state(nodes);
+
+    /* first run: nothing known, node 2 restarted by us at 1000 */
+    epochs_run_begin(&epochs, cluster_state, 900);
+    failures += check_long(epochs.nodes[3].epoch, 0);
+    failures += check_str(skip_reason(epochs, 3, 1).c_str(), "");
+    epochs_node_restarted(&epochs, 2, 1000);
+    failures += check_str(skip_reason(epochs, 2, 2).c_str(), "");
+
+    /* node 3 restarted on its own during the run */
+    failures += check_str(skip_reason(epochs, 3, 2).c_str(),
+        "restarted since the run began, connect_count 1 -> 2");
+
+    /* second run: node 2 is seen with its new connect_count, node 4 has
+       restarted since the file was written */
+    restart_epochs_s again;
+    failures += check_int(read_restart_epochs(again, path), 0);
+    failures += check_size_t(again.nodes.size(), 3);
+    failures += check_int(again.nodes[2].connect_count, -1);
+    failures += check_long(again.nodes[2].epoch, 1000);
+
+    cluster_state->node_states[0].connect_count = 2;
+    cluster_state->node_states[2].connect_count = 3;
+    again.skip_since = 950;
+    epochs_run_begin(&again, cluster_state, 2000);
+    failures += check_int(again.nodes[2].connect_count, 2);
+    failures += check_long(again.nodes[2].epoch, 1000);
+    failures += check_long(again.nodes[4].epoch, 2000);
+
+    failures += check_str(skip_reason(again, 2, 2).c_str(),
+        "restarted at 1000, not before 950");
+    failures += check_str(skip_reason(again, 3, 1).c_str(), "");
+    failures += check_str(skip_reason(again, 4, 3).c_str(),
+        "restarted at 2000, not before 950");
+
+    again.skip_since = 1500;
+    failures += check_str(skip_reason(again, 2, 2).c_str(), "");
+
+    if (verbose) {
+        for (const auto& entry : again.nodes) {
+            printf("%d %d %ld\n", entry.second.node_id,
+                entry.second.connect_count, (long)entry.second.epoch);
+        }
+    }
+
+    failures += check_int(epochs_skip_node(nullptr, 2, 9, nullptr), 0);
+
+    free(cluster_state);
+    unlink(path);
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_restart_epochs(verbose);
+
+    return check_status(failures);
+}
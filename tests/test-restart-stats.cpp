@@ -0,0 +1,146 @@
+#include <stdlib.h>
+
+#include "echeck.h"
+#include "ndb_rolling_restart_stats.hpp"
+#include <stdio.h>
+#include <unistd.h>
+
+static stats_time_t at_ms(stats_time_t zero, long ms)
+{
+    return zero + std::chrono::milliseconds(ms);
+}
+
+int test_percentile(int verbose)
+{
+    int failures = 0;
+
+    std::vector<uint64_t> values;
+    failures += check_unsigned_long(stats_percentile(values, 50), 0);
+    for (uint64_t i = 20; i >= 1; --i) {
+        values.push_back(i * 100);
+    }
+    failures += check_unsigned_long(stats_percentile(values, 50), 1000);
+    failures += check_unsigned_long(stats_percentile(values, 95), 1900);
+    failures += check_unsigned_long(stats_percentile(values, 100), 2000);
+    failures += check_unsigned_long(stats_percentile(values, 0), 100);
+    failures += check_unsigned_long(stats_percentile({ 7 }, 95), 7);
+    return failures;
+}
+
+int test_summary(int verbose)
+{
+    int failures = 0;
+
+    /* two waves of two nodes, 5s idle between them */
+    ndb_stats_s stats;
+    stats_time_t zero = std::chrono::steady_clock::now();
+    stats_nodes_begin(&stats, 2, at_ms(zero, 0));
+    stats_phase_done(&stats, "start_phase 4", std::chrono::milliseconds(3000));
+    stats_phase_done(&stats, "start_phase 4", std::chrono::milliseconds(5000));
+    stats_node_done(&stats, 3, 0, 10000, at_ms(zero, 10000));
+    stats_node_done(&stats, 5, 1, 20000, at_ms(zero, 20000));
+    stats_nodes_begin(&stats, 1, at_ms(zero, 25000));
+    stats_nodes_begin(&stats, 1, at_ms(zero, 25000));
+    stats_node_done(&stats, 2, 0, 10000, at_ms(zero, 35000));
+    stats_node_done(&stats, 4, 1, 15000, at_ms(zero, 40000));
+
+    stats_nodes_begin(nullptr, 1, zero);
+    stats_node_done(nullptr, 1, 0, 1, zero);
+
+    stats_summary_s summary = summarize_stats(stats);
+    failures += check_size_t(summary.node.count, 4);
+    failures += check_unsigned_long(summary.node.p50_ms, 10000);
+    failures += check_unsigned_long(summary.node.p95_ms, 20000);
+    failures += check_unsigned_long(summary.node.max_ms, 20000);
+    failures += check_size_t(summary.phases.size(), 1);
+    failures += check_unsigned_long(summary.phases["start_phase 4"].max_ms,
+        5000);
+    failures += check_size_t(summary.slowest_groups.size(), 2);
+    failures += check_int(summary.slowest_groups[0].first, 1);
+    failures += check_unsigned_long(summary.slowest_groups[0].second, 35000);
+    failures += check_unsigned_long(summary.wall_ms, 40000);
+    failures += check_unsigned_long(summary.idle_ms, 5000);
+    failures += check_int((int)(summary.parallelism * 100), 137);
+
+    auto lines = format_stats_summary(summary, 1);
+    if (verbose) {
+        for (const auto& line : lines) {
+            printf("%s\n", line.c_str());
+        }
+    }
+    failures += check_size_t(lines.size(), 4);
+    failures += check_str(lines[0].c_str(),
+        "node restart: n=4 p50=10.0s p95=20.0s max=20.0s");
+    failures += check_str(lines[2].c_str(), "slowest node groups: 1 (35.0s)");
+    failures += check_str(lines[3].c_str(),
+        "wall 40.0s, idle 5.0s, parallelism 1.38");
+
+    auto values = stats_baseline_values(summary);
+    failures += check_unsigned_long(values["node_p95_ms"], 20000);
+    failures += check_unsigned_long(values["phase_start_phase_4_p95_ms"],
+        5000);
+    failures += check_unsigned_long(values["restart_node_5_ms"], 20000);
+    failures += check_unsigned_long(stats_baseline_node_ms(values, 4), 15000);
+    /* a node without history takes the median */
+    failures += check_unsigned_long(stats_baseline_node_ms(values, 9), 10000);
+    failures += check_unsigned_long(
+        stats_baseline_node_ms(std::map<std::string, uint64_t>(), 4), 0);
+    failures += check_size_t(stats_baseline_values(stats_summary_s()).size(),
+        0);
+    return failures;
+}
+
+int test_baselines(int verbose)
+{
+    int failures = 0;
+
+    char path[] = "/tmp/test-restart-stats-XXXXXX";
+    int fd = mkstemp(path);
+    close(fd);
+    unlink(path);
+
+    std::map<std::string, std::map<std::string, uint64_t>> baselines;
+    failures += check_int(read_stats_baselines(path, baselines), 0);
+    failures += check_size_t(baselines.size(), 0);
+
+    baselines["alpha"]["node_p95_ms"] = 60000;
+    baselines["alpha"]["wall_ms"] = 600000;
+    baselines["beta"]["node_p95_ms"] = 1000;
+    failures += check_int(write_stats_baselines(path, baselines), 0);
+
+    std::map<std::string, std::map<std::string, uint64_t>> read_back;
+    failures += check_int(read_stats_baselines(path, read_back), 0);
+    failures += check_int(read_back == baselines, 1);
+    unlink(path);
+
+    std::map<std::string, uint64_t> current{ { "node_p95_ms", 80000 },
+        { "wall_ms", 650000 }, { "node_max_ms", 99999 } };
+    auto warnings = compare_stats_baseline(baselines["alpha"], current, 0.2,
+        2000);
+    failures += check_size_t(warnings.size(), 1);
+    if (warnings.size()) {
+        failures += check_str(warnings[0].c_str(),
+            "node_p95_ms regressed: 80.0s, baseline 60.0s (+33%)");
+    }
+
+    /* large relative, small absolute change is noise */
+    std::map<std::string, uint64_t> small{ { "node_p95_ms", 2500 } };
+    failures += check_size_t(compare_stats_baseline(baselines["beta"], small,
+                                 0.2, 2000)
+                                 .size(),
+        0);
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_percentile(verbose);
+    failures += test_summary(verbose);
+    failures += test_baselines(verbose);
+
+    return check_status(failures);
+}
@@ -0,0 +1,365 @@
+#include <stdlib.h>
+
+#include "cluster_fixture.hpp"
+#include "echeck.h"
+#include "ndb_rolling_restart.hpp"
+#include "ndb_rolling_restart_hooks.hpp"
+#include "ndb_rolling_restart_host_locks.hpp"
+#include "ndb_rolling_restart_metrics.hpp"
+#include "ndb_rolling_restart_schedule.hpp"
+#include "ndb_rolling_restart_stats.hpp"
+#include <atomic>
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* prints the log of the restart if verbose */
+static void log_to_stdout(ndb_connection_context_s& ndb_ctx, int verbose)
+{
+    if (!verbose) {
+        return;
+    }
+    ndb_ctx.on_event = [](const restart_event_s& event) {
+        if (!event.message.empty()) {
+            printf("%s\n", event.message.c_str());
+        }
+    };
+}
+
+static std::string joined(const std::vector<std::string>& calls)
+{
+    std::string all;
+    for (const auto& call : calls) {
+        all += call + "\n";
+    }
+    return all;
+}
+
+int test_pipelined(int verbose)
+{
+    int failures = 0;
+
+    scripted_api_s api;
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    ndb_ctx.ready_start_phase = 4;
+    log_to_stdout(ndb_ctx, verbose);
+
+    failures += check_int(ndb_rolling_restart(ndb_ctx), 0);
+    if (verbose) {
+        printf("%s", joined(api.calls).c_str());
+    }
+    /* node 5 goes down while node 3 of the other node group is STARTING
+       past ready_start_phase, node 4 waits for node 5 of its own node
+       group to be STARTED */
+    failures += check_str(joined(api.calls).c_str(),
+        "restart4 3\n"
+        "restart4 5 (3 STARTING 5)\n"
+        "restart4 2 (5 STARTING 5)\n"
+        "restart4 4 (2 STARTING 5)\n");
+    for (const auto& node : api.nodes) {
+        failures += check_int(node.node_status, NDB_MGM_NODE_STATUS_STARTED);
+        failures += check_int(node.connect_count, 2);
+    }
+
+    /* a node STARTING past ready_start_phase holds up its own node
+       group until it is STARTED, however long that takes */
+    scripted_api_s slow;
+    slow.recovery.insert(slow.recovery.end() - 1, 3,
+        { NDB_MGM_NODE_STATUS_STARTING, 101 });
+    ndb_connection_context_s slow_ctx;
+    slow_ctx.api = &slow;
+    slow_ctx.ready_start_phase = 4;
+    failures += check_int(ndb_rolling_restart(slow_ctx), 0);
+    failures += check_str(joined(slow.calls).c_str(),
+        "restart4 3\n"
+        "restart4 5 (3 STARTING 5)\n"
+        "restart4 2 (5 STARTING 101)\n"
+        "restart4 4 (2 STARTING 5)\n");
+    return failures;
+}
+
+int test_lost_status(int verbose)
+{
+    int failures = 0;
+
+    /* the management server goes away while node 5 recovers, and comes
+       back */
+    scripted_api_s api;
+    api.on_restart = [](scripted_api_s& api) {
+        if (api.calls.size() == 1) {
+            api.failed_polls = 2;
+        }
+    };
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    ndb_ctx.ready_start_phase = 4;
+    log_to_stdout(ndb_ctx, verbose);
+    failures += check_int(ndb_rolling_restart(ndb_ctx), 0);
+    failures += check_size_t(api.calls.size(), 4);
+    failures += check_int(api.connects > 1, 1);
+
+    /* it does not come back, the restart gives up */
+    scripted_api_s gone;
+    gone.on_restart = [](scripted_api_s& api) {
+        api.failed_polls = 1000;
+        api.failed_connects = 1000;
+    };
+    ndb_connection_context_s gone_ctx;
+    gone_ctx.api = &gone;
+    gone_ctx.ready_start_phase = 4;
+    log_to_stdout(gone_ctx, verbose);
+    failures += check_int(ndb_rolling_restart(gone_ctx), 1);
+    failures += check_size_t(gone.calls.size(), 1);
+    failures += check_int(gone.sleeps < 10, 1);
+    return failures;
+}
+
+int test_pause_resume_cancel(int verbose)
+{
+    int failures = 0;
+
+    /* paused after the first restart, resumed after three seconds */
+    std::atomic<bool> pause{ false };
+    std::vector<size_t> restarts_while_paused;
+    scripted_api_s api;
+    api.on_restart = [&pause](scripted_api_s& api) {
+        if (api.calls.size() == 1) {
+            pause = true;
+        }
+    };
+    api.on_sleep = [&](scripted_api_s& api) {
+        if (pause) {
+            restarts_while_paused.push_back(api.calls.size());
+            pause = restarts_while_paused.size() < 3;
+        }
+    };
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    ndb_ctx.pause = &pause;
+    log_to_stdout(ndb_ctx, verbose);
+    failures += check_int(ndb_rolling_restart(ndb_ctx), 0);
+    failures += check_size_t(api.calls.size(), 4);
+    failures += check_size_t(restarts_while_paused.size(), 3);
+    for (auto restarts : restarts_while_paused) {
+        failures += check_size_t(restarts, 1);
+    }
+
+    /* cancelled after the second restart */
+    std::atomic<bool> cancel{ false };
+    scripted_api_s cancelled;
+    cancelled.on_restart = [&cancel](scripted_api_s& api) {
+        cancel = api.calls.size() == 2;
+    };
+    ndb_connection_context_s cancel_ctx;
+    cancel_ctx.api = &cancelled;
+    cancel_ctx.cancel = &cancel;
+    log_to_stdout(cancel_ctx, verbose);
+    failures += check_int(ndb_rolling_restart(cancel_ctx), 1);
+    failures += check_size_t(cancelled.calls.size(), 2);
+
+    /* the backend goes away while paused */
+    std::atomic<bool> paused{ true };
+    scripted_api_s aborted;
+    aborted.on_sleep = [](scripted_api_s& api) {
+        api.abort = api.sleeps >= 2;
+    };
+    ndb_connection_context_s abort_ctx;
+    abort_ctx.api = &aborted;
+    abort_ctx.pause = &paused;
+    log_to_stdout(abort_ctx, verbose);
+    failures += check_int(ndb_rolling_restart(abort_ctx), 1);
+    failures += check_size_t(aborted.calls.size(), 0);
+    failures += check_int(aborted.sleeps, 2);
+    return failures;
+}
+
+int test_last_live_replica(int verbose)
+{
+    int failures = 0;
+
+    /* node 2 is down, node 3 is the last live replica of node group 0 */
+    scripted_api_s api;
+    api.node(2)->node_status = NDB_MGM_NODE_STATUS_NOT_STARTED;
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    ndb_ctx.wait_seconds = 3;
+    log_to_stdout(ndb_ctx, verbose);
+    failures += check_int(ndb_rolling_restart(ndb_ctx), 1);
+    failures += check_size_t(api.calls.size(), 0);
+    failures += check_int(api.sleeps, 3);
+
+    /* node 2 comes back while node 3 waits */
+    scripted_api_s back;
+    back.node(2)->node_status = NDB_MGM_NODE_STATUS_NOT_STARTED;
+    back.on_sleep = [](scripted_api_s& api) {
+        api.node(2)->node_status = NDB_MGM_NODE_STATUS_STARTED;
+    };
+    ndb_connection_context_s back_ctx;
+    back_ctx.api = &back;
+    back_ctx.wait_seconds = 3;
+    log_to_stdout(back_ctx, verbose);
+    failures += check_int(ndb_rolling_restart(back_ctx), 0);
+    failures += check_size_t(back.calls.size(), 4);
+    failures += check_int(back.sleeps, 1);
+    return failures;
+}
+
+/* counts the events of type, and the messages which contain text */
+struct event_count_s {
+    restart_event_type_e type;
+    std::string text;
+    int events;
+    int messages;
+};
+
+static void count_events(ndb_connection_context_s& ndb_ctx,
+    event_count_s& count)
+{
+    ndb_ctx.on_event = [&count](const restart_event_s& event) {
+        if (event.type == count.type) {
+            ++count.events;
+        }
+        if (event.message.find(count.text) != std::string::npos) {
+            ++count.messages;
+        }
+    };
+}
+
+int test_wave_hooks(int verbose)
+{
+    int failures = 0;
+
+    /* a failed pre_wave keeps the nodes up and out of the counts */
+    scripted_api_s api;
+    ndb_metrics_s metrics;
+    ndb_wave_hooks_s hooks;
+    hooks.pre_wave = "/bin/false";
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    ndb_ctx.metrics = &metrics;
+    ndb_ctx.hooks = &hooks;
+    event_count_s begins{ RESTART_EVENT_NODE_BEGIN, "ndb_mgm_restart4", 0, 0 };
+    count_events(ndb_ctx, begins);
+    failures += check_int(ndb_rolling_restart(ndb_ctx), 1);
+    failures += check_size_t(api.calls.size(), 0);
+    failures += check_int(begins.events, 0);
+    failures += check_int(begins.messages, 0);
+    failures += check_unsigned_int_m(metrics.nodes_in_flight.load(), 0,
+        "nodes_in_flight");
+
+    /* the nodes are not waited for, so they may not be STARTED yet */
+    scripted_api_s no_wait;
+    ndb_wave_hooks_s post_hooks;
+    post_hooks.post_wave = "/bin/true";
+    ndb_connection_context_s no_wait_ctx;
+    no_wait_ctx.api = &no_wait;
+    no_wait_ctx.hooks = &post_hooks;
+    no_wait_ctx.wait_after_restart = false;
+    event_count_s post{ RESTART_EVENT_NODE_BEGIN, "post_wave hook", 0, 0 };
+    count_events(no_wait_ctx, post);
+    failures += check_int(ndb_rolling_restart(no_wait_ctx), 0);
+    failures += check_size_t(no_wait.calls.size(), 4);
+    failures += check_int(post.events, 4);
+    failures += check_int(post.messages, 0);
+
+    /* and run once they are */
+    scripted_api_s wait;
+    ndb_connection_context_s wait_ctx;
+    wait_ctx.api = &wait;
+    wait_ctx.hooks = &post_hooks;
+    event_count_s waited{ RESTART_EVENT_NODE_BEGIN, "post_wave hook", 0, 0 };
+    count_events(wait_ctx, waited);
+    failures += check_int(ndb_rolling_restart(wait_ctx), 0);
+    failures += check_int(waited.messages, 4);
+    if (verbose) {
+        printf("post_wave ran %d times\n", waited.messages);
+    }
+    return failures;
+}
+
+int test_host_slots(int verbose)
+{
+    int failures = 0;
+
+    char dir[] = "/tmp/test-rolling-restart-XXXXXX";
+    if (!mkdtemp(dir)) {
+        return 1;
+    }
+
+    /* one slot for all the nodes, so each waits for the one before it
+       to be STARTED, even when it would be ready before */
+    scripted_api_s api;
+    for (auto& node : api.nodes) {
+        strcpy(node.connect_address, "h1");
+    }
+    ndb_host_locks_s locks;
+    locks.dir = dir;
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    ndb_ctx.host_locks = &locks;
+    ndb_ctx.ready_start_phase = 4;
+    log_to_stdout(ndb_ctx, verbose);
+    failures += check_int(ndb_rolling_restart(ndb_ctx), 0);
+    failures += check_str(joined(api.calls).c_str(),
+        "restart4 3\n"
+        "restart4 5\n"
+        "restart4 2\n"
+        "restart4 4\n");
+    failures += check_size_t(locks.held.size(), 0);
+
+    unlink(host_lock_path(locks, "h1", 0).c_str());
+    rmdir(dir);
+    return failures;
+}
+
+int test_planned_from_baseline(int verbose)
+{
+    int failures = 0;
+
+    char path[] = "/tmp/test-rolling-restart-XXXXXX";
+    close(mkstemp(path));
+    {
+        std::ofstream baseline(path);
+        baseline << "scripted restart_node_2_ms 90000\n"
+                 << "scripted restart_node_4_ms 90000\n"
+                 << "scripted node_p50_ms 30000\n";
+    }
+
+    /* the slowest node of each node group goes first, by the baseline */
+    scripted_api_s api;
+    ndb_stats_s stats;
+    stats.baseline_path = path;
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    ndb_ctx.stats = &stats;
+    ndb_ctx.schedule = find_schedule_policy("longest_first");
+    log_to_stdout(ndb_ctx, verbose);
+    failures += check_int(ndb_rolling_restart(ndb_ctx), 0);
+    failures += check_str(joined(api.calls).c_str(),
+        "restart4 2\n"
+        "restart4 4\n"
+        "restart4 3\n"
+        "restart4 5\n");
+
+    unlink(path);
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_pipelined(verbose);
+    failures += test_lost_status(verbose);
+    failures += test_pause_resume_cancel(verbose);
+    failures += test_last_live_replica(verbose);
+    failures += test_wave_hooks(verbose);
+    failures += test_host_slots(verbose);
+    failures += test_planned_from_baseline(verbose);
+
+    return check_status(failures);
+}
@@ -0,0 +1,268 @@
+#include <stdlib.h>
+
+#include "echeck.h"
+#include "ndb_rolling_restart_schedule.hpp"
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <string.h>
+
+/* a node on the same host recovering in the same wave adds half */
+#define HOST_CONTENTION 0.5
+
+struct policy_stats_s {
+    double makespan_seconds;
+    unsigned long fastest;
+    /* of the clusters which had all nodes started */
+    int min_live_replicas;
+    double sum_min_live_replicas;
+};
+
+static schedule_node_s make_node(int node_id, int node_group,
+    const char* host, double expected_seconds)
+{
+    return schedule_node_s{ node_id, node_group, host, true, true,
+        expected_seconds };
+}
+
+static std::string wave_ids(
+    const std::vector<std::vector<restart_node_status_s>>& waves)
+{
+    std::string ids;
+    for (const auto& wave : waves) {
+        ids += "[";
+        for (size_t i = 0; i < wave.size(); ++i) {
+            ids += (i ? " " : "") + std::to_string(wave[i].node_id);
+        }
+        ids += "]";
+    }
+    return ids;
+}
+
+int test_known_cluster(int verbose)
+{
+    int failures = 0;
+
+    std::vector<schedule_node_s> nodes{
+        make_node(2, 0, "a", 100),
+        make_node(3, 0, "b", 100),
+        make_node(4, 1, "a", 300),
+        make_node(5, 1, "b", 100)
+    };
+
+    const char* expected[][3] = {
+        { "round_robin", "[3 5][2 4]", "600" },
+        { "longest_first", "[3 4][2 5]", "400" },
+        { "host_batched", "[4 2][5 3]", "600" },
+        { "max_parallel", "[3 5][2 4]", "600" },
+        { "load_adaptive", "[3 4][2 5]", "400" }
+    };
+
+    failures += check_size_t(schedule_policies().size(), 5);
+    for (const auto& policy_case : expected) {
+        const ndb_schedule_policy_s* policy
+            = find_schedule_policy(policy_case[0]);
+        failures += check_int_m(policy != nullptr, 1, policy_case[0]);
+        if (!policy) {
+            continue;
+        }
+        auto waves = policy->plan(nodes);
+        auto estimate = simulate_schedule(nodes, waves, true,
+            HOST_CONTENTION, 60);
+        if (verbose) {
+            printf("%s: %s %.0fs\n", policy->name(),
+                wave_ids(waves).c_str(), estimate.makespan_seconds);
+        }
+        failures += check_str_m(wave_ids(waves).c_str(), policy_case[1],
+            policy_case[0]);
+        failures += check_str_m(
+            std::to_string((int)estimate.makespan_seconds).c_str(),
+            policy_case[2], policy_case[0]);
+        failures += check_int_m(estimate.min_live_replicas, 1,
+            policy_case[0]);
+
+        estimate = simulate_schedule(nodes, waves, false, HOST_CONTENTION,
+            60);
+        failures += check_int_m((int)estimate.makespan_seconds, 600,
+            policy_case[0]);
+    }
+    failures += check_int(find_schedule_policy("fastest") == nullptr, 1);
+
+    /* three replicas, all but one may restart at once */
+    std::vector<schedule_node_s> replicas{
+        make_node(2, 0, "a", 0),
+        make_node(3, 0, "b", 0),
+        make_node(4, 0, "c", 0)
+    };
+    auto waves = find_schedule_policy("max_parallel")->plan(replicas);
+    failures += check_str(wave_ids(waves).c_str(), "[4 3][2]");
+    auto estimate = simulate_schedule(replicas, waves, true, 0, 60);
+    failures += check_int((int)estimate.makespan_seconds, 120);
+    failures += check_int(estimate.min_live_replicas, 1);
+    failures += check_size_t(estimate.wave_seconds.size(), 2);
+    failures += check_int((int)estimate.wave_seconds[1], 60);
+
+    /* nodes which are not pending are live replicas, but not planned */
+    replicas[1].pending = false;
+    waves = find_schedule_policy("max_parallel")->plan(replicas);
+    failures += check_str(wave_ids(waves).c_str(), "[4 2]");
+    waves = find_schedule_policy("round_robin")->plan(replicas);
+    failures += check_str(wave_ids(waves).c_str(), "[4][2]");
+
+    return failures;
+}
+
+static std::vector<schedule_node_s> random_cluster(std::mt19937& rng)
+{
+    std::uniform_int_distribution<int> replicas_dist(2, 4);
+    std::uniform_int_distribution<int> groups_dist(1, 12);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_real_distribution<double> group_seconds(60, 900);
+    std::uniform_real_distribution<double> jitter(0.8, 1.2);
+
+    int replicas = replicas_dist(rng);
+    int node_groups = groups_dist(rng);
+    std::uniform_int_distribution<int> hosts_dist(replicas,
+        replicas * node_groups);
+    int hosts = hosts_dist(rng);
+    bool random_hosts = percent(rng) < 25;
+    int down_percent = percent(rng) < 10 ? 10 : 0;
+    int done_percent = percent(rng) < 20 ? percent(rng) / 2 : 0;
+
+    std::vector<schedule_node_s> nodes;
+    int node_id = 1;
+    for (int group = 0; group < node_groups; ++group) {
+        double seconds = group_seconds(rng);
+        for (int i = 0; i < replicas; ++i) {
+            int host = random_hosts ? percent(rng) % hosts
+                                    : (group + i * node_groups) % hosts;
+            bool started = percent(rng) >= down_percent;
+            bool pending = started && percent(rng) >= done_percent;
+            nodes.push_back(schedule_node_s{ node_id++, group,
+                "host" + std::to_string(host), started, pending,
+                seconds * jitter(rng) });
+        }
+    }
+    return nodes;
+}
+
+static int check_schedule(const ndb_schedule_policy_s& policy,
+    const std::vector<schedule_node_s>& nodes,
+    const std::vector<std::vector<restart_node_status_s>>& waves)
+{
+    int failures = 0;
+    const char* name = policy.name();
+    bool one_per_group = strcmp(name, "max_parallel") != 0;
+    bool one_per_host = strcmp(name, "load_adaptive") == 0;
+
+    std::map<int, const schedule_node_s*> by_id;
+    std::map<int, int> live;
+    for (const auto& node : nodes) {
+        by_id[node.node_id] = &node;
+        live[node.node_group] += node.started;
+    }
+
+    std::map<int, int> restarts;
+    for (const auto& wave : waves) {
+        failures += check_int_m(wave.empty(), 0, name);
+        std::map<int, int> down;
+        std::set<std::string> hosts;
+        for (const auto& restart : wave) {
+            const schedule_node_s* node = by_id[restart.node_id];
+            ++restarts[restart.node_id];
+            ++down[node->node_group];
+            if (one_per_host) {
+                failures += check_int_m(hosts.count(node->host), 0, name);
+            }
+            hosts.insert(node->host);
+        }
+        for (const auto& group : down) {
+            if (one_per_group) {
+                failures += check_int_m(group.second, 1, name);
+            } else if (live[group.first] > 1) {
+                failures += check_int_m(live[group.first] > group.second, 1,
+                    name);
+            }
+        }
+    }
+
+    for (const auto& node : nodes) {
+        failures += check_int_m(restarts[node.node_id], node.pending ? 1 : 0,
+            name);
+    }
+    return failures;
+}
+
+int test_random_clusters(int verbose, unsigned seed, unsigned long count)
+{
+    std::mt19937 rng(seed);
+    int failures = 0;
+
+    const auto& policies = schedule_policies();
+    std::vector<policy_stats_s> stats(policies.size(),
+        policy_stats_s{ 0.0, 0, 1000, 0.0 });
+    double round_robin_seconds = 0.0;
+    unsigned long all_started = 0;
+
+    for (unsigned long i = 0; i < count && failures < 10; ++i) {
+        auto nodes = random_cluster(rng);
+        bool started = std::all_of(nodes.begin(), nodes.end(),
+            [](const schedule_node_s& node) { return node.started; });
+        all_started += started;
+
+        std::vector<double> makespans;
+        for (size_t p = 0; p < policies.size(); ++p) {
+            auto waves = policies[p]->plan(nodes);
+            failures += check_schedule(*policies[p], nodes, waves);
+
+            auto estimate = simulate_schedule(nodes, waves, true,
+                HOST_CONTENTION, 60);
+            makespans.push_back(estimate.makespan_seconds);
+            stats[p].makespan_seconds += estimate.makespan_seconds;
+            if (started) {
+                stats[p].min_live_replicas = std::min(
+                    stats[p].min_live_replicas, estimate.min_live_replicas);
+                stats[p].sum_min_live_replicas += estimate.min_live_replicas;
+            }
+        }
+        round_robin_seconds += makespans[0];
+        double fastest = *std::min_element(makespans.begin(),
+            makespans.end());
+        for (size_t p = 0; p < policies.size(); ++p) {
+            stats[p].fastest += makespans[p] == fastest;
+        }
+    }
+
+    if (verbose) {
+        printf("%lu clusters, seed %u, host contention %.2f\n", count, seed,
+            HOST_CONTENTION);
+        printf("%-14s %14s %9s %8s %9s %9s\n", "policy", "mean makespan",
+            "vs rr", "fastest", "min live", "mean live");
+        for (size_t p = 0; p < policies.size(); ++p) {
+            printf("%-14s %13.1fs %8.3fx %8lu %9d %9.2f\n",
+                policies[p]->name(), stats[p].makespan_seconds / count,
+                stats[p].makespan_seconds / round_robin_seconds,
+                stats[p].fastest, stats[p].min_live_replicas,
+                stats[p].sum_min_live_replicas / std::max(1UL, all_started));
+        }
+        printf("live: the fewest live replicas of any node group during the"
+               " restart,\nof the %lu clusters with all nodes started\n",
+            all_started);
+    }
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+    unsigned seed = argc > 2 ? strtoul(argv[2], NULL, 10) : 20180808;
+    unsigned long count = argc > 3 ? strtoul(argv[3], NULL, 10) : 500;
+
+    int failures = 0;
+
+    failures += test_known_cluster(verbose);
+    failures += test_random_clusters(verbose, seed, count);
+
+    return check_status(failures);
+}
@@ -0,0 +1,175 @@
+#include <stdlib.h>
+
+#include "echeck.h"
+#include "ndb_rolling_restart.hpp"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+#include <set>
+#include <string.h>
+
+/* data node ids are 1 to 144 since NDB 8.0, 1 to 48 before that */
+#define MAX_DATA_NODE_ID 144
+
+struct topology_stats_s {
+    unsigned long topologies;
+    unsigned long nodes;
+    unsigned long waves;
+    std::chrono::nanoseconds planning;
+};
+
+static std::vector<restart_node_status_s> random_topology(std::mt19937& rng)
+{
+    std::uniform_int_distribution<int> replicas_dist(1, 4);
+    std::uniform_int_distribution<int> percent(0, 99);
+
+    int max_node_id = percent(rng) < 50 ? 48 : MAX_DATA_NODE_ID;
+    int replicas = replicas_dist(rng);
+    std::uniform_int_distribution<int> groups_dist(1,
+        std::max(1, max_node_id / replicas));
+    int node_groups = groups_dist(rng);
+    int missing_percent = percent(rng) < 30 ? percent(rng) / 2 : 0;
+    int restarted_percent = percent(rng) < 30 ? percent(rng) : 0;
+    bool uneven = percent(rng) < 25;
+    bool shuffled_ids = percent(rng) < 50;
+
+    std::vector<int> node_ids;
+    for (int node_id = 1; node_id <= max_node_id; ++node_id) {
+        node_ids.push_back(node_id);
+    }
+    if (shuffled_ids) {
+        std::shuffle(node_ids.begin(), node_ids.end(), rng);
+    }
+
+    std::vector<restart_node_status_s> nodes;
+    size_t next_id = 0;
+    for (int group = 0; group < node_groups; ++group) {
+        int group_size = replicas;
+        if (uneven) {
+            group_size = replicas_dist(rng);
+        }
+        for (int i = 0; i < group_size && next_id < node_ids.size(); ++i) {
+            int node_id = node_ids[next_id++];
+            if (percent(rng) < missing_percent) {
+                continue;
+            }
+            bool restarted = percent(rng) < restarted_percent;
+            nodes.emplace_back(
+                restart_node_status_s{ node_id, group, restarted });
+        }
+    }
+    if (nodes.empty()) {
+        nodes.emplace_back(restart_node_status_s{ 1, 0, false });
+    }
+    std::shuffle(nodes.begin(), nodes.end(), rng);
+    return nodes;
+}
+
+static void print_topology(const std::vector<restart_node_status_s>& nodes)
+{
+    for (const auto& node : nodes) {
+        printf(" %d(%d%s)", node.node_id, node.node_group,
+            node.was_restarted ? ",r" : "");
+    }
+    printf("\n");
+}
+
+static int check_plan(const std::vector<restart_node_status_s>& nodes,
+    const std::vector<std::vector<restart_node_status_s>>& waves)
+{
+    int failures = 0;
+
+    std::map<int, int> pending_per_group;
+    std::set<int> pending;
+    for (const auto& node : nodes) {
+        if (!node.was_restarted) {
+            ++pending_per_group[node.node_group];
+            pending.insert(node.node_id);
+        }
+    }
+
+    std::map<int, int> restarts;
+    for (const auto& wave : waves) {
+        failures += check_int_m(wave.empty(), 0, "empty wave");
+        std::set<int> groups;
+        for (const auto& node : wave) {
+            failures += check_int_m(groups.count(node.node_group), 0,
+                "two nodes of one node group in a wave");
+            groups.insert(node.node_group);
+            ++restarts[node.node_id];
+        }
+    }
+
+    for (auto node_id : pending) {
+        failures += check_int_m(restarts[node_id], 1,
+            "node not restarted exactly once");
+    }
+    for (const auto& restart : restarts) {
+        failures += check_int_m(pending.count(restart.first), 1,
+            "restarted node was not pending");
+    }
+
+    int min_waves = 0;
+    for (const auto& group : pending_per_group) {
+        min_waves = std::max(min_waves, group.second);
+    }
+    failures += check_int_m(waves.size(), min_waves, "wave count not minimal");
+
+    return failures;
+}
+
+int test_random_topologies(int verbose, unsigned seed, unsigned long count,
+    topology_stats_s& stats)
+{
+    std::mt19937 rng(seed);
+    int failures = 0;
+
+    for (unsigned long i = 0; i < count; ++i) {
+        auto nodes = random_topology(rng);
+        auto input = nodes;
+
+        auto begin = std::chrono::steady_clock::now();
+        sort_node_restarts(nodes);
+        auto waves = get_restart_waves(nodes);
+        stats.planning += std::chrono::steady_clock::now() - begin;
+
+        ++stats.topologies;
+        stats.nodes += input.size();
+        stats.waves += waves.size();
+
+        int topology_failures = check_plan(input, waves);
+        if (topology_failures) {
+            printf("topology %lu (seed %u) failed:", i, seed);
+            print_topology(input);
+        }
+        failures += topology_failures;
+        if (failures > 10) {
+            break;
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+    unsigned seed = argc > 2 ? strtoul(argv[2], NULL, 10) : 20180808;
+    unsigned long count = argc > 3 ? strtoul(argv[3], NULL, 10) : 5000;
+
+    int failures = 0;
+    topology_stats_s stats = { 0, 0, 0, std::chrono::nanoseconds(0) };
+
+    failures += test_random_topologies(verbose, seed, count, stats);
+
+    if (verbose) {
+        double total_us = stats.planning.count() / 1000.0;
+        printf("seed %u: %lu topologies, %lu nodes, %lu waves\n", seed,
+            stats.topologies, stats.nodes, stats.waves);
+        printf("planning: %.0f us total, %.2f us per topology,"
+               " %.3f us per node\n",
+            total_us, total_us / stats.topologies, total_us / stats.nodes);
+    }
+
+    return check_status(failures);
+}
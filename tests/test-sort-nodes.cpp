@@ -286,6 +286,46 @@ int test_node_sorting_16_by_3(int verbose)
     return test_node_sorting(nodes, expected_nodes, verbose);
 }
 
+int test_restart_waves_uneven(int verbose)
+{
+    std::vector<restart_node_status_s> nodes = {
+        restart_node_status_s{ 2, 0, false },
+        restart_node_status_s{ 3, 0, false },
+        restart_node_status_s{ 4, 0, false },
+        restart_node_status_s{ 5, 1, false },
+        restart_node_status_s{ 6, 1, false },
+        restart_node_status_s{ 7, 2, false }
+    };
+
+    sort_node_restarts(nodes);
+    auto waves = get_restart_waves(nodes);
+
+    if (verbose) {
+        for (size_t w = 0; w < waves.size(); ++w) {
+            printf("Wave[%lu]:", (unsigned long)w);
+            for (const auto& node : waves[w]) {
+                printf(" %d(%d)", node.node_id, node.node_group);
+            }
+            printf("\n");
+        }
+    }
+
+    int failures = check_size_t(waves.size(), 3);
+    if (failures) {
+        return failures;
+    }
+    failures += check_size_t(waves[0].size(), 3);
+    failures += check_size_t(waves[1].size(), 2);
+    failures += check_size_t(waves[2].size(), 1);
+    failures += check_int(waves[0][0].node_id, 4);
+    failures += check_int(waves[0][1].node_id, 6);
+    failures += check_int(waves[0][2].node_id, 7);
+    failures += check_int(waves[1][0].node_id, 3);
+    failures += check_int(waves[1][1].node_id, 5);
+    failures += check_int(waves[2][0].node_id, 2);
+    return failures;
+}
+
 int main(int argc, char** argv)
 {
     int verbose = argc > 1 ? atoi(argv[1]) : 0;
@@ -295,6 +335,7 @@ int main(int argc, char** argv)
     failures += test_node_sorting_6(verbose);
     failures += test_node_sorting_48(verbose);
     failures += test_node_sorting_16_by_3(verbose);
+    failures += test_restart_waves_uneven(verbose);
 
     return check_status(failures);
 }
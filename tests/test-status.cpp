@@ -0,0 +1,115 @@
+#include <stdlib.h>
+
+#include "cluster_fixture.hpp"
+#include "echeck.h"
+#include "ndb_rolling_restart_dry_run.hpp"
+#include <stdio.h>
+
+/* collects the messages, and the return code of the FINISHED event */
+static void collect_events(ndb_connection_context_s& ndb_ctx,
+    std::vector<std::string>& messages, long long& finished)
+{
+    ndb_ctx.on_event = [&messages, &finished](const restart_event_s& event) {
+        if (event.type == RESTART_EVENT_FINISHED) {
+            finished = event.value;
+        } else {
+            messages.push_back(event.message);
+        }
+    };
+}
+
+static bool has_message(const std::vector<std::string>& messages,
+    const std::string& message)
+{
+    for (const auto& line : messages) {
+        if (line == message) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int test_status(int verbose)
+{
+    int failures = 0;
+
+    /* the management server is enough, no data node is waited for */
+    scripted_api_s api;
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    std::vector<std::string> messages;
+    long long finished = -1;
+    collect_events(ndb_ctx, messages, finished);
+    failures += check_int(ndb_rolling_restart_status(ndb_ctx), 0);
+    if (verbose) {
+        for (const auto& line : messages) {
+            printf("%s\n", line.c_str());
+        }
+    }
+    failures += check_long(finished, 0);
+    failures += check_size_t(api.calls.size(), 0);
+    failures += check_unsigned_int_m(api.waits, 0, "waits");
+    failures += check_unsigned_int_m(api.connects, 1, "connects");
+    failures += check_int(has_message(messages, "cluster_name: scripted"), 1);
+    failures += check_int(
+        has_message(messages, "cluster_state->no_of_nodes: 4"), 1);
+    failures += check_int(ndb_ctx.cluster_state == nullptr, 1);
+
+    /* nor without a management server */
+    scripted_api_s gone;
+    gone.failed_connects = 1;
+    ndb_connection_context_s gone_ctx;
+    gone_ctx.api = &gone;
+    std::vector<std::string> gone_messages;
+    long long gone_finished = -1;
+    collect_events(gone_ctx, gone_messages, gone_finished);
+    failures += check_int(ndb_rolling_restart_status(gone_ctx), 1);
+    failures += check_long(gone_finished, 1);
+    failures += check_unsigned_int_m(gone.waits, 0, "gone waits");
+    return failures;
+}
+
+int test_data_node_connection(int verbose)
+{
+    int failures = 0;
+
+    /* a dry run does not need the data nodes either */
+    scripted_api_s dry;
+    ndb_connection_context_s dry_ctx;
+    dry_ctx.api = &dry;
+    failures += check_int(ndb_rolling_restart_dry_run(dry_ctx, ""), 0);
+    failures += check_unsigned_int_m(dry.waits, 0, "dry run waits");
+
+    /* a restart waits for its nodes, so it makes the connection */
+    scripted_api_s live;
+    ndb_connection_context_s live_ctx;
+    live_ctx.api = &live;
+    failures += check_int(ndb_rolling_restart(live_ctx), 0);
+    failures += check_int(live.waits > 0, 1);
+
+    /* without waits after the restarts, only the checks before them
+       need the data nodes */
+    scripted_api_s no_wait;
+    ndb_connection_context_s no_wait_ctx;
+    no_wait_ctx.api = &no_wait;
+    no_wait_ctx.wait_after_restart = false;
+    failures += check_int(ndb_rolling_restart(no_wait_ctx), 0);
+    failures += check_int(no_wait.waits < live.waits, 1);
+    if (verbose) {
+        printf("waits: %u, %u without wait_after_restart\n", live.waits,
+            no_wait.waits);
+    }
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_status(verbose);
+    failures += test_data_node_connection(verbose);
+
+    return check_status(failures);
+}
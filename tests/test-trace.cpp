@@ -0,0 +1,139 @@
+#include <stdlib.h>
+
+#include "cluster_fixture.hpp"
+#include "echeck.h"
+#include "ndb_rolling_restart_trace.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <unistd.h>
+
+int test_json_escape(int verbose)
+{
+    int failures = 0;
+
+    const char* cases[][2] = {
+        { "restart", "restart" },
+        { "say \"hi\"", "say \\\"hi\\\"" },
+        { "C:\\ndb", "C:\\\\ndb" },
+        { "a\nb\tc", "a\\nb\\tc" },
+        { "bell\a", "bell\\u0007" },
+        { "", "" }
+    };
+    for (const auto& test_case : cases) {
+        std::string escaped = json_escape(test_case[0]);
+        if (verbose) {
+            printf("%s\n", escaped.c_str());
+        }
+        failures += check_str_m(escaped.c_str(), test_case[1], test_case[0]);
+    }
+    return failures;
+}
+
+static std::string read_file(const std::string& path)
+{
+    std::ifstream in(path.c_str());
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+int test_write_chrome_trace(int verbose)
+{
+    int failures = 0;
+
+    char path[] = "/tmp/test-trace-XXXXXX";
+    close(mkstemp(path));
+
+    ndb_trace_s trace;
+    trace.events.push_back(trace_event_s{ "wave 1", "wave",
+        TRACE_TRACK_ORCHESTRATOR, 0, 5000 });
+    trace.events.push_back(trace_event_s{ "restart \"3\"", "restart", 3, 10,
+        4000 });
+    trace.events.push_back(trace_event_s{ "preflight", "preflight",
+        TRACE_TRACK_PREFLIGHT, 20, 30 });
+    failures += check_int(write_chrome_trace(trace, path), 0);
+
+    std::string json = read_file(path);
+    if (verbose) {
+        printf("%s", json.c_str());
+    }
+    failures += check_str(json.c_str(),
+        "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":-1,"
+        "\"args\":{\"name\":\"preflight\"}},\n"
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+        "\"args\":{\"name\":\"orchestrator\"}},\n"
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":3,"
+        "\"args\":{\"name\":\"node 3\"}},\n"
+        "{\"name\":\"wave 1\",\"cat\":\"wave\",\"ph\":\"X\",\"pid\":1,"
+        "\"tid\":0,\"ts\":0,\"dur\":5000},\n"
+        "{\"name\":\"restart \\\"3\\\"\",\"cat\":\"restart\",\"ph\":\"X\","
+        "\"pid\":1,\"tid\":3,\"ts\":10,\"dur\":4000},\n"
+        "{\"name\":\"preflight\",\"cat\":\"preflight\",\"ph\":\"X\","
+        "\"pid\":1,\"tid\":-1,\"ts\":20,\"dur\":30}\n"
+        "]}\n");
+    unlink(path);
+
+    /* an empty trace is still a valid file */
+    ndb_trace_s empty;
+    failures += check_int(write_chrome_trace(empty, path), 0);
+    failures += check_str(read_file(path).c_str(),
+        "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n]}\n");
+    unlink(path);
+
+    failures += check_int(write_chrome_trace(empty, "/nonexistent/trace"), 1);
+    return failures;
+}
+
+int test_restart_spans(int verbose)
+{
+    int failures = 0;
+
+    /* a null trace records nothing, and does not crash */
+    auto now = std::chrono::steady_clock::now();
+    trace_add_span(nullptr, "nothing", "none", 2, now, now);
+    {
+        trace_span_s span(nullptr, "nothing", "none", 2);
+    }
+
+    scripted_api_s api;
+    ndb_trace_s trace;
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    ndb_ctx.trace = &trace;
+    failures += check_int(ndb_rolling_restart(ndb_ctx), 0);
+
+    int restarts = 0;
+    int waves = 0;
+    for (const auto& event : trace.events) {
+        if (verbose) {
+            printf("%d %s %s %ld\n", event.track, event.category.c_str(),
+                event.name.c_str(), (long)event.duration_us);
+        }
+        if (event.name == "restart" && event.track > 0) {
+            ++restarts;
+        }
+        if (event.category == "wave") {
+            failures += check_int(event.track, TRACE_TRACK_ORCHESTRATOR);
+            ++waves;
+        }
+        failures += check_int(event.duration_us >= 0, 1);
+    }
+    failures += check_int(restarts, 4);
+    failures += check_int(waves, 2);
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_json_escape(verbose);
+    failures += test_write_chrome_trace(verbose);
+    failures += test_restart_spans(verbose);
+
+    return check_status(failures);
+}
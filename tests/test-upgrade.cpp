@@ -0,0 +1,287 @@
+#include <stdlib.h>
+
+#include "cluster_fixture.hpp"
+#include "echeck.h"
+#include "ndb_rolling_restart_upgrade.hpp"
+#include <stdio.h>
+#include <string.h>
+
+static ndb_mgm_node_state versioned_node(int node_id,
+    ndb_mgm_node_type node_type, unsigned version)
+{
+    ndb_mgm_node_state node = make_node_state(node_id, 0);
+    node.node_type = node_type;
+    node.version = (int)version;
+    if (!version) {
+        node.node_status = NDB_MGM_NODE_STATUS_NO_CONTACT;
+    }
+    return node;
+}
+
+int test_versions(int verbose)
+{
+    int failures = 0;
+
+    unsigned version = 0;
+    failures += check_int(parse_ndb_version("8.0.30", version), 0);
+    failures += check_unsigned_int_m(version, 0x0008001E, "8.0.30");
+    failures += check_str(format_ndb_version(version).c_str(), "8.0.30");
+    failures += check_str(format_ndb_version(0).c_str(), "unknown");
+    failures += check_int(parse_ndb_version("8.0", version), 1);
+    failures += check_int(parse_ndb_version("8.0.30x", version), 1);
+    failures += check_int(parse_ndb_version("8.0.300", version), 1);
+
+    std::string reason;
+    unsigned v7_5 = UPGRADE_MAKE_VERSION(7, 5, 20);
+    unsigned v7_6 = UPGRADE_MAKE_VERSION(7, 6, 10);
+    unsigned v7_6_new = UPGRADE_MAKE_VERSION(7, 6, 30);
+    unsigned v8_0 = UPGRADE_MAKE_VERSION(8, 0, 30);
+    unsigned v8_4 = UPGRADE_MAKE_VERSION(8, 4, 0);
+    failures += check_int(check_upgrade_path(v7_6, v7_6_new, reason), 0);
+    failures += check_int(check_upgrade_path(v7_6_new, v7_6, reason), 0);
+    failures += check_int(check_upgrade_path(v7_5, v7_6, reason), 0);
+    failures += check_int(check_upgrade_path(v7_6, v8_0, reason), 0);
+    failures += check_int(check_upgrade_path(v8_0, v8_4, reason), 0);
+
+    failures += check_int(check_upgrade_path(v7_5, v8_0, reason), 1);
+    failures += check_str(reason.c_str(), "7.5 to 8.0 skips a release series");
+    failures += check_int(check_upgrade_path(v8_0, v7_6, reason), 1);
+    failures += check_str(reason.c_str(),
+        "a downgrade from 8.0 to 7.6 is not supported, only within a"
+        " release series");
+    failures += check_int(check_upgrade_path(0, v8_0, reason), 1);
+    return failures;
+}
+
+int test_plan(int verbose)
+{
+    int failures = 0;
+
+    unsigned v7_6 = UPGRADE_MAKE_VERSION(7, 6, 10);
+    unsigned v8_0 = UPGRADE_MAKE_VERSION(8, 0, 30);
+    auto mgm = NDB_MGM_NODE_TYPE_MGM;
+    auto ndb = NDB_MGM_NODE_TYPE_NDB;
+    auto api = NDB_MGM_NODE_TYPE_API;
+
+    /* the management node runs 8.0 already, one data node too */
+    ndb_mgm_cluster_state* cluster_state = make_cluster_state(
+        { versioned_node(1, mgm, v8_0), versioned_node(4, ndb, v7_6),
+            versioned_node(2, ndb, v8_0), versioned_node(3, ndb, v7_6),
+            versioned_node(50, api, v7_6), versioned_node(51, api, 0) });
+    failures += check_int(versions_mixed(cluster_state), 1);
+    upgrade_plan_s plan = plan_upgrade(cluster_state, 0, false);
+    failures += check_unsigned_int_m(plan.from, v7_6, "from");
+    failures += check_unsigned_int_m(plan.target, v8_0, "target");
+    failures += check_size_t(plan.mgm_nodes.size(), 0);
+    failures += check_size_t(plan.data_nodes.size(), 2);
+    if (plan.data_nodes.size() == 2) {
+        failures += check_int(plan.data_nodes[0], 3);
+        failures += check_int(plan.data_nodes[1], 4);
+    }
+    /* node 51 is not connected */
+    failures += check_size_t(plan.api_nodes.size(), 1);
+    failures += check_size_t(plan.problems.size(), 0);
+    failures += check_size_t(plan.warnings.size(), 0);
+    free((void*)cluster_state);
+
+    /* a data node went ahead of the management node */
+    cluster_state = make_cluster_state({ versioned_node(1, mgm, v7_6),
+        versioned_node(2, ndb, v8_0), versioned_node(3, ndb, v7_6) });
+    plan = plan_upgrade(cluster_state, 0, false);
+    failures += check_size_t(plan.mgm_nodes.size(), 1);
+    failures += check_size_t(plan.warnings.size(), 1);
+    if (plan.warnings.size() == 1) {
+        failures += check_str(plan.warnings[0].c_str(),
+            "node 2 runs 8.0.30 before the management nodes, which run"
+            " 7.6.10");
+    }
+
+    /* a target two series ahead */
+    plan = plan_upgrade(cluster_state, UPGRADE_MAKE_VERSION(8, 4, 0), false);
+    failures += check_size_t(plan.problems.size(), 1);
+    if (plan.problems.size() == 1) {
+        failures += check_str(plan.problems[0].c_str(),
+            "node 1 3 can not go from 7.6.10 to 8.4.0: 7.6 to 8.4 skips a"
+            " release series");
+    }
+    free((void*)cluster_state);
+
+    /* 7.5 to 7.6 changed the data node file system */
+    unsigned v7_5 = UPGRADE_MAKE_VERSION(7, 5, 20);
+    cluster_state = make_cluster_state(
+        { versioned_node(1, mgm, v7_5), versioned_node(2, ndb, v7_5) });
+    failures += check_int(versions_mixed(cluster_state), 0);
+    plan = plan_upgrade(cluster_state, v7_6, false);
+    failures += check_size_t(plan.mgm_nodes.size(), 1);
+    failures += check_size_t(plan.data_nodes.size(), 1);
+    failures += check_size_t(plan.warnings.size(), 1);
+    plan = plan_upgrade(cluster_state, v7_6, true);
+    failures += check_size_t(plan.warnings.size(), 0);
+    free((void*)cluster_state);
+
+    cluster_state = make_cluster_state({ versioned_node(2, ndb, 0) });
+    plan = plan_upgrade(cluster_state, 0, false);
+    failures += check_size_t(plan.problems.size(), 1);
+    free((void*)cluster_state);
+    return failures;
+}
+
+/* the operator: starts the stopped data nodes with the new binary */
+static void start_new_binary(scripted_api_s& api, unsigned version)
+{
+    for (auto& node : api.nodes) {
+        if (node.node_status == NDB_MGM_NODE_STATUS_NOT_STARTED
+            && !api.recovering.count(node.node_id)) {
+            node.version = (int)version;
+            api.recovering[node.node_id] = 0;
+        }
+    }
+}
+
+int test_upgrade_data_nodes(int verbose)
+{
+    int failures = 0;
+
+    unsigned v7_6_new = UPGRADE_MAKE_VERSION(7, 6, 30);
+    ndb_upgrade_s upgrade;
+    upgrade.target = v7_6_new;
+    upgrade.node_wait = std::chrono::seconds(60);
+
+    /* stopped with nostart a wave at a time, the next wave waits for
+       the one before to run the new version */
+    scripted_api_s api;
+    api.on_sleep = [v7_6_new](scripted_api_s& api) {
+        start_new_binary(api, v7_6_new);
+    };
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    failures += check_int(ndb_rolling_restart_upgrade(ndb_ctx, upgrade), 0);
+    if (verbose) {
+        for (const auto& call : api.calls) {
+            printf("%s\n", call.c_str());
+        }
+    }
+    failures += check_size_t(api.calls.size(), 2);
+    if (api.calls.size() == 2) {
+        failures += check_str(api.calls[0].c_str(), "restart4 nostart 3 5");
+        failures += check_str(api.calls[1].c_str(), "restart4 nostart 2 4");
+    }
+    for (const auto& node : api.nodes) {
+        failures += check_unsigned_int_m((unsigned)node.version, v7_6_new,
+            "version");
+    }
+
+    /* nodes which come back with the old binary are not upgraded, the
+       next wave stays up */
+    scripted_api_s old_binary;
+    old_binary.on_sleep = [](scripted_api_s& api) {
+        start_new_binary(api, 0x00070610);
+        if (api.sleeps == 10) {
+            api.abort = true;
+        }
+    };
+    ndb_connection_context_s old_ctx;
+    old_ctx.api = &old_binary;
+    failures += check_int(ndb_rolling_restart_upgrade(old_ctx, upgrade), 1);
+    failures += check_size_t(old_binary.calls.size(), 1);
+    return failures;
+}
+
+int test_upgrade_partner_down(int verbose)
+{
+    int failures = 0;
+
+    unsigned v7_6_new = UPGRADE_MAKE_VERSION(7, 6, 30);
+    ndb_upgrade_s upgrade;
+    upgrade.target = v7_6_new;
+    upgrade.node_wait = std::chrono::seconds(60);
+
+    /* node 2 is down, so has no version, node 3 is the last live
+       replica of node group 0 and is not stopped */
+    scripted_api_s api;
+    api.node(2)->node_status = NDB_MGM_NODE_STATUS_NO_CONTACT;
+    api.node(2)->version = 0;
+    api.on_sleep = [v7_6_new](scripted_api_s& api) {
+        start_new_binary(api, v7_6_new);
+    };
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    ndb_ctx.wait_seconds = 3;
+    failures += check_int(ndb_rolling_restart_upgrade(ndb_ctx, upgrade), 1);
+    failures += check_size_t(api.calls.size(), 0);
+
+    /* once node 2 is back, with the new version, node 3 may go */
+    scripted_api_s back;
+    back.node(2)->node_status = NDB_MGM_NODE_STATUS_NO_CONTACT;
+    back.node(2)->version = 0;
+    back.on_sleep = [v7_6_new](scripted_api_s& api) {
+        ndb_mgm_node_state* node = api.node(2);
+        if (node->node_status == NDB_MGM_NODE_STATUS_NO_CONTACT) {
+            node->node_status = NDB_MGM_NODE_STATUS_STARTED;
+            node->version = (int)v7_6_new;
+        }
+        start_new_binary(api, v7_6_new);
+    };
+    ndb_connection_context_s back_ctx;
+    back_ctx.api = &back;
+    back_ctx.wait_seconds = 3;
+    failures += check_int(ndb_rolling_restart_upgrade(back_ctx, upgrade), 0);
+    if (verbose) {
+        for (const auto& call : back.calls) {
+            printf("%s\n", call.c_str());
+        }
+    }
+    failures += check_size_t(back.calls.size(), 2);
+    if (back.calls.size() == 2) {
+        failures += check_str(back.calls[0].c_str(), "restart4 nostart 3 5");
+        failures += check_str(back.calls[1].c_str(), "restart4 nostart 4");
+    }
+    return failures;
+}
+
+int test_upgrade_reconnect(int verbose)
+{
+    int failures = 0;
+
+    unsigned v7_6_new = UPGRADE_MAKE_VERSION(7, 6, 30);
+    ndb_upgrade_s upgrade;
+    upgrade.target = v7_6_new;
+    upgrade.node_wait = std::chrono::seconds(60);
+
+    /* the status is lost for three polls of the first wave, the first
+       reconnect takes three tries */
+    scripted_api_s api;
+    api.on_sleep = [v7_6_new](scripted_api_s& api) {
+        start_new_binary(api, v7_6_new);
+    };
+    api.on_restart = [](scripted_api_s& api) {
+        if (api.calls.size() == 1) {
+            api.failed_polls = 3;
+            api.failed_connects = 2;
+        }
+    };
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    failures += check_int(ndb_rolling_restart_upgrade(ndb_ctx, upgrade), 0);
+    failures += check_size_t(api.calls.size(), 2);
+    failures += check_unsigned_int_m(api.connects, 4, "connects");
+    if (verbose) {
+        printf("%u connects, %u sleeps\n", api.connects, api.sleeps);
+    }
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_versions(verbose);
+    failures += test_plan(verbose);
+    failures += test_upgrade_data_nodes(verbose);
+    failures += test_upgrade_partner_down(verbose);
+    failures += test_upgrade_reconnect(verbose);
+
+    return check_status(failures);
+}
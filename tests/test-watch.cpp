@@ -0,0 +1,153 @@
+#include <stdlib.h>
+
+#include "cluster_fixture.hpp"
+#include "echeck.h"
+#include "ndb_rolling_restart_watch.hpp"
+#include <stdio.h>
+#include <string.h>
+
+int test_format(int verbose)
+{
+    int failures = 0;
+
+    node_snapshot_s node{ 3, 1, NDB_MGM_NODE_STATUS_STARTING, 4, 2, 0 };
+    failures += check_str(format_watch_header().c_str(),
+        "  node group status        phase connects");
+    failures += check_str(format_watch_row(node, 0, false).c_str(),
+        "     3     1 STARTING          4        2");
+    failures += check_str(format_watch_row(node, NODE_CHANGE_START_PHASE,
+                              false)
+                              .c_str(),
+        "*    3     1 STARTING          4        2");
+    failures += check_str(format_watch_row(node, NODE_CHANGE_START_PHASE,
+                              true)
+                              .c_str(),
+        "*    3     1 STARTING      \033[1;33m    4\033[0m        2");
+
+    node.node_status = NDB_MGM_NODE_STATUS_STARTED;
+    node.node_group = 65536;
+    failures += check_str(format_watch_row(node, 0, false).c_str(),
+        "     3     - STARTED           -        2");
+
+    node_table_s table;
+    failures += check_str(format_watch_replicas(table, false).c_str(),
+        "replicas: none");
+    return failures;
+}
+
+/* loses the connection at the first poll after connecting, then fails
+   lost_connects connects */
+struct lossy_api_s : scripted_api_s {
+    ndb_mgm_cluster_state* get_status2(ndb_connection_context_s& ndb_ctx,
+        const ndb_mgm_node_type node_types[]) override
+    {
+        if (polls == 1 && !lost) {
+            lost = true;
+            failed_connects = lost_connects;
+            return nullptr;
+        }
+        return scripted_api_s::get_status2(ndb_ctx, node_types);
+    }
+    bool lost = false;
+    int lost_connects = 0;
+};
+
+int test_watch(int verbose)
+{
+    int failures = 0;
+
+    scripted_api_s api;
+    auto started = NDB_MGM_NODE_STATUS_STARTED;
+    auto starting = NDB_MGM_NODE_STATUS_STARTING;
+    api.statuses = { { started, started, started, started },
+        { started, started, started, started },
+        { started, starting, started, started },
+        { started, started, started, started } };
+
+    std::vector<std::string> lines;
+    ndb_connection_context_s ndb_ctx;
+    ndb_ctx.api = &api;
+    ndb_ctx.on_event = [&lines](const restart_event_s& event) {
+        if (event.type != RESTART_EVENT_FINISHED) {
+            lines.push_back(event.message);
+        }
+    };
+
+    ndb_watch_s watch;
+    watch.interval = std::chrono::milliseconds(1);
+    watch.idle_interval = std::chrono::milliseconds(1);
+    watch.max_polls = 3;
+    failures += check_int(ndb_rolling_restart_watch(ndb_ctx, watch), 0);
+    if (verbose) {
+        for (const auto& line : lines) {
+            printf("%s\n", line.c_str());
+        }
+    }
+
+    std::vector<std::string> expect{ format_watch_header(),
+        "     2     0 STARTED           -        1",
+        "     3     0 STARTED           -        1",
+        "     4     1 STARTED           -        1",
+        "     5     1 STARTED           -        1", "replicas: 0 2/2, 1 2/2",
+        "no node restart events, polling only",
+        /* the second poll changed nothing */
+        "*    3     0 STARTING          4        1",
+        "replicas: 0 1/2 (degraded), 1 2/2",
+        "*    3     0 STARTED           -        1",
+        "replicas: 0 2/2, 1 2/2" };
+    failures += check_size_t(lines.size(), expect.size());
+    for (size_t i = 0; i < lines.size() && i < expect.size(); ++i) {
+        failures += check_str(lines[i].c_str(), expect[i].c_str());
+    }
+    failures += check_size_t(api.polls, 4);
+
+    /* a cancel stops it before the first poll */
+    std::atomic<bool> cancel{ true };
+    ndb_ctx.cancel = &cancel;
+    api.polls = 0;
+    failures += check_int(ndb_rolling_restart_watch(ndb_ctx, watch), 0);
+    failures += check_size_t(api.polls, 1);
+
+    /* a lost connection is retried until it is back */
+    lossy_api_s lost;
+    lost.lost_connects = 3;
+    ndb_connection_context_s lost_ctx;
+    lost_ctx.api = &lost;
+    ndb_watch_s busy_watch;
+    busy_watch.interval = std::chrono::milliseconds(0);
+    busy_watch.idle_interval = std::chrono::milliseconds(0);
+    busy_watch.max_polls = 2;
+    failures += check_int(ndb_rolling_restart_watch(lost_ctx, busy_watch), 0);
+    failures += check_int(lost.connects, 2);
+    failures += check_int(lost.sleeps, 4);
+    failures += check_size_t(lost.polls, 2);
+
+    /* and until cancelled, if it is not */
+    lossy_api_s gone;
+    gone.lost_connects = 1000;
+    std::atomic<bool> gone_cancel{ false };
+    ndb_connection_context_s gone_ctx;
+    gone_ctx.api = &gone;
+    gone_ctx.cancel = &gone_cancel;
+    gone.on_sleep = [&gone_cancel](scripted_api_s& api) {
+        if (api.sleeps == 20) {
+            gone_cancel = true;
+        }
+    };
+    failures += check_int(ndb_rolling_restart_watch(gone_ctx, busy_watch), 0);
+    failures += check_int(gone.connects, 1);
+    failures += check_int(gone.sleeps, 20);
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_format(verbose);
+    failures += test_watch(verbose);
+
+    return check_status(failures);
+}
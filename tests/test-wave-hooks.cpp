@@ -0,0 +1,174 @@
+#include <stdlib.h>
+
+#include "echeck.h"
+#include "ndb_rolling_restart_hooks.hpp"
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+/* a shell script which writes its arguments to out_path, then runs
+   body */
+static std::string write_script(const char* out_path, const char* body)
+{
+    char path[] = "/tmp/test-wave-hooks-XXXXXX";
+    int fd = mkstemp(path);
+    std::string script = std::string("#!/bin/sh\necho \"$@\" > ") + out_path
+        + "\n" + body + "\n";
+    if (write(fd, script.data(), script.size()) != (ssize_t)script.size()) {
+        fprintf(stderr, "could not write %s\n", path);
+    }
+    close(fd);
+    chmod(path, 0700);
+    return path;
+}
+
+static std::string read_line(const char* path)
+{
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+int test_executable(int verbose)
+{
+    int failures = 0;
+
+    char out_path[] = "/tmp/test-wave-hooks-out-XXXXXX";
+    close(mkstemp(out_path));
+
+    std::vector<int> node_ids{ 3, 5 };
+    std::string error;
+    std::string ok = write_script(out_path, "exit 0");
+    failures += check_int(run_wave_hook(ok, "pre_wave", 2, node_ids,
+                              std::chrono::seconds(5), error),
+        0);
+    failures += check_str(read_line(out_path).c_str(), "pre_wave 2 3 5");
+
+    std::string fails = write_script(out_path, "exit 3");
+    failures += check_int(run_wave_hook(fails, "post_wave", 2, node_ids,
+                              std::chrono::seconds(5), error),
+        1);
+    failures += check_str(error.c_str(), "exited with 3");
+
+    std::string hangs = write_script(out_path, "exec sleep 10");
+    auto begin = std::chrono::steady_clock::now();
+    failures += check_int(run_wave_hook(hangs, "pre_wave", 1, node_ids,
+                              std::chrono::milliseconds(200), error),
+        1);
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    failures += check_str(error.c_str(), "timed out after 200ms");
+    failures += check_int(elapsed < std::chrono::seconds(5), 1);
+
+    failures += check_int(run_wave_hook("/nonexistent/hook", "pre_wave", 1,
+                              node_ids, std::chrono::seconds(5), error),
+        1);
+    failures += check_str(error.c_str(), "exited with 127");
+    if (verbose) {
+        printf("%s\n", error.c_str());
+    }
+
+    unlink(ok.c_str());
+    unlink(fails.c_str());
+    unlink(hangs.c_str());
+    unlink(out_path);
+    return failures;
+}
+
+/* answers one call with reply, or not at all if reply is null */
+static void serve_one(int listen_fd, const char* reply, std::string* request)
+{
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) {
+        return;
+    }
+    char buf[256];
+    ssize_t len;
+    while ((len = read(fd, buf, sizeof(buf))) > 0) {
+        request->append(buf, (size_t)len);
+        if (request->find('\n') != std::string::npos) {
+            break;
+        }
+    }
+    if (reply) {
+        if (write(fd, reply, strlen(reply)) < 0) {
+            fprintf(stderr, "could not reply\n");
+        }
+    } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+    close(fd);
+}
+
+int test_socket(int verbose)
+{
+    int failures = 0;
+
+    char path[] = "/tmp/test-wave-hooks-sock-XXXXXX";
+    close(mkstemp(path));
+    unlink(path);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    failures += check_int(bind(listen_fd, (sockaddr*)&addr, sizeof(addr)), 0);
+    failures += check_int(listen(listen_fd, 4), 0);
+
+    std::string hook = std::string(WAVE_HOOK_SOCKET_PREFIX) + path;
+    std::vector<int> node_ids{ 2, 4, 6 };
+    std::string error;
+
+    std::string request;
+    std::thread server(serve_one, listen_fd, "ok drained\n", &request);
+    failures += check_int(run_wave_hook(hook, "pre_wave", 1, node_ids,
+                              std::chrono::seconds(5), error),
+        0);
+    server.join();
+    failures += check_str(request.c_str(), "pre_wave 1 2 4 6\n");
+
+    request.clear();
+    server = std::thread(serve_one, listen_fd, "busy\n", &request);
+    failures += check_int(run_wave_hook(hook, "post_wave", 1, node_ids,
+                              std::chrono::seconds(5), error),
+        1);
+    server.join();
+    failures += check_str(error.c_str(), "answered: busy");
+
+    request.clear();
+    server = std::thread(serve_one, listen_fd, nullptr, &request);
+    failures += check_int(run_wave_hook(hook, "post_wave", 1, node_ids,
+                              std::chrono::milliseconds(100), error),
+        1);
+    server.join();
+    failures += check_str(error.c_str(), "timed out after 100ms");
+
+    close(listen_fd);
+    unlink(path);
+
+    failures += check_int(run_wave_hook(hook, "pre_wave", 1, node_ids,
+                              std::chrono::seconds(5), error),
+        1);
+    if (verbose) {
+        printf("%s\n", error.c_str());
+    }
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int verbose = argc > 1 ? atoi(argv[1]) : 0;
+
+    int failures = 0;
+
+    failures += test_executable(verbose);
+    failures += test_socket(verbose);
+
+    return check_status(failures);
+}